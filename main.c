@@ -1,29 +1,72 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdalign.h>
+#include <assert.h>
 #include <string.h>
 #include <strings.h>
 #include <sys/types.h>
 #include <tgmath.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <time.h>
 #include <vulkan/vulkan_core.h>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
-#define WINDOW_WIDTH 800
-#define WINDOW_HEIGHT 600
+#include "mesh_format.h"
 
-#define CHECK_ALLOC_FOR_NULL(x) if((x) == NULL) {printf("could not allocate memory\n"); exit(1);}
+static_assert(MESH_FORMAT_R32G32_SFLOAT == VK_FORMAT_R32G32_SFLOAT, "mesh_format.h format values out of sync with vulkan");
+static_assert(MESH_FORMAT_R32G32B32_SFLOAT == VK_FORMAT_R32G32B32_SFLOAT, "mesh_format.h format values out of sync with vulkan");
 
+#define WINDOW_WIDTH 800 // defaults, see AppConfig
+#define WINDOW_HEIGHT 600
+#define MAX_OUTPUTS 4 // windows presented together from the one device
+
+#define MAX_FRAMES_IN_FLIGHT 3 // array bound, AppConfig.framesInFlight is the count in use
+#define FRAME_ARENA_SIZE (1024 * 1024)
+#define SCRATCH_ARENA_SIZE (1024 * 1024)
+#define DRAW_LIST_MAX_COMMANDS 1024
+#define DRAW_LIST_CHUNK_COMMANDS 256 // draws per secondary command buffer, each recorded by its own job
+#define DRAW_LIST_MAX_CHUNKS (DRAW_LIST_MAX_COMMANDS / DRAW_LIST_CHUNK_COMMANDS)
+#define SWAP_CHAIN_ARENA_SIZE (64 * 1024)
+#define OUTPUT_SUPPORT_ARENA_SIZE (16 * 1024)
+#define MAX_PHYSICAL_DEVICES 16
+#define DEVICE_CAPABILITIES_ARENA_SIZE (256 * 1024)
+
+#define HEADLESS_IMAGE_COUNT 3
+#define HEADLESS_FORMAT VK_FORMAT_B8G8R8A8_UNORM
+
+#define TRACE_FILE_MAGIC 0x43525456 // "VTRC"
+#define TRACE_FILE_VERSION 2
+#define TRACE_FRAME_MAGIC 0x454d5246 // "FRME"
+#define TRACE_MAX_HANDLES 16
+#define TRACE_WRITE_BUFFER_SIZE (64 * 1024)
+
+#define CONFIG_MAX_FILES 4
+
+// every heap allocation in this file goes through CHECK_ALLOC_FOR_NULL, which
+// lets debug builds count them and assert that the frame loop does none
 #ifdef NDEBUG
-const bool globalValidationLayersEnabled = false;
+#define CHECK_ALLOC_FOR_NULL(x) do { if((x) == NULL) {printf("could not allocate memory\n"); exit(1);} } while(0)
 #else
-const bool globalValidationLayersEnabled = true;
+uint64_t globalHeapAllocationsCount = 0;
+#define CHECK_ALLOC_FOR_NULL(x) do { globalHeapAllocationsCount++; if((x) == NULL) {printf("could not allocate memory\n"); exit(1);} } while(0)
 #endif
 
-
+#define ARENA_ALLOC_ARRAY(arena, type, count) ((type *)arena_alloc((arena), sizeof(type) * (count), alignof(type)))
 
 const uint8_t globalValidationLayersCount = 1;
 const char *globalValidationLayers[] = {
@@ -35,1062 +78,8804 @@ const char* globalDeviceExtensions[] = {
   VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// only enabled when the device supports both, see app_private_init_vulkan_create_logical_device
+const uint8_t globalOptionalDeviceExtensionCount = 2;
+const char* globalOptionalDeviceExtensions[] = {
+  VK_KHR_PRESENT_ID_EXTENSION_NAME,
+  VK_KHR_PRESENT_WAIT_EXTENSION_NAME
+};
 
+// meshlet task and mesh shaders; spirv 1.4 is not core before vulkan 1.2
+const uint8_t globalMeshShaderDeviceExtensionCount = 3;
+const char* globalMeshShaderDeviceExtensions[] = {
+  VK_EXT_MESH_SHADER_EXTENSION_NAME,
+  VK_KHR_SPIRV_1_4_EXTENSION_NAME,
+  VK_KHR_SHADER_FLOAT_CONTROLS_EXTENSION_NAME
+};
 
-struct {
-  GLFWwindow *window;
-  VkInstance instance;
-  VkDebugUtilsMessengerEXT debugMessenger;
-  VkPhysicalDevice physicalDevice;
-  VkPhysicalDeviceFeatures deviceFeatures;
-  VkDevice device;
-  VkQueue graphicsQueue;
-  VkQueue presentQueue;
-  VkSurfaceKHR surface;
-  VkSwapchainKHR swapChain;
-  VkImage* swapChainImages;
-  uint32_t swapChainImagesCount;
-  VkFormat swapChainImageFormat;
-  VkExtent2D swapChainExtent;
-  VkImageView* swapChainImageViews; //same length as swapChainImages
-  VkRenderPass renderPass;
-  VkPipelineLayout pipelineLayout;
-  VkPipeline graphicsPipeline;
-  VkFramebuffer* swapChainFrameBuffers;
-  uint32_t swapChainFrameBuffersCount;
-  VkCommandPool commandPool;
-  VkCommandBuffer commandBuffer;
-  VkSemaphore imageAvailableSemaphore;
-  VkSemaphore renderFinishedSemaphore;
-  VkFence inFlightFence;
-} typedef App;
 
-void app_run(App* app);
-//------------------------------------
-void app_private_init_window(App *app);
-//------------------------------------
-void app_private_init_vulkan(App *app);
 
-void app_private_init_vulkan_create_instance(App *app);
-bool app_private_init_vulkan_create_instance_check_layer_support();
+#define FRAME_PACER_HISTORY 16 // presents whose input time is remembered, must exceed images in flight
+#define FRAME_PACER_REPORT_INTERVAL_NS 5000000000ull
+#define FRAME_PACER_WAIT_TIMEOUT_NS 100000000ull
 
-void app_private_init_vulkan_setup_debug_messenger(App *app);
+#define FRAME_GRAPH_MAX_RESOURCES 32
+#define FRAME_GRAPH_MAX_PASSES 32
+#define FRAME_GRAPH_MAX_PASS_ACCESSES 8
+#define FRAME_GRAPH_MAX_SEGMENTS 4
+#define FRAME_GRAPH_TIMING_REPORT_FRAMES 600
 
-void app_private_init_vulkan_create_surface(App *app);
+#define POST_SCENE_FORMAT VK_FORMAT_R16G16B16A16_SFLOAT
+#define POST_OUTPUT_FORMAT VK_FORMAT_R8G8B8A8_UNORM
 
-void app_private_init_vulkan_pick_device(App *app);
-bool app_private_init_vulkan_pick_device_check_device_extensions(VkPhysicalDevice device);
+#define MESHLET_TASK_GROUP_SIZE 32 // meshlet.task local size
+#define MESHLET_CULL_GROUP_SIZE 64 // meshlet_cull.comp local size
+#define MESHLET_MAX_TASK_GROUPS (1u << 22) // guaranteed maxTaskWorkGroupTotalCount
+#define MESHLET_REPORT_FRAMES 600
 
-void app_private_init_vulkan_create_logical_device(App *app);
+#define MESH_TEXTURE_SET 2 // after the meshlet renderer's buffers and depth pyramid
 
-void app_private_init_vulkan_create_swap_chain(App* app);
-VkSurfaceFormatKHR app_private_init_vulkan_create_swap_chain_choose_format(VkSurfaceFormatKHR *availableFormats, uint32_t count);
-VkPresentModeKHR app_private_init_vulkan_create_swap_chain_choose_present_mode(VkPresentModeKHR *availablePresentModes, uint32_t count);
-VkExtent2D app_private_init_vulkan_create_swap_chain_choose_swap_extend(VkSurfaceCapabilitiesKHR *capabilities, GLFWwindow *window);
+#define HIZ_MAX_MIPS 16 // a 16384 wide depth buffer gives 14
+#define HIZ_GROUP_SIZE 8 // hiz_reduce.comp local size per side
 
-void app_private_init_vulkan_create_image_views(App *app);
+#define RESOLUTION_GAIN_DOWN 0.3 // fraction of the way to the wanted scale moved per frame when over the target
+#define RESOLUTION_GAIN_UP 0.05 // and when under it, slower so a short dip does not bounce straight back
+#define RESOLUTION_DEADBAND 0.05 // relative distance from the target the scale is left alone in
+#define RESOLUTION_REPORT_FRAMES 600
 
-void app_private_init_vulkan_create_render_pass(App *app);
+#define ON_DEMAND_STREAMING_POLL_INTERVAL 0.01 // seconds between streamer updates while uploads are pending
 
-void app_private_init_vulkan_create_graphics_pipeline(App *app);
 
-void app_private_init_vulkan_create_frame_buffers(App *app);
 
-void app_private_init_vulkan_create_command_pool(App *app);
+#define SUBMIT_BATCHER_MAX_BATCHES 8
+#define SUBMIT_BATCHER_MAX_COMMAND_BUFFERS 16
+#define SUBMIT_BATCHER_MAX_SEMAPHORES 16
 
-void app_private_init_vulkan_create_command_buffer(App *app);
+#define TEXTURE_FILE_MAGIC 0x58544b56 // "VKTX"
+#define TEXTURE_MAX_MIPS 16
+#define TEXTURE_MAX_DIMENSION 16384
+#define TEXTURE_STREAMER_MAX_TEXTURES 64
+#define TEXTURE_STREAMER_MAX_REQUESTS 256
+#define TEXTURE_STREAMER_MAX_RETIRED_VIEWS 64
+#define TEXTURE_STREAMER_MAX_RETIRED_IMAGES TEXTURE_STREAMER_MAX_TEXTURES
+#define TEXTURE_STREAMER_RING_SLOTS 8
+#define TEXTURE_STREAMER_SLOT_SIZE (4 * 1024 * 1024)
+#define TEXTURE_STREAMER_VIEW_RETIRE_FRAMES (MAX_FRAMES_IN_FLIGHT + 1)
 
-void app_private_init_vulkan_create_sync_objects(App *app);
-//------------------------------------
-VkDebugUtilsMessengerCreateInfoEXT app_private_populate_debug_messenger_info();
-//------------------------------------
-VKAPI_ATTR VkBool32 VKAPI_CALL app_private_debug_callback(
-  VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-  VkDebugUtilsMessageTypeFlagsEXT messageType,
-  const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
-  void *pUserData);
-//------------------------------------
-void app_private_main_loop(App *app);
+#define MEMORY_TRACKER_MAX_ALLOCATIONS 4096
+#define MEMORY_TRACKER_REPORT_FRAMES 600
+#define MEMORY_PRESSURE_HIGH_WATER 0.9 // of the heap budget, fires the pressure callback
+#define MEMORY_PRESSURE_LOW_WATER 0.8 // the callback is asked to get back below this
+#define MEMORY_PRESSURE_COOLDOWN_FRAMES 60
 
-void app_private_main_loop_draw_frame(App *app);
-void app_private_main_loop_draw_frame_record_command_buffer(App *app, VkCommandBuffer commandBuffer, uint32_t imageIndex);
-//------------------------------------
-void app_private_cleanup(App *app);
+// one VkSubmitInfo worth of work, its arrays are ranges in the batcher
+struct {
+  VkQueue queue;
+  uint32_t firstWait;
+  uint32_t waitsCount;
+  uint32_t firstCommandBuffer;
+  uint32_t commandBuffersCount;
+  uint32_t firstSignal;
+  uint32_t signalsCount;
+  VkFence fence; // VK_NULL_HANDLE unless set, ends the call the batch goes out in
+} typedef SubmitBatch;
+
+// subsystems add their command buffers and semaphores over the frame, flush
+// hands consecutive batches on one queue to the driver in a single call,
+// vkQueueSubmit2 when VK_KHR_synchronization2 is enabled. a binary semaphore
+// wait must be submitted after its signal, so a queue that is left and
+// returned to within the frame costs a second call
+struct {
+  PFN_vkQueueSubmit2KHR queueSubmit2; // NULL falls back to vkQueueSubmit
 
+  SubmitBatch batches[SUBMIT_BATCHER_MAX_BATCHES];
+  uint32_t batchesCount;
+  VkSemaphore waitSemaphores[SUBMIT_BATCHER_MAX_SEMAPHORES];
+  VkPipelineStageFlags waitStages[SUBMIT_BATCHER_MAX_SEMAPHORES];
+  uint32_t waitsCount;
+  VkCommandBuffer commandBuffers[SUBMIT_BATCHER_MAX_COMMAND_BUFFERS];
+  uint32_t commandBuffersCount;
+  VkSemaphore signalSemaphores[SUBMIT_BATCHER_MAX_SEMAPHORES];
+  uint32_t signalsCount;
+} typedef SubmitBatcher;
 
 
+
+// on-disk layout: this header, followed by the mip payloads at the given
+// byte offsets. mip 0 is the finest level, payloads are tightly packed.
 struct {
-  uint32_t graphicsFamily;
-  uint32_t presentFamily;
-  bool isComplete;
-} typedef QueueFamilyIndices;
+  uint32_t magic;
+  uint32_t format; // VkFormat
+  uint32_t width;
+  uint32_t height;
+  uint32_t mipCount;
+  uint32_t reserved[3];
+  struct {
+    uint64_t offset;
+    uint64_t size;
+  } mips[TEXTURE_MAX_MIPS];
+} typedef TextureFileHeader;
+
+enum {
+  TEXTURE_STATE_HEADER_PENDING,
+  TEXTURE_STATE_HEADER_READY,
+  TEXTURE_STATE_STREAMING,
+  TEXTURE_STATE_FAILED
+} typedef TextureState;
 
-const uint8_t globalQueueFamilyIndicesFieldCount = 2;
+struct {
+  char path[256];
+  int fd;
+  TextureState state;
+  TextureFileHeader header;
+  uint32_t firstMip; // finest file mip that has GPU memory behind it
+  uint32_t residentMip; // finest file mip that is sampleable, == mipCount when none
+  uint32_t uploadedMipsMask;
+  VkImage image;
+  VkDeviceMemory memory;
+  VkDeviceSize memorySize;
+  VkImageView view;
+} typedef Texture;
+
+enum {
+  TEXTURE_REQUEST_HEADER,
+  TEXTURE_REQUEST_MIP
+} typedef TextureRequestKind;
 
-QueueFamilyIndices queue_families_find(VkPhysicalDevice device, VkSurfaceKHR surface);
+struct {
+  TextureRequestKind kind;
+  uint32_t texture;
+  uint32_t mip;
+  uint64_t size;
+} typedef TextureRequest;
+
+enum {
+  STAGING_SLOT_FREE,
+  STAGING_SLOT_LOADING,
+  STAGING_SLOT_READY,
+  STAGING_SLOT_UPLOADING
+} typedef StagingSlotState;
 
+struct {
+  StagingSlotState state;
+  uint32_t texture;
+  uint32_t mip;
+  VkCommandBuffer commandBuffer;
+  VkFence fence;
+  uint32_t fenceSlot; // uploads flushed together share the fence of the first slot
+} typedef StagingSlot;
 
+struct {
+  VkImageView view;
+  uint64_t retiredFrame;
+} typedef RetiredImageView;
 
+// an image evicted under memory pressure, freed with its memory once no frame
+// in flight can still sample it
 struct {
-  VkSurfaceCapabilitiesKHR capabilities;
-  uint32_t formatsCount;
-  VkSurfaceFormatKHR* formats;
-  uint32_t presentModesCount;
-  VkPresentModeKHR* presentModes;
-} typedef SwapChainSupportDetails;
+  VkImage image;
+  VkDeviceMemory memory;
+  uint64_t retiredFrame;
+} typedef RetiredImage;
 
-SwapChainSupportDetails swap_chain_support_details_query(VkPhysicalDevice device, VkSurfaceKHR surface);
-void swap_chain_support_details_free(SwapChainSupportDetails details);
+struct {
+  VkDevice device;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  VkQueue transferQueue;
+  uint32_t transferFamily;
+  uint32_t graphicsFamily;
+  VkCommandPool commandPool;
 
+  VkBuffer stagingBuffer;
+  VkDeviceMemory stagingMemory;
+  uint8_t *stagingMapped;
+  StagingSlot slots[TEXTURE_STREAMER_RING_SLOTS];
+
+  Texture textures[TEXTURE_STREAMER_MAX_TEXTURES];
+  uint32_t texturesCount;
+
+  VkDeviceSize budget; // lowered under memory pressure, restored toward configuredBudget once it eases
+  VkDeviceSize configuredBudget;
+  VkDeviceSize committedBytes;
+
+  RetiredImageView retiredViews[TEXTURE_STREAMER_MAX_RETIRED_VIEWS];
+  uint32_t retiredViewsCount;
+  RetiredImage retiredImages[TEXTURE_STREAMER_MAX_RETIRED_IMAGES];
+  uint32_t retiredImagesCount;
+  uint64_t frame;
+
+  // everything below is shared with the io thread and guarded by mutex
+  pthread_t ioThread;
+  pthread_mutex_t mutex;
+  pthread_cond_t ioCond;
+  bool ioRunning;
+  TextureRequest requests[TEXTURE_STREAMER_MAX_REQUESTS];
+  uint32_t requestsCount;
+} typedef TextureStreamer;
+
+
+
+enum {
+  MEMORY_OBJECT_BUFFER,
+  MEMORY_OBJECT_IMAGE,
+  MEMORY_OBJECT_IMAGE_VIEW,
+  MEMORY_OBJECT_FRAMEBUFFER,
+  MEMORY_OBJECT_PIPELINE,
+  MEMORY_OBJECT_COUNT
+} typedef MemoryObjectType;
+
+const char *globalMemoryObjectNames[MEMORY_OBJECT_COUNT] = {
+  [MEMORY_OBJECT_BUFFER] = "buffers",
+  [MEMORY_OBJECT_IMAGE] = "images",
+  [MEMORY_OBJECT_IMAGE_VIEW] = "views",
+  [MEMORY_OBJECT_FRAMEBUFFER] = "framebuffers",
+  [MEMORY_OBJECT_PIPELINE] = "pipelines"
+};
 
+// asked to release at least bytes of device local memory, returns what it freed.
+// the relief side is told how many bytes are free below the low water mark and
+// returns how many of them it may grow into again
+typedef VkDeviceSize (*MemoryPressureCallback)(void *userData, VkDeviceSize bytes);
 
-static uint8_t *helper_read_file(const char *filename, size_t *filesize);
+struct {
+  VkDeviceMemory memory;
+  VkDeviceSize size;
+  uint32_t heap;
+} typedef MemoryAllocation;
 
+struct {
+  bool budgetSupported;
+  uint32_t heapsCount;
+  bool heapDeviceLocal[VK_MAX_MEMORY_HEAPS];
+  VkDeviceSize heapSize[VK_MAX_MEMORY_HEAPS];
+  VkDeviceSize heapAllocated[VK_MAX_MEMORY_HEAPS]; // through the tracker by this process
+  uint32_t heapAllocationsCount[VK_MAX_MEMORY_HEAPS];
+  VkDeviceSize heapBudget[VK_MAX_MEMORY_HEAPS]; // driver budget, heap size without VK_EXT_memory_budget
+  VkDeviceSize heapUsage[VK_MAX_MEMORY_HEAPS]; // driver usage, heapAllocated without VK_EXT_memory_budget
+  VkDeviceSize allocatedPeak;
+  uint64_t allocationsTotal;
+  uint64_t freesTotal;
+  int64_t liveObjects[MEMORY_OBJECT_COUNT];
+  uint32_t pressureEvents;
+  VkDeviceSize pressureBytesFreed;
+} typedef MemoryStats;
+
+// every vkAllocateMemory / vkFreeMemory goes through here so leaks and
+// over-budget heaps show up before the driver starts paging
+struct {
+  VkPhysicalDevice physicalDevice;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  pthread_mutex_t mutex;
+  MemoryAllocation allocations[MEMORY_TRACKER_MAX_ALLOCATIONS];
+  uint32_t allocationsCount;
+  MemoryStats stats;
 
+  MemoryPressureCallback pressureCallback;
+  MemoryPressureCallback reliefCallback;
+  void *pressureUserData;
+  uint32_t framesSincePressure;
+  uint32_t framesSinceReport;
+} typedef MemoryTracker;
 
-void app_run(App* app) {
-  app_private_init_window(app);
-  app_private_init_vulkan(app);
-  app_private_main_loop(app);
+MemoryTracker globalMemoryTracker;
 
-  vkDeviceWaitIdle(app->device);
 
-  app_private_cleanup(app);
-}
 
-void app_private_init_window(App* app) {
-  glfwInit();
+#define DEBUG_LOG_RING_SIZE 256
+#define DEBUG_LOG_MESSAGE_SIZE 512
+#define DEBUG_LOG_ID_SLOTS 512 // open addressing, messages past this are never deduplicated
+#define DEBUG_LOG_REPEAT_LIMIT 3 // occurrences of one message printed before it is only counted
 
-  glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-  glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+enum {
+  DEBUG_LOG_SEVERITY_VERBOSE,
+  DEBUG_LOG_SEVERITY_INFO,
+  DEBUG_LOG_SEVERITY_WARNING,
+  DEBUG_LOG_SEVERITY_ERROR
+} typedef DebugLogSeverity;
 
-  app->window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Vulkan", NULL, NULL);
-}
+struct {
+  VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+  int32_t messageId;
+  uint32_t occurrence;
+  char text[DEBUG_LOG_MESSAGE_SIZE];
+} typedef DebugLogEntry;
+
+// one message is its id together with a hash of its name and text, so
+// different messages sharing an id, or an id of 0, are counted apart
+struct {
+  int32_t messageId;
+  uint64_t hash;
+  uint32_t count;
+  bool used;
+} typedef DebugLogIdCount;
+
+// validation messages arrive on whatever thread made the vulkan call, so the
+// callback only copies them into the ring and a writer thread prints them.
+// nothing here blocks on stdout or allocates
+struct {
+  VkDebugUtilsMessageSeverityFlagsEXT severityMask; // also what the messenger subscribes to
+  uint32_t rateLimit; // messages per second, 0 for unlimited. errors are never limited, deduplicated or dropped
 
-void app_private_init_vulkan(App* app) {
-  app_private_init_vulkan_create_instance(app);
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t available;
+  bool running;
 
-  if(globalValidationLayersEnabled)
-    app_private_init_vulkan_setup_debug_messenger(app);
+  DebugLogEntry ring[DEBUG_LOG_RING_SIZE];
+  uint32_t head; // next entry to fill
+  uint32_t tail; // next entry to print
 
-  app_private_init_vulkan_create_surface(app);
-  app_private_init_vulkan_pick_device(app);
-  app_private_init_vulkan_create_logical_device(app);
-  app_private_init_vulkan_create_swap_chain(app);
-  app_private_init_vulkan_create_image_views(app);
-  app_private_init_vulkan_create_render_pass(app);
-  app_private_init_vulkan_create_graphics_pipeline(app);
-  app_private_init_vulkan_create_frame_buffers(app);
-  app_private_init_vulkan_create_command_pool(app);
-  app_private_init_vulkan_create_command_buffer(app);
-  app_private_init_vulkan_create_sync_objects(app);
-}
+  DebugLogIdCount ids[DEBUG_LOG_ID_SLOTS];
+  uint64_t rateWindowStart;
+  uint32_t rateWindowCount;
 
-void app_private_init_vulkan_create_instance(App* app) {
-  if(globalValidationLayersEnabled
-     && !app_private_init_vulkan_create_instance_check_layer_support()
-  ){
-    printf("validation layers unavailable\n");
-    exit(1);
-  }
+  uint64_t suppressedRepeats;
+  uint64_t droppedRate;
+  uint64_t droppedFull;
+} typedef DebugLogger;
 
-  VkApplicationInfo appInfo;
-  appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-  appInfo.pApplicationName = "Hello Triangle";
-  appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.pEngineName = "No Engine";
-  appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
-  appInfo.pNext = NULL;
+DebugLogger globalDebugLogger;
 
-  VkInstanceCreateInfo createInfo;
-  createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-  createInfo.pApplicationInfo = &appInfo;
 
-  uint32_t glfwExtensionsCount = 0;
-  const char **glfwExtensions;
 
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
+#define JOB_SYSTEM_MAX_THREADS 32 // the main thread included
+#define JOB_SYSTEM_MAX_JOBS 256 // between waits, also the deque size so a deque can never fill up
+#define JOB_SYSTEM_MAX_DEPENDENTS 8
+#define JOB_SYSTEM_MAX_NAMES 16 // distinct job names timed, the rest are only counted in the totals
+#define JOB_SYSTEM_SPIN_ROUNDS 64 // empty looks an idle worker yields through before it sleeps
+#define JOB_SYSTEM_REPORT_WAITS 600 // one wait per frame
 
-  const char **debugGlfwExtensions = calloc(glfwExtensionsCount + 1, sizeof(char *));
-  CHECK_ALLOC_FOR_NULL(debugGlfwExtensions);
+typedef void (*JobFunction)(void *data);
 
-  VkDebugUtilsMessengerCreateInfoEXT debugMessengerCreateInfo = app_private_populate_debug_messenger_info();
-  if (globalValidationLayersEnabled) {
-    for(int i = 0; i < glfwExtensionsCount; i++){
-      debugGlfwExtensions[i] = glfwExtensions[i];
-    }
-    debugGlfwExtensions[glfwExtensionsCount] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+struct {
+  const char *name; // timings are summed per name
+  JobFunction function;
+  void *data;
+  atomic_uint pendingCount; // unfinished dependencies, plus one until the job is submitted
+  uint32_t dependents[JOB_SYSTEM_MAX_DEPENDENTS];
+  uint32_t dependentsCount;
+  uint64_t startTime;
+  uint64_t endTime;
+} typedef Job;
+
+// chase-lev work stealing deque of job indices: the owning thread pushes and
+// pops at the bottom, every other thread steals from the top. no job passes
+// through a deque twice between waits, so the ring never laps a live entry
+struct {
+  alignas(64) _Atomic int64_t top;
+  alignas(64) _Atomic int64_t bottom;
+  atomic_uint jobs[JOB_SYSTEM_MAX_JOBS];
+} typedef JobDeque;
 
-    createInfo.enabledLayerCount = globalValidationLayersCount;
-    createInfo.ppEnabledLayerNames = globalValidationLayers;
-    createInfo.enabledExtensionCount = glfwExtensionsCount + 1;
-    createInfo.ppEnabledExtensionNames = debugGlfwExtensions;
-    createInfo.pNext = &debugMessengerCreateInfo;
-  } else {
-    createInfo.enabledLayerCount = 0;
-    createInfo.enabledExtensionCount = glfwExtensionsCount;
-    createInfo.ppEnabledExtensionNames = glfwExtensions;
-    createInfo.pNext = NULL;
-  }
+struct {
+  void *system;
+  uint32_t index;
+} typedef JobWorker;
+
+// frame work split into jobs with dependency counters. jobs are added and
+// linked on the main thread, a job becomes runnable when its last dependency
+// finishes and lands on the deque of the thread that finished it. the main
+// thread is thread 0 and runs jobs too while it waits; there are no fibers,
+// a job runs to completion and waiting is only done by the main thread
+struct {
+  uint32_t threadsCount;
+  pthread_t threads[JOB_SYSTEM_MAX_THREADS];
+  JobWorker workers[JOB_SYSTEM_MAX_THREADS];
+  JobDeque deques[JOB_SYSTEM_MAX_THREADS];
+
+  Job jobs[JOB_SYSTEM_MAX_JOBS];
+  uint32_t jobsCount; // main thread only
+  atomic_uint unfinishedCount;
+  atomic_bool running;
+
+  // idle workers sleep here. every push bumps the generation, so a worker
+  // that looked while a job was being pushed sees it changed and looks again
+  pthread_mutex_t sleepMutex;
+  pthread_cond_t sleepCondition;
+  atomic_uint generation;
+  atomic_uint sleepingCount;
+
+  // since the last report
+  const char *names[JOB_SYSTEM_MAX_NAMES];
+  double nameTimesMs[JOB_SYSTEM_MAX_NAMES];
+  uint32_t namesCount;
+  uint32_t waitsSinceReport;
+  double jobTimeMs; // summed over every job
+  double wallTimeMs; // first start to last end of each wait, summed
+} typedef JobSystem;
 
-  if(vkCreateInstance(&createInfo, NULL, &app->instance) != VK_SUCCESS) {
-    printf("failed to create instance\n");
-    exit(1);
-  }
 
-  free(debugGlfwExtensions);
-}
 
-bool app_private_init_vulkan_create_instance_check_layer_support() {
-  uint32_t availableLayersCount;
-  vkEnumerateInstanceLayerProperties(&availableLayersCount, NULL);
+struct {
+  uint8_t *base;
+  size_t capacity;
+  size_t offset;
+} typedef Arena;
 
-  VkLayerProperties* availableLayers = calloc(availableLayersCount, sizeof(VkLayerProperties));
-  CHECK_ALLOC_FOR_NULL(availableLayers);
-  vkEnumerateInstanceLayerProperties(&availableLayersCount, availableLayers);
+struct {
+  float m[16]; // column major
+} typedef Mat4;
 
-  for(int i = 0; i < globalValidationLayersCount; i++) {
-    bool layerFound = false;
+struct {
+  Mat4 viewProjection;
+  float cameraPosition[4]; // w unused, only meshlet cone culling reads it
+} typedef MeshPushConstants;
 
-    for(int j = 0; j < availableLayersCount; j++) {
-      if(strcmp(globalValidationLayers[i], availableLayers[j].layerName) == 0) {
-        layerFound = true;
-        break;
-      }
-    }
-    if(!layerFound) {
-      free(availableLayers);
-      return false;
-    }
-  }
-  if(availableLayers != NULL)
-    free(availableLayers);
+struct {
+  int fd;
+  uint8_t *mapped;
+  size_t size;
+  const MeshFileHeader *header;
+} typedef MeshFile;
 
-  return true;
-}
+struct {
+  bool loaded;
+  VkBuffer vertexBuffer;
+  VkDeviceMemory vertexMemory;
+  VkBuffer indexBuffer;
+  VkDeviceMemory indexMemory;
+  uint32_t indexCount;
+  uint32_t vertexStride;
+  uint32_t attributesCount;
+  VkVertexInputAttributeDescription attributes[MESH_MAX_ATTRIBUTES];
+  float boundsMin[3];
+  float boundsMax[3];
+
+  // meshlet sections of the file, storage buffers for the culling shaders
+  uint32_t meshletsCount;
+  VkBuffer meshletBuffer;
+  VkDeviceMemory meshletMemory;
+  VkBuffer meshletVertexBuffer;
+  VkDeviceMemory meshletVertexMemory;
+  VkBuffer meshletTriangleBuffer;
+  VkDeviceMemory meshletTriangleMemory;
+  int32_t positionOffset; // bytes into a vertex, -1 when the attribute is missing
+  int32_t normalOffset;
+  int32_t texcoordOffset;
+} typedef Mesh;
+
+// set MESH_TEXTURE_SET of the mesh pipelines: the streamed texture once its
+// coarsest mips are resident, a white texel before that. one set per frame in
+// flight, rewritten when the streamer swaps in a view with finer mips
+struct {
+  VkDescriptorSetLayout setLayout;
+  VkDescriptorSetLayout emptySetLayout; // the vertex path's sets below the texture
+  VkDescriptorPool descriptorPool;
+  VkDescriptorSet sets[MAX_FRAMES_IN_FLIGHT];
+  VkImageView boundViews[MAX_FRAMES_IN_FLIGHT];
+  VkSampler sampler;
+  VkImage fallbackImage;
+  VkDeviceMemory fallbackMemory;
+  VkImageView fallbackView;
+} typedef MeshTexture;
+
+enum {
+  DRAW_COMMAND_PLAIN,
+  DRAW_COMMAND_MESHLETS // the whole mesh, culled per meshlet when the device has a meshlet path
+} typedef DrawCommandKind;
 
-void app_private_init_vulkan_setup_debug_messenger(App *app) {
-  VkDebugUtilsMessengerCreateInfoEXT createInfo = app_private_populate_debug_messenger_info();
+struct {
+  DrawCommandKind kind;
+  VkPipeline pipeline;
+  VkPipelineLayout layout;
+  VkBuffer vertexBuffer;
+  VkBuffer indexBuffer;
+  uint32_t count; // indices when indexBuffer is set, vertices otherwise
+  uint32_t instanceCount;
+  bool hasPushConstants;
+  MeshPushConstants pushConstants;
+} typedef DrawCommand;
 
-  PFN_vkCreateDebugUtilsMessengerEXT func = (PFN_vkCreateDebugUtilsMessengerEXT)
-    vkGetInstanceProcAddr(app->instance, "vkCreateDebugUtilsMessengerEXT");
+struct {
+  DrawCommand *commands;
+  uint32_t count;
+  uint32_t capacity;
+} typedef DrawList;
 
-  if (func != NULL) {
-    func(app->instance, &createInfo, NULL, &app->debugMessenger);
-  } else {
-    printf("failed to set up messenger\n");
-    exit(1);
-  }
-}
 
-void app_private_init_vulkan_create_surface(App *app) {
-  if(glfwCreateWindowSurface(app->instance, app->window, NULL, &app->surface) != VK_SUCCESS) {
-    printf("failed to create window");
-    exit(1);
-  }
-}
 
-void app_private_init_vulkan_pick_device(App *app) {
-  uint32_t deviceCount = 0;
-  vkEnumeratePhysicalDevices(app->instance, &deviceCount, NULL);
+// .vktrace layout, written by --capture and read back by --replay:
+//
+//   TraceFileHeader
+//   per frame: TraceFrameHeader, then commandsCount TraceDrawCommand records,
+//              each followed by MeshPushConstants when it has push constants
+//
+// vulkan handles are stored as indices into TraceHandles, so a trace replays
+// against the objects a fresh process creates from the same assets
+struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t format; // VkFormat of the captured swapchain
+  uint32_t presentMode;
+  uint32_t framesCount; // patched when the capture is closed
+  uint32_t reserved;
+  char meshPath[128];
+} typedef TraceFileHeader;
 
-  if(deviceCount == 0) {
-    printf("failed to find GPU with vulkan support");
-    exit(1);
-  }
+struct {
+  uint32_t magic;
+  uint32_t commandsCount;
+  uint64_t timeNs; // since the capture started
+  uint64_t cpuTimeNs; // since the previous captured frame
+  uint32_t width;
+  uint32_t height;
+  uint32_t presentMode;
+  uint32_t imageIndex;
+} typedef TraceFrameHeader;
 
-  VkPhysicalDevice* devices = calloc(deviceCount, sizeof(VkPhysicalDevice));
-  CHECK_ALLOC_FOR_NULL(devices);
-  vkEnumeratePhysicalDevices(app->instance, &deviceCount, devices);
+#define TRACE_COMMAND_PUSH_CONSTANTS 1u
+#define TRACE_COMMAND_MESHLETS 2u
 
-  bool devicePicked = false;
+struct {
+  uint16_t pipeline; // index into TraceHandles pipelines and layouts
+  uint16_t vertexBuffer; // index into TraceHandles buffers, 0 is VK_NULL_HANDLE
+  uint16_t indexBuffer;
+  uint16_t flags;
+  uint32_t count;
+  uint32_t instanceCount;
+} typedef TraceDrawCommand;
 
-  for(int i = 0; i < deviceCount; i++) {
-    QueueFamilyIndices indices = queue_families_find(devices[i], app->surface);
+struct {
+  uint32_t pipelinesCount;
+  VkPipeline pipelines[TRACE_MAX_HANDLES];
+  VkPipelineLayout layouts[TRACE_MAX_HANDLES];
+  uint32_t buffersCount;
+  VkBuffer buffers[TRACE_MAX_HANDLES];
+} typedef TraceHandles;
 
-    SwapChainSupportDetails details = swap_chain_support_details_query(devices[i], app->surface);
+struct {
+  FILE *file;
+  char buffer[TRACE_WRITE_BUFFER_SIZE]; // stdio buffer, keeps writes out of the frame loop's heap
+  TraceFileHeader header;
+  uint64_t startTime;
+  uint64_t lastFrameTime;
+  bool failed;
+} typedef TraceRecorder;
 
-    if(indices.isComplete
-       && app_private_init_vulkan_pick_device_check_device_extensions(devices[i])
-       && details.formatsCount != 0 && details.presentModesCount != 0
-    ){
-      app->physicalDevice = devices[i];
-      devicePicked = true;
-      break;
-    }
-    swap_chain_support_details_free(details);
-  }
+struct {
+  int fd;
+  uint8_t *mapped;
+  size_t size;
+  const TraceFileHeader *header;
+  uint64_t *frameOffsets;
+  uint32_t framesCount;
+} typedef TracePlayer;
+
+enum {
+  REPLAY_TIMING_FAST, // submit frames back to back
+  REPLAY_TIMING_ORIGINAL // sleep to reproduce the captured frame intervals
+} typedef ReplayTiming;
+
+
+
+// how a pass touches a resource; every access maps to a fixed stage, access
+// mask and layout in globalFrameGraphAccessInfos
+enum {
+  FRAME_GRAPH_ACCESS_COLOR_ATTACHMENT_WRITE,
+  FRAME_GRAPH_ACCESS_DEPTH_ATTACHMENT_WRITE,
+  FRAME_GRAPH_ACCESS_DEPTH_ATTACHMENT_READ,
+  FRAME_GRAPH_ACCESS_FRAGMENT_SAMPLED_READ,
+  FRAME_GRAPH_ACCESS_COMPUTE_SAMPLED_READ,
+  FRAME_GRAPH_ACCESS_TASK_SAMPLED_READ, // only valid with VK_EXT_mesh_shader
+  FRAME_GRAPH_ACCESS_COMPUTE_STORAGE_READ,
+  FRAME_GRAPH_ACCESS_COMPUTE_STORAGE_WRITE,
+  FRAME_GRAPH_ACCESS_TRANSFER_READ,
+  FRAME_GRAPH_ACCESS_TRANSFER_WRITE,
+  FRAME_GRAPH_ACCESS_PRESENT,
+  FRAME_GRAPH_ACCESS_COUNT
+} typedef FrameGraphAccess;
 
-  if(!devicePicked) {
-    printf("suitable device not found\n");
-    exit(1);
-  }
+struct {
+  VkPipelineStageFlags stages;
+  VkAccessFlags access;
+  VkImageLayout layout;
+  VkImageUsageFlags usage;
+  bool write;
+} typedef FrameGraphAccessInfo;
 
-  free(devices);
-}
+struct {
+  const char *name;
+  bool imported;
+  VkFormat format;
+  VkExtent2D extent;
+  VkImageAspectFlags aspect;
+  uint32_t mipLevels; // transient only, barriers always cover every level
+  VkImageUsageFlags usage; // transient only, collected from the accesses
+  VkImage image; // imported images may change every frame, VK_NULL_HANDLE leaves them out of it
+  VkImageView view;
+
+  // state an imported image arrives in and must be left in
+  VkImageLayout initialLayout;
+  VkPipelineStageFlags initialStages;
+  VkImageLayout finalLayout;
+
+  // filled by frame_graph_compile
+  bool used;
+  uint32_t firstPass;
+  uint32_t lastPass;
+  VkDeviceSize memoryOffset;
+  VkDeviceSize memorySize;
+  VkDeviceSize memoryAlignment;
+  uint32_t memoryTypeBits;
+} typedef FrameGraphResource;
 
-bool app_private_init_vulkan_pick_device_check_device_extensions(VkPhysicalDevice device) {
-  uint32_t availableExtensionsCount;
-  vkEnumerateDeviceExtensionProperties(device, NULL, &availableExtensionsCount, NULL);
+struct {
+  uint32_t resource;
+  FrameGraphAccess access;
+} typedef FrameGraphResourceAccess;
+
+// passData is fixed when the pass is declared, frameData is whatever the
+// caller hands to frame_graph_execute for this frame
+typedef void (*FrameGraphPassExecute)(VkCommandBuffer commandBuffer, void *passData, void *frameData);
+
+enum {
+  FRAME_GRAPH_QUEUE_GRAPHICS,
+  FRAME_GRAPH_QUEUE_COMPUTE, // async compute when the device has a separate family, graphics otherwise
+  FRAME_GRAPH_QUEUE_COUNT
+} typedef FrameGraphQueue;
+
+// consecutive surviving passes on one queue, recorded into one command buffer
+// and submitted with a semaphore to the next segment
+struct {
+  FrameGraphQueue queue;
+  uint32_t firstPass;
+  uint32_t lastPass;
+} typedef FrameGraphSegment;
 
-  VkExtensionProperties* availableExtensions = calloc(availableExtensionsCount, sizeof(VkExtensionProperties));
-  CHECK_ALLOC_FOR_NULL(availableExtensions);
-  vkEnumerateDeviceExtensionProperties(device, NULL, &availableExtensionsCount, availableExtensions);
+struct {
+  VkPipelineStageFlags srcStages;
+  VkPipelineStageFlags dstStages;
+  uint32_t barriersCount;
+  uint32_t barrierResources[FRAME_GRAPH_MAX_PASS_ACCESSES]; // barriers[i].image is patched from this at execute time
+  VkImageMemoryBarrier barriers[FRAME_GRAPH_MAX_PASS_ACCESSES];
+} typedef FrameGraphBarrierBatch;
 
-  for (int i = 0; i < globalDeviceExtensionCount; i++) {
-    bool extensionFound = false;
+struct {
+  const char *name;
+  FrameGraphPassExecute execute;
+  void *passData;
+  FrameGraphQueue queue;
+  uint32_t accessesCount;
+  FrameGraphResourceAccess accesses[FRAME_GRAPH_MAX_PASS_ACCESSES];
+
+  bool sideEffects; // writes something outside the graph, never culled
+  bool culled;
+  FrameGraphBarrierBatch before;
+} typedef FrameGraphPass;
 
-    for(int j = 0; j < availableExtensionsCount; j++) {
-      if(strcmp(globalDeviceExtensions[i], availableExtensions[j].extensionName) == 0) {
-        extensionFound = true;
-        break;
-      }
-    }
-    if(!extensionFound) {
-      free(availableExtensions);
-      return false;
-    }
-  }
-  if(availableExtensions != NULL)
-    free(availableExtensions);
+struct {
+  uint32_t passesCount;
+  uint32_t culledPassesCount;
+  uint32_t barriersCount;
+  uint32_t barrierBatchesCount;
+  VkDeviceSize transientMemorySize;
+  VkDeviceSize transientMemorySizeUnaliased;
+  double passGpuTimesMs[FRAME_GRAPH_MAX_PASSES]; // smoothed, 0 for passes without timestamps
+  double gpuFrameTimeMs; // sum of the last collected frame's timed passes, 0 when none came back
+} typedef FrameGraphStats;
+
+// passes run in declaration order. compile culls passes whose results nobody
+// consumes, places transient images into one aliased allocation and turns the
+// declared accesses into one barrier batch per pass plus a final batch that
+// returns imported images to their final layout
+struct {
+  VkDevice device;
+  const VkPhysicalDeviceMemoryProperties *memoryProperties;
+
+  uint32_t resourcesCount;
+  FrameGraphResource resources[FRAME_GRAPH_MAX_RESOURCES];
+  uint32_t passesCount;
+  FrameGraphPass passes[FRAME_GRAPH_MAX_PASSES];
+  FrameGraphBarrierBatch after;
+  uint32_t segmentsCount;
+  FrameGraphSegment segments[FRAME_GRAPH_MAX_SEGMENTS];
+
+  // transient images are shared CONCURRENT when the two queues differ, so
+  // crossing queues needs semaphores but no ownership transfers
+  uint32_t queueFamilies[FRAME_GRAPH_QUEUE_COUNT];
+
+  // two timestamps per pass, one pool per frame in flight
+  bool timestampsEnabled[FRAME_GRAPH_QUEUE_COUNT];
+  float timestampPeriod;
+  VkQueryPool queryPools[MAX_FRAMES_IN_FLIGHT];
+  bool queryPoolsWritten[MAX_FRAMES_IN_FLIGHT];
+  uint32_t framesSinceReport;
+
+  VkDeviceMemory transientMemory;
+  FrameGraphStats stats;
+} typedef FrameGraph;
 
-  return true;
-}
+struct {
+  void *app;
+  DrawList *drawLists; // one per output, each with its own aspect
+} typedef FrameContext;
 
-void app_private_init_vulkan_create_logical_device(App *app) {
-  QueueFamilyIndices indices = queue_families_find(app->physicalDevice, app->surface);
+// data of one frame job, index is the output or the segment it works on
+struct {
+  void *app;
+  DrawList *drawLists;
+  uint32_t index;
+  uint32_t chunk; // of the output's draw list, draw record jobs only
+} typedef FrameJob;
 
-  uint8_t uniqueQueueFamilesCount = 0;
-  uint32_t *uniqueQueueFamilies = malloc(sizeof(uint32_t));
-  CHECK_ALLOC_FOR_NULL(uniqueQueueFamilies);
 
-  if (indices.graphicsFamily == indices.presentFamily) {
-    uniqueQueueFamilies[0] = indices.graphicsFamily;
-    uniqueQueueFamilesCount = 1;
-  } else {
-    uniqueQueueFamilies = realloc(uniqueQueueFamilies, 2 * sizeof(uint32_t));
-    CHECK_ALLOC_FOR_NULL(uniqueQueueFamilies);
-    uniqueQueueFamilies[0] = indices.graphicsFamily;
-    uniqueQueueFamilies[1] = indices.presentFamily;
-    uniqueQueueFamilesCount = 2;
-  }
 
-  VkDeviceQueueCreateInfo *queueCreateInfos = calloc(globalQueueFamilyIndicesFieldCount, sizeof(VkDeviceQueueCreateInfo));
-  CHECK_ALLOC_FOR_NULL(queueCreateInfos);
+struct {
+  float exposure;
+  float bloomThreshold;
+  float bloomStrength;
+  uint32_t renderWidth; // the part of the scene image rendered this frame
+  uint32_t renderHeight;
+} typedef PostProcessPushConstants;
+
+enum {
+  POST_PASS_DOWNSAMPLE,
+  POST_PASS_BLUR,
+  POST_PASS_TONEMAP,
+  POST_PASS_COUNT
+} typedef PostPassKind;
 
-  float queuePriority = 1.0f;
+struct {
+  VkPipeline pipeline;
+  VkPipelineLayout layout;
+  VkDescriptorSet descriptorSet;
+  const PostProcessPushConstants *pushConstants;
+  uint32_t groupsX; // follow the render extent, set every frame
+  uint32_t groupsY;
+} typedef PostProcessPass;
+
+// per output images and descriptor sets, the pipelines are shared
+struct {
+  PostProcessPass passes[POST_PASS_COUNT];
+  PostProcessPushConstants pushConstants; // the shared values plus this output's render extent
+
+  // frame graph resources, valid between graph rebuilds
+  uint32_t sceneImage;
+  uint32_t bloomImage;
+  uint32_t bloomBlurredImage;
+  uint32_t outputImage;
+  VkFramebuffer sceneFrameBuffer;
+} typedef PostProcessTargets;
+
+// the scene is rendered into an hdr storage image, bloom + tonemap run as
+// compute passes, and the result is blitted into the swapchain image
+struct {
+  bool enabled;
+  bool asyncCompute;
+  VkDescriptorSetLayout setLayout;
+  VkPipelineLayout pipelineLayout;
+  VkDescriptorPool descriptorPool; // POST_PASS_COUNT sets per output
+  VkPipeline pipelines[POST_PASS_COUNT];
+  PostProcessPushConstants pushConstants;
+} typedef PostProcess;
+
+const char *globalPostShaderPaths[POST_PASS_COUNT] = {
+  [POST_PASS_DOWNSAMPLE] = "shaders/post_downsample_comp.spv",
+  [POST_PASS_BLUR] = "shaders/post_blur_comp.spv",
+  [POST_PASS_TONEMAP] = "shaders/post_tonemap_comp.spv"
+};
 
-  for(int i = 0; i < uniqueQueueFamilesCount; i++) {
-    queueCreateInfos[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    queueCreateInfos[i].queueFamilyIndex = uniqueQueueFamilies[i];
-    queueCreateInfos[i].queueCount = 1;
-    queueCreateInfos[i].pQueuePriorities = &queuePriority;
-    queueCreateInfos[i].pNext = NULL;
-    queueCreateInfos[i].flags = 0;
-  }
 
-  VkDeviceCreateInfo createInfo;
-  createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
-  createInfo.queueCreateInfoCount = uniqueQueueFamilesCount;
-  createInfo.pQueueCreateInfos = queueCreateInfos;
+enum {
+  MESHLET_PATH_NONE, // the mesh is one indexed draw
+  MESHLET_PATH_MESH_SHADER, // task shader culls, mesh shader expands the survivors
+  MESHLET_PATH_COMPUTE // compute culls into indexed indirect draws before the render pass
+} typedef MeshletPath;
 
-  app->deviceFeatures = (VkPhysicalDeviceFeatures) {VK_FALSE};
-  createInfo.pEnabledFeatures = &app->deviceFeatures;
+// shared by meshlet_cull.comp, meshlet.task and meshlet.mesh
+struct {
+  MeshPushConstants mesh;
+  uint32_t meshletsCount;
+  uint32_t firstDraw; // compute path, first indirect command of this frame, output and phase
+  uint32_t statsIndex;
+  uint32_t instanceCount;
+  uint32_t phase; // MeshletPhase, the rest only matters with occlusion culling
+  uint32_t firstVisibility;
+  uint32_t depthWidth;
+  uint32_t depthHeight;
+} typedef MeshletPushConstants;
+
+struct {
+  uint32_t visibleMeshlets;
+  uint32_t visibleTriangles;
+  uint32_t occludedMeshlets;
+} typedef MeshletStats;
+
+// with occlusion culling the meshlets are drawn in two render passes around
+// the depth pyramid build. without it everything is drawn in the early one
+enum {
+  MESHLET_PHASE_EARLY, // what survived last frame's late phase, tested against the frustum only
+  MESHLET_PHASE_LATE, // the rest, tested against the pyramid of the early phase's depth
+  MESHLET_PHASE_COUNT
+} typedef MeshletPhase;
+
+// culls the mesh per meshlet so hidden clusters never reach the rasterizer.
+// draw commands of kind DRAW_COMMAND_MESHLETS keep naming the plain mesh
+// pipeline and buffers, the main pass swaps in whichever path was picked, so
+// captured traces replay on devices with either path or none
+struct {
+  MeshletPath path;
+  VkDescriptorSetLayout setLayout;
+  VkPipelineLayout pipelineLayout;
+  VkPipeline pipeline; // task + mesh graphics pipeline, or the cull compute pipeline
+  VkDescriptorPool descriptorPool;
+  VkDescriptorSet descriptorSet;
+
+  PFN_vkCmdDrawMeshTasksEXT drawMeshTasks;
+  uint32_t maxDrawIndirectCount; // 1 without multiDrawIndirect
+
+  // compute path, meshletsCount commands per frame in flight, output and phase
+  VkBuffer drawBuffer;
+  VkDeviceMemory drawMemory;
+
+  // two phase hi-z occlusion culling, see app_private_frame_graph_hiz_pass
+  bool occlusion;
+  VkBuffer visibilityBuffer; // one uint per output and meshlet, written by the late phase
+  VkDeviceMemory visibilityMemory;
+  VkDescriptorSetLayout pyramidSetLayout; // set 1 of the culling pipeline, the output's pyramid
+  VkDescriptorSetLayout hizSetLayout;
+  VkPipelineLayout hizPipelineLayout;
+  VkPipeline hizPipeline;
+  VkSampler hizSampler; // the shaders only texelFetch, any sampler does
+
+  // one MeshletStats per frame in flight and output, read back once the frame's fence signalled
+  VkBuffer statsBuffer;
+  VkDeviceMemory statsMemory;
+  MeshletStats *stats;
+  uint64_t submittedTriangles[MAX_FRAMES_IN_FLIGHT];
+
+  uint32_t framesSinceReport;
+  uint64_t reportSubmittedTriangles;
+  uint64_t reportVisibleTriangles;
+  uint64_t reportVisibleMeshlets;
+  uint64_t reportOccludedMeshlets;
+} typedef MeshletRenderer;
+
+// per output depth pyramid of the occlusion culling, valid between graph rebuilds
+struct {
+  uint32_t pyramidImage; // frame graph resource
+  VkExtent2D pyramidExtent; // of mip 0, half the depth buffer rounded up
+  uint32_t mipsCount;
+  VkImageView mipViews[HIZ_MAX_MIPS];
+  VkDescriptorPool descriptorPool;
+  VkDescriptorSet reduceSets[HIZ_MAX_MIPS]; // mip i reads the depth buffer for i = 0, mip i - 1 otherwise
+  VkDescriptorSet cullSet; // the whole pyramid, for the late phase
+} typedef HizTargets;
+
+
+
+enum {
+  PRESENT_POLICY_LOW_LATENCY, // IMMEDIATE, else MAILBOX, CPU waits for the previous present
+  PRESENT_POLICY_POWER_SAVING, // FIFO, frame rate capped to frameCap
+  PRESENT_POLICY_FIFO_RELAXED // FIFO_RELAXED, tears instead of stalling when late
+} typedef PresentPolicy;
+
+struct {
+  PresentPolicy policy;
+  uint32_t frameCap; // frames per second, PRESENT_POLICY_POWER_SAVING only
+  VkPresentModeKHR presentMode;
+  uint32_t imageCount;
+
+  bool presentWaitEnabled;
+  PFN_vkWaitForPresentKHR waitForPresent;
+  uint64_t presentId; // last id handed to vkQueuePresentKHR, restarts with every swapchain
+
+  uint64_t frameStartTime;
+  uint64_t inputTimes[FRAME_PACER_HISTORY]; // indexed by presentId % FRAME_PACER_HISTORY
+  uint64_t pendingLatencyPresentId; // 0 when nothing is waiting to be measured
+
+  // input-to-present latency since the last report
+  uint64_t lastReportTime;
+  uint32_t latencySamples;
+  double latencySumMs;
+  double latencyMaxMs;
+} typedef FramePacer;
+
+// dynamic resolution: picks the fraction of the swapchain size the scene is
+// rendered at so the gpu frame time stays at targetMs. timings arrive frames
+// in flight late, so each is judged against the scale its frame rendered with
+struct {
+  bool enabled;
+  double targetMs;
+  double minScale;
+  double scale; // per axis, 1 when disabled
+  double frameScales[MAX_FRAMES_IN_FLIGHT];
+
+  uint32_t framesSinceReport;
+  uint32_t timedFrames;
+  double scaleSum;
+  double gpuTimeSumMs;
+} typedef ResolutionController;
+
+enum {
+  RENDER_MODE_CONTINUOUS, // draw every loop iteration, paced by the present mode
+  RENDER_MODE_ON_DEMAND // sleep in glfwWaitEvents until something marks the frame dirty
+} typedef RenderMode;
+
+enum {
+  VALIDATION_MODE_OFF,
+  VALIDATION_MODE_FULL, // every check of the khronos layer
+  VALIDATION_MODE_SYNC // VK_EXT_validation_features synchronization validation only
+} typedef ValidationMode;
+
+enum {
+  MESHLET_MODE_AUTO, // mesh shaders when the device has them, compute culling otherwise
+  MESHLET_MODE_MESH_SHADER,
+  MESHLET_MODE_COMPUTE,
+  MESHLET_MODE_OFF
+} typedef MeshletMode;
+
+
+
+struct {
+  uint32_t graphicsFamily;
+  uint32_t presentFamily;
+  uint32_t transferFamily; // dedicated transfer family if there is one, graphics otherwise
+  uint32_t computeFamily; // compute family without graphics if there is one, graphics otherwise
+  bool isComplete;
+} typedef QueueFamilyIndices;
+
+const uint8_t globalQueueFamilyIndicesFieldCount = 2;
+
+struct {
+  VkSurfaceCapabilitiesKHR capabilities;
+  uint32_t formatsCount;
+  VkSurfaceFormatKHR* formats;
+  uint32_t presentModesCount;
+  VkPresentModeKHR* presentModes;
+} typedef SwapChainSupportDetails;
+
+// everything we ever ask the driver about a physical device, queried once at
+// pick time. surface data is for the primary output's surface and only drives
+// the pick, outputs keep their own swapchain support
+struct {
+  VkPhysicalDevice physicalDevice;
+  VkPhysicalDeviceProperties properties; // includes limits
+  VkPhysicalDeviceFeatures features;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  uint32_t queueFamiliesCount;
+  VkQueueFamilyProperties *queueFamilies;
+  uint32_t extensionsCount;
+  VkExtensionProperties *extensions;
+
+  VkSurfaceKHR surface;
+  VkBool32 *queueFamiliesPresentSupport; // same length as queueFamilies
+  QueueFamilyIndices queueFamilyIndices;
+  SwapChainSupportDetails swapChainSupport;
+
+  Arena arena; // surface dependent arrays live above surfaceMark
+  size_t surfaceMark;
+} typedef DeviceCapabilities;
+
+
+
+// one window and its swapchain. outputs share the device, pipelines, render
+// pass and frame graph, and all of them are presented with a single present
+struct {
+  GLFWwindow *window; // NULL when headless
+  VkSurfaceKHR surface;
+  Arena supportArena; // swapChainSupport formats and present modes, queried once
+  SwapChainSupportDetails swapChainSupport;
+  VkSwapchainKHR swapChain;
+  Arena swapChainArena; // images, views and framebuffers, reset on rebuild
+  bool framebufferResized;
+  VkImage* swapChainImages;
+  uint32_t swapChainImagesCount;
+  VkFormat swapChainImageFormat;
+  VkExtent2D swapChainExtent;
+  VkImageView* swapChainImageViews; //same length as swapChainImages
+  VkFramebuffer* swapChainFrameBuffers;
+  uint32_t swapChainFrameBuffersCount;
+  VkDeviceMemory *headlessImageMemory; // same length as swapChainImages when headless
+  VkSemaphore imageAvailableSemaphores[MAX_FRAMES_IN_FLIGHT];
+  // per swapchain image: a present may still wait on one after the frame's
+  // fence signalled, only acquiring the image again proves it was consumed.
+  // same length as swapChainImages, NULL when headless
+  VkSemaphore *renderFinishedSemaphores;
+  uint32_t imageIndex; // acquired for the frame being recorded
+  VkExtent2D renderExtent; // top left part of the scene targets drawn this frame, the blit scales it to the swapchain
+  uint32_t frameGraphSwapChainImage;
+  uint32_t frameGraphDepthImage;
+  PostProcessTargets post;
+  HizTargets hiz;
+
+  // headless --readback, one host visible copy of the target per frame in flight
+  VkBuffer readbackBuffers[MAX_FRAMES_IN_FLIGHT];
+  VkDeviceMemory readbackMemory[MAX_FRAMES_IN_FLIGHT];
+  const uint64_t *readbackMapped[MAX_FRAMES_IN_FLIGHT];
+  VkDeviceSize readbackSize;
+  bool readbackPending[MAX_FRAMES_IN_FLIGHT];
+} typedef Output;
+
+// --benchmark results, written once the run ends
+struct {
+  uint64_t startTime;
+  uint64_t initTime; // from app_run to the end of vulkan init
+  uint64_t firstFrameTime; // from app_run to the first frame submitted
+  uint64_t *frameTimes; // cpu time of every main loop iteration that drew
+  uint32_t frameTimesCount;
+  uint64_t loopTime;
+  uint64_t readbackChecksum; // keeps the host reads of --readback from being optimised out
+} typedef Benchmark;
+
+
+
+// everything that can change between runs without recompiling. defaults live
+// in globalConfig, the command line and config files override them by name
+struct {
+  uint32_t windowWidth; // also the headless target size
+  uint32_t windowHeight;
+  uint32_t outputsCount;
+  uint32_t framesInFlight;
+  PresentPolicy presentPolicy;
+  uint32_t powerSavingFrameCap; // frames per second, PRESENT_POLICY_POWER_SAVING only
+  RenderMode renderMode;
+  double animationTickRate; // redraws per second while on demand, 0 freezes animation
+  const char *device; // index or part of the name, NULL picks the first suitable device
+  bool headless;
+  uint32_t frames; // stop after this many frames, 0 runs until a window closes
+  uint32_t instances; // instance count of every scene draw
+  uint32_t draws; // copies of the scene draw, each its own draw call
+  uint32_t resizeInterval; // headless, frames between target resizes, 0 never resizes
+  bool readback; // headless, copy every finished frame into host memory
+  const char *benchmarkPath;
+  MeshletMode meshlets;
+  bool occlusion; // two phase hi-z occlusion culling of the meshlets
+  bool postProcess; // still off when the post shaders are missing
+  ValidationMode validation;
+  DebugLogSeverity logSeverity; // validation messages below this are never generated
+  uint32_t logRate;
+  bool gpuTimings;
+  uint32_t jobThreads; // frame job threads, the main thread included, 0 for one per core
+  double targetFrameMs; // dynamic resolution, 0 always renders at the swapchain size
+  double minRenderScale;
+  const char *meshPath;
+  const char *texturePath; // vktx file to stream, NULL leaves the streamer off
+  uint32_t textureBudgetMb; // device memory the streamed textures may commit
+  const char *capturePath;
+  const char *replayPath;
+  ReplayTiming replayTiming;
+  int64_t replayFrame; // replay only this frame, -1 for the whole trace
+  uint32_t replayRepeat;
+
+  char *files[CONFIG_MAX_FILES]; // loaded config files, string options point into them
+  uint32_t filesCount;
+} typedef AppConfig;
+
+enum {
+  CONFIG_OPTION_UINT,
+  CONFIG_OPTION_INT64,
+  CONFIG_OPTION_DOUBLE,
+  CONFIG_OPTION_BOOL,
+  CONFIG_OPTION_STRING,
+  CONFIG_OPTION_CHOICE // enum field, the value is looked up in choices
+} typedef ConfigOptionType;
+
+struct {
+  const char *name;
+  ConfigOptionType type;
+  size_t offset; // into AppConfig
+  uint32_t min; // CONFIG_OPTION_UINT only
+  uint32_t max;
+  const char *choices[4]; // in enum order, NULL terminated
+  const char *help;
+} typedef ConfigOption;
+
+AppConfig globalConfig = {
+  .windowWidth = WINDOW_WIDTH,
+  .windowHeight = WINDOW_HEIGHT,
+  .outputsCount = 1,
+  .framesInFlight = 2,
+  .presentPolicy = PRESENT_POLICY_LOW_LATENCY,
+  .powerSavingFrameCap = 30,
+  .renderMode = RENDER_MODE_CONTINUOUS,
+  .animationTickRate = 0.0,
+  .meshPath = "models/scene.vkmesh",
+  .textureBudgetMb = 256,
+  .instances = 1,
+  .draws = 1,
+  .meshlets = MESHLET_MODE_AUTO,
+  .occlusion = true,
+  .postProcess = true,
+#ifdef NDEBUG
+  .validation = VALIDATION_MODE_OFF,
+#else
+  .validation = VALIDATION_MODE_FULL,
+#endif
+  .logSeverity = DEBUG_LOG_SEVERITY_WARNING,
+  .logRate = 50,
+  .gpuTimings = true,
+  .targetFrameMs = 0.0,
+  .minRenderScale = 0.5,
+  .replayTiming = REPLAY_TIMING_FAST,
+  .replayFrame = -1,
+  .replayRepeat = 1
+};
+
+const ConfigOption globalConfigOptions[] = {
+  {"width", CONFIG_OPTION_UINT, offsetof(AppConfig, windowWidth), 1, 16384, {}, "window or headless target width"},
+  {"height", CONFIG_OPTION_UINT, offsetof(AppConfig, windowHeight), 1, 16384, {}, "window or headless target height"},
+  {"outputs", CONFIG_OPTION_UINT, offsetof(AppConfig, outputsCount), 1, MAX_OUTPUTS, {}, "windows presented together"},
+  {"frames-in-flight", CONFIG_OPTION_UINT, offsetof(AppConfig, framesInFlight), 1, MAX_FRAMES_IN_FLIGHT, {}, "frames the cpu may record ahead of the gpu"},
+  {"present", CONFIG_OPTION_CHOICE, offsetof(AppConfig, presentPolicy), 0, 0, {"low-latency", "power-saving", "fifo-relaxed"}, "present policy"},
+  {"frame-cap", CONFIG_OPTION_UINT, offsetof(AppConfig, powerSavingFrameCap), 0, 1000, {}, "frames per second with --present power-saving, 0 for vsync only"},
+  {"render-mode", CONFIG_OPTION_CHOICE, offsetof(AppConfig, renderMode), 0, 0, {"continuous", "on-demand"}, "draw every loop or only when something changed"},
+  {"animation-tick-rate", CONFIG_OPTION_DOUBLE, offsetof(AppConfig, animationTickRate), 0, 0, {}, "redraws per second while on demand"},
+  {"device", CONFIG_OPTION_STRING, offsetof(AppConfig, device), 0, 0, {}, "physical device index or part of its name"},
+  {"headless", CONFIG_OPTION_BOOL, offsetof(AppConfig, headless), 0, 0, {}, "render offscreen without a window, needs --frames"},
+  {"frames", CONFIG_OPTION_UINT, offsetof(AppConfig, frames), 0, UINT32_MAX, {}, "stop after this many frames, 0 runs until closed"},
+  {"instances", CONFIG_OPTION_UINT, offsetof(AppConfig, instances), 1, 1 << 20, {}, "instance count of every scene draw"},
+  {"draws", CONFIG_OPTION_UINT, offsetof(AppConfig, draws), 1, DRAW_LIST_MAX_COMMANDS, {}, "scene draws per frame, each its own draw call"},
+  {"resize-interval", CONFIG_OPTION_UINT, offsetof(AppConfig, resizeInterval), 0, UINT32_MAX, {}, "headless only, resize the target every this many frames"},
+  {"readback", CONFIG_OPTION_BOOL, offsetof(AppConfig, readback), 0, 0, {}, "headless only, copy every frame back to host memory"},
+  {"benchmark", CONFIG_OPTION_STRING, offsetof(AppConfig, benchmarkPath), 0, 0, {}, "write startup and frame time results to this file"},
+  {"meshlets", CONFIG_OPTION_CHOICE, offsetof(AppConfig, meshlets), 0, 0, {"auto", "mesh-shader", "compute", "off"}, "how the mesh is culled per meshlet"},
+  {"occlusion", CONFIG_OPTION_BOOL, offsetof(AppConfig, occlusion), 0, 0, {}, "cull meshlets hidden behind last frame's survivors against a depth pyramid"},
+  {"post-process", CONFIG_OPTION_BOOL, offsetof(AppConfig, postProcess), 0, 0, {}, "bloom and tonemapping in compute, off draws straight to the swapchain"},
+  {"validation", CONFIG_OPTION_CHOICE, offsetof(AppConfig, validation), 0, 0, {"off", "full", "sync"}, "khronos validation layer, sync runs only synchronization validation"},
+  {"log-severity", CONFIG_OPTION_CHOICE, offsetof(AppConfig, logSeverity), 0, 0, {"verbose", "info", "warning", "error"}, "least severe validation message printed"},
+  {"log-rate", CONFIG_OPTION_UINT, offsetof(AppConfig, logRate), 0, UINT32_MAX, {}, "validation messages printed per second, 0 for unlimited"},
+  {"gpu-timings", CONFIG_OPTION_BOOL, offsetof(AppConfig, gpuTimings), 0, 0, {}, "per pass timestamp queries"},
+  {"job-threads", CONFIG_OPTION_UINT, offsetof(AppConfig, jobThreads), 0, JOB_SYSTEM_MAX_THREADS, {}, "threads running frame jobs with the main thread, 0 for one per core"},
+  {"target-frame-ms", CONFIG_OPTION_DOUBLE, offsetof(AppConfig, targetFrameMs), 0, 0, {}, "gpu time per frame dynamic resolution holds, 0 renders at full size"},
+  {"min-render-scale", CONFIG_OPTION_DOUBLE, offsetof(AppConfig, minRenderScale), 0, 0, {}, "smallest fraction of the width and height dynamic resolution renders at"},
+  {"mesh", CONFIG_OPTION_STRING, offsetof(AppConfig, meshPath), 0, 0, {}, "vkmesh file to draw"},
+  {"texture", CONFIG_OPTION_STRING, offsetof(AppConfig, texturePath), 0, 0, {}, "vktx file to stream in, none by default"},
+  {"texture-budget", CONFIG_OPTION_UINT, offsetof(AppConfig, textureBudgetMb), 1, 1 << 20, {}, "megabytes of device memory streamed textures may use"},
+  {"capture", CONFIG_OPTION_STRING, offsetof(AppConfig, capturePath), 0, 0, {}, "record the frames into a trace"},
+  {"replay", CONFIG_OPTION_STRING, offsetof(AppConfig, replayPath), 0, 0, {}, "replay a trace headless"},
+  {"replay-timing", CONFIG_OPTION_CHOICE, offsetof(AppConfig, replayTiming), 0, 0, {"fast", "original"}, "back to back or at the captured intervals"},
+  {"replay-frame", CONFIG_OPTION_INT64, offsetof(AppConfig, replayFrame), 0, 0, {}, "replay only this frame, -1 for all"},
+  {"replay-repeat", CONFIG_OPTION_UINT, offsetof(AppConfig, replayRepeat), 1, UINT32_MAX, {}, "passes over the trace"}
+};
+
+const uint32_t globalConfigOptionsCount = sizeof(globalConfigOptions) / sizeof(globalConfigOptions[0]);
+
+
+
+struct {
+  Output outputs[MAX_OUTPUTS]; // output 0 is the primary: the frame pacer, captures and the render pass format follow it
+  uint32_t outputsCount;
+  uint32_t framesDrawn;
+  Benchmark benchmark;
+  bool headless; // no window, surface or swapchain; frames render into offscreen images
+  VkExtent2D headlessExtent;
+  uint32_t headlessFrame;
+  VkInstance instance;
+  VkDebugUtilsMessengerEXT debugMessenger;
+  VkPhysicalDevice physicalDevice;
+  DeviceCapabilities deviceCapabilities[MAX_PHYSICAL_DEVICES];
+  uint32_t deviceCapabilitiesCount;
+  DeviceCapabilities *capabilities; // entry of the picked device
+  VkPhysicalDeviceFeatures deviceFeatures;
+  VkDevice device;
+  VkQueue graphicsQueue;
+  VkQueue presentQueue;
+  VkQueue transferQueue;
+  VkQueue computeQueue;
+  FramePacer framePacer;
+  ResolutionController resolution;
+
+  RenderMode renderMode;
+  bool frameDirty;
+  double animationTime; // seconds, drives the camera; only advances on animation ticks when on demand
+  double lastAnimationTick;
+
+  // other threads or processes wake an on demand loop by writing to wakeFd,
+  // the watcher thread turns that into a glfw empty event
+  int wakeFd;
+  pthread_t wakeThread;
+  pthread_mutex_t wakeMutex;
+  bool wakeRunning;
+  bool wakePending;
+  VkRenderPass renderPass; // clears color and depth
+  VkRenderPass lateRenderPass; // same attachments loaded, for the late meshlet phase
+  VkFormat depthFormat;
+  VkPipelineLayout pipelineLayout;
+  VkPipeline graphicsPipeline;
+  VkCommandPool commandPool; // one time commands
+  // segments are recorded by parallel jobs and a pool belongs to one thread at
+  // a time, so every segment command buffer has a pool of its own. the compute
+  // pools are the graphics ones without async compute
+  VkCommandPool segmentCommandPools[MAX_FRAMES_IN_FLIGHT][FRAME_GRAPH_MAX_SEGMENTS];
+  VkCommandPool computeSegmentCommandPools[MAX_FRAMES_IN_FLIGHT][FRAME_GRAPH_MAX_SEGMENTS];
+  VkCommandBuffer commandBuffers[MAX_FRAMES_IN_FLIGHT][FRAME_GRAPH_MAX_SEGMENTS];
+  VkCommandBuffer computeCommandBuffers[MAX_FRAMES_IN_FLIGHT][FRAME_GRAPH_MAX_SEGMENTS];
+  // the main pass's draws, secondaries recorded in parallel per output and
+  // draw list chunk and executed from the segment; pools as above
+  VkCommandPool drawCommandPools[MAX_FRAMES_IN_FLIGHT][MAX_OUTPUTS][DRAW_LIST_MAX_CHUNKS];
+  VkCommandBuffer drawCommandBuffers[MAX_FRAMES_IN_FLIGHT][MAX_OUTPUTS][DRAW_LIST_MAX_CHUNKS];
+  VkSemaphore segmentSemaphores[MAX_FRAMES_IN_FLIGHT][FRAME_GRAPH_MAX_SEGMENTS]; // segment i signals [i] for segment i + 1
+  VkFence inFlightFences[MAX_FRAMES_IN_FLIGHT];
+  uint32_t currentFrame;
+  Arena frameArenas[MAX_FRAMES_IN_FLIGHT]; // reset once the frame's fence signalled
+  Arena scratchArena; // short lived init queries, callers pop back to their mark
+  FrameGraph frameGraph; // spans every output
+  PostProcess postProcess;
+  TextureStreamer textureStreamer;
+  bool textureStreaming; // a texture was configured and the streamer runs
+  SubmitBatcher submitBatcher;
+  JobSystem jobSystem;
+  PFN_vkQueueSubmit2KHR queueSubmit2; // NULL without VK_KHR_synchronization2
+  Mesh mesh;
+  VkPipelineLayout meshPipelineLayout;
+  VkPipeline meshPipeline;
+  MeshTexture meshTexture;
+  MeshletRenderer meshlets;
+  bool meshShaderEnabled; // VK_EXT_mesh_shader task and mesh shaders on the device
+
+  TraceHandles traceHandles;
+  bool capturing;
+  TraceRecorder traceRecorder;
+  bool replaying;
+  TracePlayer tracePlayer;
+  uint32_t replayFrame; // trace frame the next draw_frame renders
+} typedef App;
+
+void app_run(App* app);
+//------------------------------------
+void app_private_init_window(App *app);
+//------------------------------------
+void app_private_init_vulkan(App *app);
+
+void app_private_init_vulkan_create_instance(App *app);
+bool app_private_init_vulkan_create_instance_check_layer_support(Arena *scratch);
+bool app_private_init_vulkan_create_instance_check_extension_support(Arena *scratch, const char *extension);
+
+void app_private_init_vulkan_setup_debug_messenger(App *app);
+
+void app_private_init_vulkan_create_surface(App *app);
+
+void app_private_init_vulkan_pick_device(App *app);
+bool app_private_init_vulkan_pick_device_check_device_extensions(DeviceCapabilities *capabilities);
+bool app_private_init_vulkan_pick_device_check_outputs(App *app, DeviceCapabilities *capabilities);
+
+void app_private_init_vulkan_create_logical_device(App *app);
+
+void app_private_init_vulkan_create_post_process(App *app);
+void app_private_update_post_process_descriptors(App *app, Output *output);
+void app_private_frame_graph_post_pass(VkCommandBuffer commandBuffer, void *passData, void *frameData);
+void app_private_frame_graph_blit_pass(VkCommandBuffer commandBuffer, void *passData, void *frameData);
+
+void app_private_init_vulkan_create_swap_chain(App *app, Output *output);
+VkSurfaceFormatKHR app_private_init_vulkan_create_swap_chain_choose_format(VkSurfaceFormatKHR *availableFormats, uint32_t count);
+VkPresentModeKHR app_private_init_vulkan_create_swap_chain_choose_present_mode(VkPresentModeKHR *availablePresentModes, uint32_t count, PresentPolicy policy);
+uint32_t app_private_init_vulkan_create_swap_chain_choose_image_count(VkSurfaceCapabilitiesKHR *capabilities, VkPresentModeKHR presentMode);
+VkExtent2D app_private_init_vulkan_create_swap_chain_choose_swap_extend(VkSurfaceCapabilitiesKHR *capabilities, GLFWwindow *window);
+void app_private_recreate_swap_chain(App *app, uint32_t outputMask);
+void app_private_cleanup_swap_chain(App *app, Output *output);
+void app_private_cleanup_frame_graph(App *app);
+
+void app_private_init_vulkan_create_image_views(App *app, Output *output);
+
+void app_private_init_vulkan_create_render_pass(App *app);
+
+void app_private_init_vulkan_create_graphics_pipeline(App *app);
+VkPipeline app_private_build_graphics_pipeline(App *app, const VkPipelineShaderStageCreateInfo *stages, uint32_t stagesCount, const VkPipelineVertexInputStateCreateInfo *vertexInputInfo, VkFrontFace frontFace, VkPipelineLayout layout);
+VkPipelineShaderStageCreateInfo app_private_shader_stage(VkShaderStageFlagBits stage, VkShaderModule module, const VkSpecializationInfo *specialization);
+
+void app_private_init_vulkan_create_frame_buffers(App *app, Output *output);
+
+void app_private_init_vulkan_create_frame_graph(App *app);
+void app_private_init_vulkan_create_frame_graph_post(App *app);
+void app_private_init_vulkan_create_frame_graph_readback(App *app);
+void app_private_init_vulkan_create_frame_graph_hiz(App *app, Output *output);
+void app_private_frame_graph_main_pass(VkCommandBuffer commandBuffer, void *passData, void *frameData);
+void app_private_frame_graph_main_pass_begin(App *app, VkCommandBuffer commandBuffer, Output *output, VkRenderPass renderPass, VkSubpassContents contents);
+void app_private_frame_graph_main_pass_set_viewport(VkCommandBuffer commandBuffer, Output *output);
+void app_private_frame_graph_main_pass_record_draws(App *app, VkCommandBuffer commandBuffer, DrawList *drawList, uint32_t outputIndex, uint32_t chunk);
+void app_private_frame_graph_hiz_pass(VkCommandBuffer commandBuffer, void *passData, void *frameData);
+void app_private_frame_graph_late_pass(VkCommandBuffer commandBuffer, void *passData, void *frameData);
+void app_private_frame_graph_readback_pass(VkCommandBuffer commandBuffer, void *passData, void *frameData);
+
+void app_private_init_vulkan_create_command_pool(App *app);
+
+void app_private_init_vulkan_create_command_buffer(App *app);
+
+void app_private_init_vulkan_create_sync_objects(App *app);
+
+void app_private_init_vulkan_create_texture_streamer(App *app);
+VkDeviceSize app_private_memory_pressure_callback(void *userData, VkDeviceSize bytes);
+VkDeviceSize app_private_memory_relief_callback(void *userData, VkDeviceSize bytes);
+
+void app_private_init_vulkan_load_mesh(App *app);
+
+void app_private_init_vulkan_create_mesh_pipeline(App *app);
+void app_private_init_vulkan_create_mesh_texture(App *app);
+void app_private_cleanup_mesh_texture(App *app);
+
+void app_private_init_vulkan_create_meshlet_renderer(App *app);
+bool app_private_init_vulkan_create_meshlet_renderer_mesh_shader(App *app);
+bool app_private_init_vulkan_create_meshlet_renderer_compute(App *app);
+void app_private_init_vulkan_create_meshlet_renderer_occlusion(App *app);
+void app_private_cleanup_meshlet_occlusion(App *app);
+void app_private_init_vulkan_create_meshlet_renderer_descriptors(App *app, VkShaderStageFlags stages, uint32_t bindingsCount, const VkBuffer *buffers);
+bool app_private_meshlets_applicable(App *app, const DrawCommand *command);
+const DrawCommand *app_private_meshlets_find_command(App *app, const DrawList *drawList);
+MeshletPushConstants app_private_meshlets_push_constants(App *app, const DrawCommand *command, uint32_t output, MeshletPhase phase);
+void app_private_meshlets_record_cull(App *app, VkCommandBuffer commandBuffer, const DrawCommand *command, uint32_t output, MeshletPhase phase);
+void app_private_meshlets_record_draw(App *app, VkCommandBuffer commandBuffer, const DrawCommand *command, uint32_t output, MeshletPhase phase);
+void app_private_meshlets_record_stats_barrier(App *app, VkCommandBuffer commandBuffer);
+void app_private_meshlets_collect_stats(App *app);
+
+void app_private_init_vulkan_create_resolution_controller(App *app);
+
+void app_private_init_vulkan_collect_trace_handles(App *app);
+void app_private_init_vulkan_create_headless_targets(App *app, Output *output);
+//------------------------------------
+VkShaderModule app_private_create_shader_module(App *app, const char *path);
+uint32_t app_private_find_memory_type(App *app, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+void app_private_create_buffer(App *app, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer *buffer, VkDeviceMemory *memory);
+VkCommandBuffer app_private_begin_one_time_commands(App *app);
+void app_private_end_one_time_commands(App *app, VkCommandBuffer commandBuffer);
+//------------------------------------
+VkDebugUtilsMessengerCreateInfoEXT app_private_populate_debug_messenger_info();
+//------------------------------------
+VKAPI_ATTR VkBool32 VKAPI_CALL app_private_debug_callback(
+  VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+  VkDebugUtilsMessageTypeFlagsEXT messageType,
+  const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
+  void *pUserData);
+//------------------------------------
+static void app_private_framebuffer_resize_callback(GLFWwindow *window, int width, int height);
+static void app_private_key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
+static void app_private_cursor_position_callback(GLFWwindow *window, double x, double y);
+static void app_private_mouse_button_callback(GLFWwindow *window, int button, int action, int mods);
+static void app_private_scroll_callback(GLFWwindow *window, double x, double y);
+static void app_private_window_refresh_callback(GLFWwindow *window);
+
+void app_wake(App *app);
+void *app_private_wake_thread(void *arg);
+void app_private_main_loop_wait_for_work(App *app);
+
+void app_private_main_loop(App *app);
+bool app_private_main_loop_should_close(App *app);
+void app_private_main_loop_resize_storm(App *app);
+void app_private_replay_loop(App *app);
+void app_private_write_benchmark(App *app);
+
+void app_private_main_loop_draw_frame(App *app);
+void app_private_main_loop_draw_frame_collect_readback(App *app);
+void app_private_main_loop_draw_frame_update_render_extent(App *app);
+void app_private_main_loop_draw_frame_update_mesh_texture(App *app);
+void app_private_main_loop_draw_frame_record_command_buffer(App *app, VkCommandBuffer commandBuffer, DrawList *drawLists, uint32_t segment);
+void app_private_main_loop_draw_frame_build_draw_list(App *app, DrawList *drawList, VkExtent2D extent);
+void app_private_main_loop_draw_frame_repeat_draw(DrawList *drawList);
+void app_private_frame_job_update_textures(void *data);
+void app_private_frame_job_build_draw_list(void *data);
+void app_private_frame_job_capture(void *data);
+void app_private_frame_job_record(void *data);
+void app_private_frame_job_record_draws(void *data);
+//------------------------------------
+void app_private_cleanup(App *app);
+
+
+
+QueueFamilyIndices queue_families_find(const DeviceCapabilities *capabilities);
+
+
+
+// formats and presentModes live in arena, valid until the caller pops it
+SwapChainSupportDetails swap_chain_support_details_query(VkPhysicalDevice device, VkSurfaceKHR surface, Arena *arena);
+
+
+
+void device_capabilities_query(DeviceCapabilities *capabilities, VkPhysicalDevice device, VkSurfaceKHR surface);
+void device_capabilities_refresh_surface(DeviceCapabilities *capabilities, VkSurfaceKHR surface);
+bool device_capabilities_has_extension(const DeviceCapabilities *capabilities, const char *name);
+void device_capabilities_destroy(DeviceCapabilities *capabilities);
+
+
+
+void frame_pacer_init(FramePacer *pacer, PresentPolicy policy, uint32_t frameCap);
+void frame_pacer_swap_chain_recreated(FramePacer *pacer, VkPresentModeKHR presentMode, uint32_t imageCount);
+void frame_pacer_wait(FramePacer *pacer, VkDevice device, VkSwapchainKHR swapChain);
+void frame_pacer_sample_input(FramePacer *pacer);
+uint64_t frame_pacer_next_present_id(FramePacer *pacer);
+void frame_pacer_presented(FramePacer *pacer);
+const char *present_mode_name(VkPresentModeKHR presentMode);
+
+
+
+void resolution_controller_init(ResolutionController *controller, double targetMs, double minScale);
+void resolution_controller_update(ResolutionController *controller, uint32_t frameIndex, double gpuTimeMs);
+VkExtent2D resolution_controller_extent(const ResolutionController *controller, VkExtent2D extent);
+
+
+
+void arena_init(Arena *arena, size_t capacity);
+void *arena_alloc(Arena *arena, size_t size, size_t alignment);
+size_t arena_mark(Arena *arena);
+void arena_pop_to(Arena *arena, size_t mark);
+void arena_reset(Arena *arena);
+void arena_destroy(Arena *arena);
+
+
+
+void draw_list_init(DrawList *drawList, Arena *arena, uint32_t capacity);
+DrawCommand *draw_list_push(DrawList *drawList);
+
+
+
+void frame_graph_init(FrameGraph *graph, VkDevice device, const VkPhysicalDeviceMemoryProperties *memoryProperties);
+uint32_t frame_graph_import_image(FrameGraph *graph, const char *name, VkFormat format, VkExtent2D extent, VkImageAspectFlags aspect, VkImageLayout initialLayout, VkPipelineStageFlags initialStages, VkImageLayout finalLayout);
+uint32_t frame_graph_create_image(FrameGraph *graph, const char *name, VkFormat format, VkExtent2D extent, VkImageAspectFlags aspect);
+void frame_graph_set_queue_families(FrameGraph *graph, uint32_t graphicsFamily, uint32_t computeFamily);
+void frame_graph_enable_timestamps(FrameGraph *graph, float timestampPeriod, bool graphicsTimestamps, bool computeTimestamps);
+uint32_t frame_graph_add_pass(FrameGraph *graph, const char *name, FrameGraphPassExecute execute, void *passData);
+void frame_graph_pass_set_queue(FrameGraph *graph, uint32_t pass, FrameGraphQueue queue);
+void frame_graph_pass_set_side_effects(FrameGraph *graph, uint32_t pass);
+void frame_graph_set_mip_levels(FrameGraph *graph, uint32_t resource, uint32_t mipLevels);
+void frame_graph_pass_use(FrameGraph *graph, uint32_t pass, uint32_t resource, FrameGraphAccess access);
+void frame_graph_compile(FrameGraph *graph);
+void frame_graph_set_imported_image(FrameGraph *graph, uint32_t resource, VkImage image, VkImageView view);
+VkImageView frame_graph_get_view(FrameGraph *graph, uint32_t resource);
+VkExtent2D frame_graph_get_extent(FrameGraph *graph, uint32_t resource);
+VkImage frame_graph_get_image(FrameGraph *graph, uint32_t resource);
+uint32_t frame_graph_first_use(FrameGraph *graph, uint32_t resource, VkPipelineStageFlags *stages);
+void frame_graph_begin_frame(FrameGraph *graph, uint32_t frameIndex);
+void frame_graph_execute_segment(FrameGraph *graph, uint32_t segment, VkCommandBuffer commandBuffer, uint32_t frameIndex, void *frameData);
+void frame_graph_destroy(FrameGraph *graph);
+
+void frame_graph_private_cull(FrameGraph *graph);
+void frame_graph_private_build_segments(FrameGraph *graph);
+void frame_graph_private_allocate_transients(FrameGraph *graph);
+void frame_graph_private_build_barriers(FrameGraph *graph);
+void frame_graph_private_record_barriers(FrameGraph *graph, VkCommandBuffer commandBuffer, FrameGraphBarrierBatch *batch);
+bool frame_graph_private_pass_absent(FrameGraph *graph, FrameGraphPass *pass);
+
+
+
+bool mesh_file_map(const char *path, MeshFile *file);
+void mesh_file_unmap(MeshFile *file);
+
+bool mesh_file_private_check_indices(const MeshFile *file);
+
+
+
+bool trace_recorder_open(TraceRecorder *recorder, const char *path, VkExtent2D extent, VkFormat format, VkPresentModeKHR presentMode);
+void trace_recorder_write_frame(TraceRecorder *recorder, const TraceHandles *handles, const DrawList *drawList, VkExtent2D extent, VkPresentModeKHR presentMode, uint32_t imageIndex);
+void trace_recorder_close(TraceRecorder *recorder);
+
+bool trace_player_open(TracePlayer *player, const char *path);
+const TraceFrameHeader *trace_player_frame(TracePlayer *player, uint32_t frame);
+DrawList trace_player_build_draw_list(TracePlayer *player, uint32_t frame, const TraceHandles *handles, Arena *arena);
+void trace_player_close(TracePlayer *player);
+
+
+
+Mat4 mat4_multiply(Mat4 a, Mat4 b);
+Mat4 mat4_perspective(float fovY, float aspect, float near, float far);
+Mat4 mat4_look_at(const float eye[3], const float center[3], const float up[3]);
+
+
+
+void submit_batcher_init(SubmitBatcher *batcher, PFN_vkQueueSubmit2KHR queueSubmit2);
+void submit_batcher_begin(SubmitBatcher *batcher, VkQueue queue);
+void submit_batcher_add_wait(SubmitBatcher *batcher, VkSemaphore semaphore, VkPipelineStageFlags stages);
+void submit_batcher_add_command_buffer(SubmitBatcher *batcher, VkCommandBuffer commandBuffer);
+void submit_batcher_add_signal(SubmitBatcher *batcher, VkSemaphore semaphore);
+void submit_batcher_set_fence(SubmitBatcher *batcher, VkFence fence);
+void submit_batcher_flush(SubmitBatcher *batcher, VkFence fence);
+
+void submit_batcher_private_submit(SubmitBatcher *batcher, uint32_t firstBatch, uint32_t batchesCount, VkFence fence);
+
+
+
+void texture_streamer_init(TextureStreamer *streamer, VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, QueueFamilyIndices indices, VkDeviceSize budget);
+uint32_t texture_streamer_request(TextureStreamer *streamer, const char *path);
+void texture_streamer_update(TextureStreamer *streamer, SubmitBatcher *batcher);
+bool texture_streamer_idle(TextureStreamer *streamer);
+VkImageView texture_streamer_get_view(TextureStreamer *streamer, uint32_t texture);
+VkDeviceSize texture_streamer_shed(TextureStreamer *streamer, VkDeviceSize bytes);
+VkDeviceSize texture_streamer_restore(TextureStreamer *streamer, VkDeviceSize bytes);
+void texture_streamer_destroy(TextureStreamer *streamer);
+
+void *texture_streamer_private_io_thread(void *arg);
+void texture_streamer_private_push_request(TextureStreamer *streamer, TextureRequest request);
+void texture_streamer_private_allocate_texture(TextureStreamer *streamer, Texture *texture);
+void texture_streamer_private_record_upload(TextureStreamer *streamer, uint32_t slotIndex);
+void texture_streamer_private_complete_upload(TextureStreamer *streamer, uint32_t slotIndex);
+void texture_streamer_private_rebuild_view(TextureStreamer *streamer, Texture *texture);
+void texture_streamer_private_retire_view(TextureStreamer *streamer, VkImageView view);
+uint32_t texture_streamer_private_find_memory_type(TextureStreamer *streamer, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+bool texture_streamer_private_validate_header(const TextureFileHeader *header, uint64_t fileSize, const char *path);
+uint32_t texture_streamer_private_bytes_per_texel(VkFormat format);
+
+
+
+void memory_tracker_init(MemoryTracker *tracker, VkPhysicalDevice physicalDevice, bool budgetSupported);
+void memory_tracker_set_pressure_callback(MemoryTracker *tracker, MemoryPressureCallback callback, MemoryPressureCallback reliefCallback, void *userData);
+VkResult memory_tracker_allocate(MemoryTracker *tracker, VkDevice device, const VkMemoryAllocateInfo *allocInfo, VkDeviceMemory *memory);
+void memory_tracker_free(MemoryTracker *tracker, VkDevice device, VkDeviceMemory memory);
+void memory_tracker_object_created(MemoryTracker *tracker, MemoryObjectType type);
+void memory_tracker_object_destroyed(MemoryTracker *tracker, MemoryObjectType type);
+void memory_tracker_update(MemoryTracker *tracker);
+void memory_tracker_get_stats(MemoryTracker *tracker, MemoryStats *stats);
+void memory_tracker_log(MemoryTracker *tracker);
+void memory_tracker_destroy(MemoryTracker *tracker);
+
+void memory_tracker_private_query_budget(MemoryTracker *tracker);
+
+
+
+void debug_logger_init(DebugLogger *logger, DebugLogSeverity minSeverity, uint32_t rateLimit);
+void debug_logger_submit(DebugLogger *logger, VkDebugUtilsMessageSeverityFlagBitsEXT severity, int32_t messageId, const char *messageIdName, const char *message);
+void debug_logger_destroy(DebugLogger *logger);
+
+void *debug_logger_private_thread(void *arg);
+uint32_t debug_logger_private_count_message(DebugLogger *logger, int32_t messageId, uint64_t hash);
+uint64_t debug_logger_private_hash(uint64_t hash, const char *text);
+const char *debug_logger_private_severity_name(VkDebugUtilsMessageSeverityFlagBitsEXT severity);
+
+
+
+void job_system_init(JobSystem *system, uint32_t threadsCount);
+uint32_t job_system_add(JobSystem *system, const char *name, JobFunction function, void *data);
+void job_system_depend(JobSystem *system, uint32_t job, uint32_t dependency);
+void job_system_submit(JobSystem *system, uint32_t job);
+void job_system_wait(JobSystem *system);
+void job_system_destroy(JobSystem *system);
+
+void *job_system_private_thread(void *arg);
+bool job_system_private_next(JobSystem *system, uint32_t thread, uint32_t *job);
+void job_system_private_run(JobSystem *system, uint32_t thread, uint32_t job);
+void job_system_private_push(JobSystem *system, uint32_t thread, uint32_t job);
+void job_system_private_record_timings(JobSystem *system);
+void job_deque_push(JobDeque *deque, uint32_t job);
+bool job_deque_pop(JobDeque *deque, uint32_t *job);
+bool job_deque_steal(JobDeque *deque, uint32_t *job);
+
+
+
+bool config_set(AppConfig *config, const char *key, const char *value);
+bool config_load_file(AppConfig *config, const char *path);
+bool config_parse_args(AppConfig *config, int argc, char **argv);
+bool config_validate(const AppConfig *config);
+void config_log(const AppConfig *config);
+void config_print_usage(const char *program);
+void config_destroy(AppConfig *config);
+
+const ConfigOption *config_private_find_option(const char *name);
+char *config_private_trim(char *text);
+
+
+
+static uint8_t *helper_read_file(const char *filename, size_t *filesize);
+static uint64_t helper_time_ns();
+static void helper_sort_u64(uint64_t *values, uint64_t count);
+static void helper_sleep_until_ns(uint64_t time);
+
+
+
+void app_run(App* app) {
+  memset(&app->benchmark, 0, sizeof(Benchmark));
+  app->benchmark.startTime = helper_time_ns();
+
+  arena_init(&app->scratchArena, SCRATCH_ARENA_SIZE);
+  for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    arena_init(&app->frameArenas[i], FRAME_ARENA_SIZE);
+  }
+  app->currentFrame = 0;
+  frame_pacer_init(&app->framePacer, globalConfig.presentPolicy, globalConfig.powerSavingFrameCap);
+  job_system_init(&app->jobSystem, globalConfig.jobThreads);
+
+  app->headless = globalConfig.headless;
+  app->headlessExtent.width = globalConfig.windowWidth;
+  app->headlessExtent.height = globalConfig.windowHeight;
+  app->headlessFrame = 0;
+  app->capturing = false;
+  app->replaying = false;
+
+  // replays run without a window so they work on boxes without a display,
+  // the offscreen targets take the captured swapchain extent
+  if(globalConfig.replayPath != NULL) {
+    if(!trace_player_open(&app->tracePlayer, globalConfig.replayPath))
+      exit(1);
+
+    app->replaying = true;
+    app->headless = true;
+    app->headlessExtent.width = app->tracePlayer.header->width;
+    app->headlessExtent.height = app->tracePlayer.header->height;
+  }
+
+  // headless renders a single offscreen target, which is also all a trace holds
+  app->outputsCount = app->headless ? 1 : globalConfig.outputsCount;
+  app->framesDrawn = 0;
+  for(int i = 0; i < app->outputsCount; i++) {
+    Output *output = &app->outputs[i];
+    memset(output, 0, sizeof(Output));
+    arena_init(&output->supportArena, OUTPUT_SUPPORT_ARENA_SIZE);
+    arena_init(&output->swapChainArena, SWAP_CHAIN_ARENA_SIZE);
+  }
+
+  app->renderMode = app->headless ? RENDER_MODE_CONTINUOUS : globalConfig.renderMode;
+  app->frameDirty = true;
+  app->animationTime = 0.0;
+  app->lastAnimationTick = helper_time_ns() / 1e9;
+
+  if(!app->headless)
+    app_private_init_window(app);
+  app_private_init_vulkan(app);
+  app->benchmark.initTime = helper_time_ns() - app->benchmark.startTime;
+
+  if(globalConfig.benchmarkPath != NULL) {
+    app->benchmark.frameTimes = malloc(globalConfig.frames * sizeof(uint64_t));
+    CHECK_ALLOC_FOR_NULL(app->benchmark.frameTimes);
+  }
+
+  if(globalConfig.capturePath != NULL && !app->replaying) {
+    app->capturing = trace_recorder_open(&app->traceRecorder, globalConfig.capturePath, app->outputs[0].swapChainExtent, app->outputs[0].swapChainImageFormat, app->framePacer.presentMode);
+  }
+
+  if(app->replaying)
+    app_private_replay_loop(app);
+  else
+    app_private_main_loop(app);
+
+  vkDeviceWaitIdle(app->device);
+
+  if(app->capturing)
+    trace_recorder_close(&app->traceRecorder);
+  if(app->replaying)
+    trace_player_close(&app->tracePlayer);
+
+  if(globalConfig.benchmarkPath != NULL) {
+    app_private_write_benchmark(app);
+    free(app->benchmark.frameTimes);
+  }
+
+  app_private_cleanup(app);
+}
+
+void app_private_init_window(App* app) {
+  glfwInit();
+
+  glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+  glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+
+  // extra outputs go one per monitor, cascading once monitors run out
+  int monitorsCount = 0;
+  GLFWmonitor **monitors = app->outputsCount > 1 ? glfwGetMonitors(&monitorsCount) : NULL;
+
+  for(int i = 0; i < app->outputsCount; i++) {
+    Output *output = &app->outputs[i];
+
+    char title[32];
+    if(app->outputsCount > 1)
+      snprintf(title, sizeof(title), "Vulkan %d", i);
+    else
+      snprintf(title, sizeof(title), "Vulkan");
+
+    output->window = glfwCreateWindow(globalConfig.windowWidth, globalConfig.windowHeight, title, NULL, NULL);
+    output->framebufferResized = false;
+
+    if(monitorsCount > 0) {
+      int x = 0, y = 0;
+      glfwGetMonitorPos(monitors[i % monitorsCount], &x, &y);
+      glfwSetWindowPos(output->window, x + 32 * (1 + i / monitorsCount), y + 32 * (1 + i / monitorsCount));
+    }
+
+    glfwSetWindowUserPointer(output->window, app);
+    glfwSetFramebufferSizeCallback(output->window, app_private_framebuffer_resize_callback);
+    glfwSetKeyCallback(output->window, app_private_key_callback);
+    glfwSetCursorPosCallback(output->window, app_private_cursor_position_callback);
+    glfwSetMouseButtonCallback(output->window, app_private_mouse_button_callback);
+    glfwSetScrollCallback(output->window, app_private_scroll_callback);
+    glfwSetWindowRefreshCallback(output->window, app_private_window_refresh_callback);
+  }
+
+  app->wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if(app->wakeFd < 0) {
+    printf("failed to create wake eventfd\n");
+    exit(1);
+  }
+
+  pthread_mutex_init(&app->wakeMutex, NULL);
+  app->wakeRunning = true;
+  app->wakePending = false;
+
+  if(pthread_create(&app->wakeThread, NULL, app_private_wake_thread, app) != 0) {
+    printf("failed to create wake thread\n");
+    exit(1);
+  }
+}
+
+void app_private_init_vulkan(App* app) {
+  if(globalConfig.validation != VALIDATION_MODE_OFF)
+    debug_logger_init(&globalDebugLogger, globalConfig.logSeverity, globalConfig.logRate);
+
+  app_private_init_vulkan_create_instance(app);
+
+  if(globalConfig.validation != VALIDATION_MODE_OFF)
+    app_private_init_vulkan_setup_debug_messenger(app);
+
+  if(app->headless)
+    app->outputs[0].surface = VK_NULL_HANDLE;
+  else
+    app_private_init_vulkan_create_surface(app);
+  app_private_init_vulkan_pick_device(app);
+  app_private_init_vulkan_create_logical_device(app);
+  app_private_init_vulkan_create_post_process(app);
+  for(int i = 0; i < app->outputsCount; i++) {
+    app_private_init_vulkan_create_swap_chain(app, &app->outputs[i]);
+    app_private_init_vulkan_create_image_views(app, &app->outputs[i]);
+  }
+  app_private_init_vulkan_create_render_pass(app);
+  app_private_init_vulkan_create_graphics_pipeline(app);
+  app_private_init_vulkan_create_command_pool(app);
+  app_private_init_vulkan_create_command_buffer(app);
+  app_private_init_vulkan_create_sync_objects(app);
+  app_private_init_vulkan_create_texture_streamer(app);
+  app_private_init_vulkan_load_mesh(app);
+  app_private_init_vulkan_create_mesh_pipeline(app);
+  app_private_init_vulkan_create_meshlet_renderer(app);
+  // after the meshlet renderer, whether it occlusion culls decides the passes
+  app_private_init_vulkan_create_frame_graph(app);
+  app_private_init_vulkan_create_resolution_controller(app);
+  app_private_init_vulkan_collect_trace_handles(app);
+}
+
+void app_private_init_vulkan_create_instance(App* app) {
+  if(globalConfig.validation != VALIDATION_MODE_OFF
+     && !app_private_init_vulkan_create_instance_check_layer_support(&app->scratchArena)
+  ){
+    printf("validation layers unavailable\n");
+    exit(1);
+  }
+
+  VkApplicationInfo appInfo;
+  appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+  appInfo.pApplicationName = "Hello Triangle";
+  appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+  appInfo.pEngineName = "No Engine";
+  appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+  appInfo.apiVersion = VK_API_VERSION_1_1; // vkGetPhysicalDeviceFeatures2 for present wait
+  appInfo.pNext = NULL;
+
+  VkInstanceCreateInfo createInfo;
+  createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  createInfo.pApplicationInfo = &appInfo;
+
+  uint32_t glfwExtensionsCount = 0;
+  const char **glfwExtensions = NULL;
+
+  if(!app->headless)
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
+
+  size_t scratchMark = arena_mark(&app->scratchArena);
+  const char **debugGlfwExtensions = ARENA_ALLOC_ARRAY(&app->scratchArena, const char *, glfwExtensionsCount + 2);
+  uint32_t debugGlfwExtensionsCount = 0;
+
+  // the layer reports through the messenger chained here until the real one
+  // exists, so the logger has to run first
+  VkDebugUtilsMessengerCreateInfoEXT debugMessengerCreateInfo = app_private_populate_debug_messenger_info();
+
+  // sync mode keeps the layer loaded but turns off everything except
+  // synchronization validation, which is cheap enough to leave on while profiling
+  VkValidationFeatureEnableEXT enabledValidationFeatures[] = {
+    VK_VALIDATION_FEATURE_ENABLE_SYNCHRONIZATION_VALIDATION_EXT
+  };
+  VkValidationFeatureDisableEXT disabledValidationFeatures[] = {
+    VK_VALIDATION_FEATURE_DISABLE_SHADERS_EXT,
+    VK_VALIDATION_FEATURE_DISABLE_THREAD_SAFETY_EXT,
+    VK_VALIDATION_FEATURE_DISABLE_API_PARAMETERS_EXT,
+    VK_VALIDATION_FEATURE_DISABLE_OBJECT_LIFETIMES_EXT,
+    VK_VALIDATION_FEATURE_DISABLE_CORE_CHECKS_EXT
+  };
+  VkValidationFeaturesEXT validationFeatures = {};
+  validationFeatures.sType = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT;
+  validationFeatures.enabledValidationFeatureCount = sizeof(enabledValidationFeatures) / sizeof(enabledValidationFeatures[0]);
+  validationFeatures.pEnabledValidationFeatures = enabledValidationFeatures;
+  validationFeatures.disabledValidationFeatureCount = sizeof(disabledValidationFeatures) / sizeof(disabledValidationFeatures[0]);
+  validationFeatures.pDisabledValidationFeatures = disabledValidationFeatures;
+  validationFeatures.pNext = &debugMessengerCreateInfo;
+
+  if (globalConfig.validation != VALIDATION_MODE_OFF) {
+    for(int i = 0; i < glfwExtensionsCount; i++){
+      debugGlfwExtensions[debugGlfwExtensionsCount++] = glfwExtensions[i];
+    }
+    debugGlfwExtensions[debugGlfwExtensionsCount++] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+
+    createInfo.enabledLayerCount = globalValidationLayersCount;
+    createInfo.ppEnabledLayerNames = globalValidationLayers;
+    createInfo.pNext = &debugMessengerCreateInfo;
+
+    if(globalConfig.validation == VALIDATION_MODE_SYNC) {
+      if(app_private_init_vulkan_create_instance_check_extension_support(&app->scratchArena, VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME)) {
+        debugGlfwExtensions[debugGlfwExtensionsCount++] = VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME;
+        createInfo.pNext = &validationFeatures;
+      } else
+        printf("%s unavailable, running full validation\n", VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+    }
+
+    createInfo.enabledExtensionCount = debugGlfwExtensionsCount;
+    createInfo.ppEnabledExtensionNames = debugGlfwExtensions;
+  } else {
+    createInfo.enabledLayerCount = 0;
+    createInfo.enabledExtensionCount = glfwExtensionsCount;
+    createInfo.ppEnabledExtensionNames = glfwExtensions;
+    createInfo.pNext = NULL;
+  }
+
+  if(vkCreateInstance(&createInfo, NULL, &app->instance) != VK_SUCCESS) {
+    printf("failed to create instance\n");
+    exit(1);
+  }
+
+  arena_pop_to(&app->scratchArena, scratchMark);
+}
+
+bool app_private_init_vulkan_create_instance_check_layer_support(Arena *scratch) {
+  uint32_t availableLayersCount;
+  vkEnumerateInstanceLayerProperties(&availableLayersCount, NULL);
+
+  size_t scratchMark = arena_mark(scratch);
+  VkLayerProperties* availableLayers = ARENA_ALLOC_ARRAY(scratch, VkLayerProperties, availableLayersCount);
+  vkEnumerateInstanceLayerProperties(&availableLayersCount, availableLayers);
+
+  for(int i = 0; i < globalValidationLayersCount; i++) {
+    bool layerFound = false;
+
+    for(int j = 0; j < availableLayersCount; j++) {
+      if(strcmp(globalValidationLayers[i], availableLayers[j].layerName) == 0) {
+        layerFound = true;
+        break;
+      }
+    }
+    if(!layerFound) {
+      arena_pop_to(scratch, scratchMark);
+      return false;
+    }
+  }
+  arena_pop_to(scratch, scratchMark);
+
+  return true;
+}
+
+// layer extensions such as VK_EXT_validation_features are only listed when
+// the layer is named, so the validation layers are searched after the loader
+bool app_private_init_vulkan_create_instance_check_extension_support(Arena *scratch, const char *extension) {
+  bool found = false;
+
+  for(int i = -1; i < globalValidationLayersCount && !found; i++) {
+    const char *layer = i < 0 ? NULL : globalValidationLayers[i];
+    uint32_t availableExtensionsCount = 0;
+    vkEnumerateInstanceExtensionProperties(layer, &availableExtensionsCount, NULL);
+
+    size_t scratchMark = arena_mark(scratch);
+    VkExtensionProperties *availableExtensions = ARENA_ALLOC_ARRAY(scratch, VkExtensionProperties, availableExtensionsCount);
+    vkEnumerateInstanceExtensionProperties(layer, &availableExtensionsCount, availableExtensions);
+
+    for(int j = 0; j < availableExtensionsCount && !found; j++) {
+      found = strcmp(availableExtensions[j].extensionName, extension) == 0;
+    }
+    arena_pop_to(scratch, scratchMark);
+  }
+
+  return found;
+}
+
+void app_private_init_vulkan_setup_debug_messenger(App *app) {
+  VkDebugUtilsMessengerCreateInfoEXT createInfo = app_private_populate_debug_messenger_info();
+
+  PFN_vkCreateDebugUtilsMessengerEXT func = (PFN_vkCreateDebugUtilsMessengerEXT)
+    vkGetInstanceProcAddr(app->instance, "vkCreateDebugUtilsMessengerEXT");
+
+  if (func != NULL) {
+    func(app->instance, &createInfo, NULL, &app->debugMessenger);
+  } else {
+    printf("failed to set up messenger\n");
+    exit(1);
+  }
+}
+
+void app_private_init_vulkan_create_surface(App *app) {
+  for(int i = 0; i < app->outputsCount; i++) {
+    if(glfwCreateWindowSurface(app->instance, app->outputs[i].window, NULL, &app->outputs[i].surface) != VK_SUCCESS) {
+      printf("failed to create window");
+      exit(1);
+    }
+  }
+}
+
+void app_private_init_vulkan_pick_device(App *app) {
+  uint32_t deviceCount = 0;
+  vkEnumeratePhysicalDevices(app->instance, &deviceCount, NULL);
+
+  if(deviceCount == 0) {
+    printf("failed to find GPU with vulkan support");
+    exit(1);
+  }
+  if(deviceCount > MAX_PHYSICAL_DEVICES)
+    deviceCount = MAX_PHYSICAL_DEVICES;
+
+  VkPhysicalDevice devices[MAX_PHYSICAL_DEVICES];
+  vkEnumeratePhysicalDevices(app->instance, &deviceCount, devices);
+
+  app->deviceCapabilitiesCount = deviceCount;
+  app->capabilities = NULL;
+
+  for(int i = 0; i < deviceCount; i++) {
+    DeviceCapabilities *capabilities = &app->deviceCapabilities[i];
+    device_capabilities_query(capabilities, devices[i], app->outputs[0].surface);
+
+    bool suitable = capabilities->queueFamilyIndices.isComplete
+      && (app->headless || (app_private_init_vulkan_pick_device_check_device_extensions(capabilities)
+        && capabilities->swapChainSupport.formatsCount != 0
+        && capabilities->swapChainSupport.presentModesCount != 0
+        && app_private_init_vulkan_pick_device_check_outputs(app, capabilities)));
+
+    // a numeric device option is an index, anything else matches the name
+    bool requested = true;
+    if(globalConfig.device != NULL) {
+      char *end = NULL;
+      long index = strtol(globalConfig.device, &end, 10);
+      requested = *end == '\0' ? index == i : strstr(capabilities->properties.deviceName, globalConfig.device) != NULL;
+    }
+
+    if(suitable && requested && app->capabilities == NULL)
+      app->capabilities = capabilities;
+  }
+
+  if(app->capabilities == NULL) {
+    printf("suitable device not found\n");
+    for(int i = 0; i < deviceCount && globalConfig.device != NULL; i++) {
+      printf("  device %d: %s\n", i, app->deviceCapabilities[i].properties.deviceName);
+    }
+    exit(1);
+  }
+
+  app->physicalDevice = app->capabilities->physicalDevice;
+
+  for(int i = 0; i < app->outputsCount && !app->headless; i++) {
+    Output *output = &app->outputs[i];
+    output->swapChainSupport = swap_chain_support_details_query(app->physicalDevice, output->surface, &output->supportArena);
+  }
+}
+
+bool app_private_init_vulkan_pick_device_check_device_extensions(DeviceCapabilities *capabilities) {
+  for (int i = 0; i < globalDeviceExtensionCount; i++) {
+    if(!device_capabilities_has_extension(capabilities, globalDeviceExtensions[i]))
+      return false;
+  }
+
+  return true;
+}
+
+// device capabilities only cover the primary surface, every other output has
+// to be reachable from the same present queue
+bool app_private_init_vulkan_pick_device_check_outputs(App *app, DeviceCapabilities *capabilities) {
+  for(int i = 1; i < app->outputsCount; i++) {
+    VkSurfaceKHR surface = app->outputs[i].surface;
+
+    VkBool32 presentSupport = VK_FALSE;
+    vkGetPhysicalDeviceSurfaceSupportKHR(capabilities->physicalDevice, capabilities->queueFamilyIndices.presentFamily, surface, &presentSupport);
+
+    uint32_t formatsCount = 0, presentModesCount = 0;
+    vkGetPhysicalDeviceSurfaceFormatsKHR(capabilities->physicalDevice, surface, &formatsCount, NULL);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(capabilities->physicalDevice, surface, &presentModesCount, NULL);
+
+    if(!presentSupport || formatsCount == 0 || presentModesCount == 0)
+      return false;
+  }
+
+  return true;
+}
+
+void app_private_init_vulkan_create_logical_device(App *app) {
+  size_t scratchMark = arena_mark(&app->scratchArena);
+  QueueFamilyIndices indices = app->capabilities->queueFamilyIndices;
+
+  uint32_t requestedQueueFamilies[] = {indices.graphicsFamily, indices.presentFamily, indices.transferFamily, indices.computeFamily};
+  uint8_t requestedQueueFamiliesCount = sizeof(requestedQueueFamilies) / sizeof(requestedQueueFamilies[0]);
+
+  uint8_t uniqueQueueFamilesCount = 0;
+  uint32_t uniqueQueueFamilies[sizeof(requestedQueueFamilies) / sizeof(requestedQueueFamilies[0])];
+
+  for(int i = 0; i < requestedQueueFamiliesCount; i++) {
+    bool alreadyAdded = false;
+
+    for(int j = 0; j < uniqueQueueFamilesCount; j++) {
+      if(uniqueQueueFamilies[j] == requestedQueueFamilies[i]) {
+        alreadyAdded = true;
+        break;
+      }
+    }
+    if(!alreadyAdded)
+      uniqueQueueFamilies[uniqueQueueFamilesCount++] = requestedQueueFamilies[i];
+  }
+
+  VkDeviceQueueCreateInfo *queueCreateInfos = ARENA_ALLOC_ARRAY(&app->scratchArena, VkDeviceQueueCreateInfo, uniqueQueueFamilesCount);
+
+  float queuePriority = 1.0f;
+
+  for(int i = 0; i < uniqueQueueFamilesCount; i++) {
+    queueCreateInfos[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueCreateInfos[i].queueFamilyIndex = uniqueQueueFamilies[i];
+    queueCreateInfos[i].queueCount = 1;
+    queueCreateInfos[i].pQueuePriorities = &queuePriority;
+    queueCreateInfos[i].pNext = NULL;
+    queueCreateInfos[i].flags = 0;
+  }
+
+  VkDeviceCreateInfo createInfo;
+  createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+
+  createInfo.queueCreateInfoCount = uniqueQueueFamilesCount;
+  createInfo.pQueueCreateInfos = queueCreateInfos;
+
+  app->deviceFeatures = (VkPhysicalDeviceFeatures) {VK_FALSE};
+
+  // present wait needs present id, so both are enabled or neither
+  VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {};
+  presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+  VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {};
+  presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+  presentIdFeatures.pNext = &presentWaitFeatures;
+
+  // task and mesh shaders only, mesh shader queries, multiview and shading
+  // rate stay off
+  VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures = {};
+  meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+
+  VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features = {};
+  synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+
+  VkPhysicalDeviceFeatures2 features2 = {};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+
+  bool optionalExtensionsAvailable = !app->headless;
+  for(int i = 0; i < globalOptionalDeviceExtensionCount; i++) {
+    if(!device_capabilities_has_extension(app->capabilities, globalOptionalDeviceExtensions[i]))
+      optionalExtensionsAvailable = false;
+  }
+
+  bool meshShaderExtensionsAvailable = globalConfig.meshlets == MESHLET_MODE_AUTO || globalConfig.meshlets == MESHLET_MODE_MESH_SHADER;
+  for(int i = 0; i < globalMeshShaderDeviceExtensionCount; i++) {
+    if(!device_capabilities_has_extension(app->capabilities, globalMeshShaderDeviceExtensions[i]))
+      meshShaderExtensionsAvailable = false;
+  }
+
+  if(optionalExtensionsAvailable)
+    features2.pNext = &presentIdFeatures;
+  if(meshShaderExtensionsAvailable) {
+    meshShaderFeatures.pNext = features2.pNext;
+    features2.pNext = &meshShaderFeatures;
+  }
+  bool synchronization2Available = device_capabilities_has_extension(app->capabilities, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+  if(synchronization2Available) {
+    synchronization2Features.pNext = features2.pNext;
+    features2.pNext = &synchronization2Features;
+  }
+  if(features2.pNext != NULL)
+    vkGetPhysicalDeviceFeatures2(app->physicalDevice, &features2);
+
+  app->framePacer.presentWaitEnabled = optionalExtensionsAvailable && presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+  app->meshShaderEnabled = meshShaderExtensionsAvailable && meshShaderFeatures.taskShader && meshShaderFeatures.meshShader;
+  bool synchronization2Enabled = synchronization2Available && synchronization2Features.synchronization2;
+
+  const char *enabledExtensions[sizeof(globalDeviceExtensions) / sizeof(globalDeviceExtensions[0])
+    + sizeof(globalOptionalDeviceExtensions) / sizeof(globalOptionalDeviceExtensions[0])
+    + sizeof(globalMeshShaderDeviceExtensions) / sizeof(globalMeshShaderDeviceExtensions[0]) + 2];
+  uint32_t enabledExtensionsCount = 0;
+
+  for(int i = 0; i < globalDeviceExtensionCount && !app->headless; i++) {
+    enabledExtensions[enabledExtensionsCount++] = globalDeviceExtensions[i];
+  }
+
+  // the compute meshlet path draws every meshlet of a frame with one indirect call when it can
+  app->deviceFeatures.multiDrawIndirect = app->capabilities->features.multiDrawIndirect;
+
+  features2.features = app->deviceFeatures;
+  features2.pNext = NULL;
+
+  if(app->framePacer.presentWaitEnabled) {
+    for(int i = 0; i < globalOptionalDeviceExtensionCount; i++) {
+      enabledExtensions[enabledExtensionsCount++] = globalOptionalDeviceExtensions[i];
+    }
+
+    presentIdFeatures.presentId = VK_TRUE;
+    presentWaitFeatures.presentWait = VK_TRUE;
+    features2.pNext = &presentIdFeatures;
+  }
+
+  if(app->meshShaderEnabled) {
+    for(int i = 0; i < globalMeshShaderDeviceExtensionCount; i++) {
+      enabledExtensions[enabledExtensionsCount++] = globalMeshShaderDeviceExtensions[i];
+    }
+
+    memset(&meshShaderFeatures, 0, sizeof(meshShaderFeatures));
+    meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+    meshShaderFeatures.taskShader = VK_TRUE;
+    meshShaderFeatures.meshShader = VK_TRUE;
+    meshShaderFeatures.pNext = features2.pNext;
+    features2.pNext = &meshShaderFeatures;
+  }
+
+  if(synchronization2Enabled) {
+    enabledExtensions[enabledExtensionsCount++] = VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME;
+
+    synchronization2Features.synchronization2 = VK_TRUE;
+    synchronization2Features.pNext = features2.pNext;
+    features2.pNext = &synchronization2Features;
+  }
+
+  createInfo.pEnabledFeatures = features2.pNext != NULL ? NULL : &app->deviceFeatures;
+
+  bool memoryBudgetSupported = device_capabilities_has_extension(app->capabilities, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  if(memoryBudgetSupported)
+    enabledExtensions[enabledExtensionsCount++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+
+  createInfo.enabledExtensionCount = enabledExtensionsCount;
+  createInfo.ppEnabledExtensionNames = enabledExtensions;
+
+  if(globalConfig.validation != VALIDATION_MODE_OFF) {
+    createInfo.enabledLayerCount = globalValidationLayersCount;
+    createInfo.ppEnabledLayerNames = globalValidationLayers;
+  }
+  else
+    createInfo.enabledLayerCount = 0;
+
+  createInfo.pNext = features2.pNext != NULL ? &features2 : NULL;
+  createInfo.flags = 0;
+
+  if (vkCreateDevice(app->physicalDevice, &createInfo, NULL, &app->device) != VK_SUCCESS) {
+    printf("failed to create logical device");
+    exit(1);
+  }
+
+  vkGetDeviceQueue(app->device, indices.graphicsFamily, 0, &app->graphicsQueue);
+  vkGetDeviceQueue(app->device, indices.presentFamily, 0, &app->presentQueue);
+  vkGetDeviceQueue(app->device, indices.transferFamily, 0, &app->transferQueue);
+  vkGetDeviceQueue(app->device, indices.computeFamily, 0, &app->computeQueue);
+
+  memory_tracker_init(&globalMemoryTracker, app->physicalDevice, memoryBudgetSupported);
+
+  if(app->framePacer.presentWaitEnabled)
+    app->framePacer.waitForPresent = (PFN_vkWaitForPresentKHR) vkGetDeviceProcAddr(app->device, "vkWaitForPresentKHR");
+
+  app->queueSubmit2 = synchronization2Enabled ? (PFN_vkQueueSubmit2KHR) vkGetDeviceProcAddr(app->device, "vkQueueSubmit2KHR") : NULL;
+  submit_batcher_init(&app->submitBatcher, app->queueSubmit2);
+
+  arena_pop_to(&app->scratchArena, scratchMark);
+}
+
+void app_private_init_vulkan_create_post_process(App *app) {
+  PostProcess *post = &app->postProcess;
+  memset(post, 0, sizeof(PostProcess));
+
+  post->pushConstants.exposure = 1.0f;
+  post->pushConstants.bloomThreshold = 1.0f;
+  post->pushConstants.bloomStrength = 0.3f;
+
+  if(!globalConfig.postProcess)
+    return;
+
+  for(int i = 0; i < app->outputsCount && !app->headless; i++) {
+    if(!(app->outputs[i].swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+      printf("swapchain of output %d cannot be blitted to, post processing disabled\n", i);
+      return;
+    }
+  }
+
+  VkShaderModule modules[POST_PASS_COUNT];
+  bool modulesLoaded = true;
+
+  for(int i = 0; i < POST_PASS_COUNT; i++) {
+    modules[i] = app_private_create_shader_module(app, globalPostShaderPaths[i]);
+    if(modules[i] == VK_NULL_HANDLE)
+      modulesLoaded = false;
+  }
+
+  if(!modulesLoaded) {
+    printf("post process shaders missing, rendering directly to the swapchain\n");
+    for(int i = 0; i < POST_PASS_COUNT; i++) {
+      if(modules[i] != VK_NULL_HANDLE)
+        vkDestroyShaderModule(app->device, modules[i], NULL);
+    }
+    return;
+  }
+
+  // binding 0 input, 1 output, 2 second input (tonemap reads the blurred bloom)
+  VkDescriptorSetLayoutBinding bindings[3] = {};
+  for(int i = 0; i < 3; i++) {
+    bindings[i].binding = i;
+    bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutInfo = {};
+  setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutInfo.bindingCount = 3;
+  setLayoutInfo.pBindings = bindings;
+
+  if(vkCreateDescriptorSetLayout(app->device, &setLayoutInfo, NULL, &post->setLayout) != VK_SUCCESS) {
+    printf("failed to create post process descriptor set layout\n");
+    exit(1);
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(PostProcessPushConstants);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &post->setLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  if(vkCreatePipelineLayout(app->device, &pipelineLayoutInfo, NULL, &post->pipelineLayout) != VK_SUCCESS) {
+    printf("failed to create post process pipeline layout\n");
+    exit(1);
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  poolSize.descriptorCount = app->outputsCount * POST_PASS_COUNT * 3;
+
+  VkDescriptorPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.maxSets = app->outputsCount * POST_PASS_COUNT;
+  poolInfo.poolSizeCount = 1;
+  poolInfo.pPoolSizes = &poolSize;
+
+  if(vkCreateDescriptorPool(app->device, &poolInfo, NULL, &post->descriptorPool) != VK_SUCCESS) {
+    printf("failed to create post process descriptor pool\n");
+    exit(1);
+  }
+
+  for(int i = 0; i < POST_PASS_COUNT; i++) {
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = modules[i];
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = post->pipelineLayout;
+
+    if(vkCreateComputePipelines(app->device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &post->pipelines[i]) != VK_SUCCESS) {
+      printf("failed to create post process pipeline %s\n", globalPostShaderPaths[i]);
+      exit(1);
+    }
+    memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_PIPELINE);
+
+    vkDestroyShaderModule(app->device, modules[i], NULL);
+  }
+
+  VkDescriptorSetLayout setLayouts[POST_PASS_COUNT];
+  for(int i = 0; i < POST_PASS_COUNT; i++) {
+    setLayouts[i] = post->setLayout;
+  }
+
+  VkDescriptorSetAllocateInfo setAllocInfo = {};
+  setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  setAllocInfo.descriptorPool = post->descriptorPool;
+  setAllocInfo.descriptorSetCount = POST_PASS_COUNT;
+  setAllocInfo.pSetLayouts = setLayouts;
+
+  for(int i = 0; i < app->outputsCount; i++) {
+    VkDescriptorSet sets[POST_PASS_COUNT];
+    if(vkAllocateDescriptorSets(app->device, &setAllocInfo, sets) != VK_SUCCESS) {
+      printf("failed to allocate post process descriptor sets\n");
+      exit(1);
+    }
+
+    for(int j = 0; j < POST_PASS_COUNT; j++) {
+      PostProcessPass *pass = &app->outputs[i].post.passes[j];
+      pass->pipeline = post->pipelines[j];
+      pass->layout = post->pipelineLayout;
+      pass->descriptorSet = sets[j];
+      pass->pushConstants = &app->outputs[i].post.pushConstants;
+    }
+  }
+
+  QueueFamilyIndices indices = app->capabilities->queueFamilyIndices;
+  post->asyncCompute = indices.computeFamily != indices.graphicsFamily;
+  post->enabled = true;
+
+  printf("post processing enabled%s\n", post->asyncCompute ? " on the async compute queue" : "");
+}
+
+void app_private_update_post_process_descriptors(App *app, Output *output) {
+  PostProcessTargets *targets = &output->post;
+  FrameGraph *graph = &app->frameGraph;
+
+  // input, output, second input per pass
+  uint32_t images[POST_PASS_COUNT][3] = {
+    [POST_PASS_DOWNSAMPLE] = {targets->sceneImage, targets->bloomImage, UINT32_MAX},
+    [POST_PASS_BLUR] = {targets->bloomImage, targets->bloomBlurredImage, UINT32_MAX},
+    [POST_PASS_TONEMAP] = {targets->sceneImage, targets->outputImage, targets->bloomBlurredImage}
+  };
+
+  VkDescriptorImageInfo imageInfos[POST_PASS_COUNT * 3];
+  VkWriteDescriptorSet writes[POST_PASS_COUNT * 3];
+  uint32_t writesCount = 0;
+
+  for(int i = 0; i < POST_PASS_COUNT; i++) {
+    for(int j = 0; j < 3; j++) {
+      if(images[i][j] == UINT32_MAX)
+        continue;
+
+      VkDescriptorImageInfo *imageInfo = &imageInfos[writesCount];
+      imageInfo->sampler = VK_NULL_HANDLE;
+      imageInfo->imageView = frame_graph_get_view(graph, images[i][j]);
+      imageInfo->imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+      VkWriteDescriptorSet *write = &writes[writesCount++];
+      memset(write, 0, sizeof(VkWriteDescriptorSet));
+      write->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      write->dstSet = targets->passes[i].descriptorSet;
+      write->dstBinding = j;
+      write->descriptorCount = 1;
+      write->descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+      write->pImageInfo = imageInfo;
+    }
+  }
+
+  vkUpdateDescriptorSets(app->device, writesCount, writes, 0, NULL);
+}
+
+void app_private_frame_graph_post_pass(VkCommandBuffer commandBuffer, void *passData, void *frameData) {
+  PostProcessPass *pass = passData;
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pass->pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pass->layout, 0, 1, &pass->descriptorSet, 0, NULL);
+  vkCmdPushConstants(commandBuffer, pass->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PostProcessPushConstants), pass->pushConstants);
+  vkCmdDispatch(commandBuffer, pass->groupsX, pass->groupsY, 1);
+}
+
+void app_private_frame_graph_blit_pass(VkCommandBuffer commandBuffer, void *passData, void *frameData) {
+  Output *output = passData;
+  FrameContext *frame = frameData;
+  App *app = frame->app;
+
+  // the upscale of dynamic resolution, a plain copy at full size
+  VkImageBlit region = {};
+  region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.srcSubresource.layerCount = 1;
+  region.srcOffsets[1].x = output->renderExtent.width;
+  region.srcOffsets[1].y = output->renderExtent.height;
+  region.srcOffsets[1].z = 1;
+  region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.dstSubresource.layerCount = 1;
+  region.dstOffsets[1].x = output->swapChainExtent.width;
+  region.dstOffsets[1].y = output->swapChainExtent.height;
+  region.dstOffsets[1].z = 1;
+
+  vkCmdBlitImage(commandBuffer,
+    frame_graph_get_image(&app->frameGraph, output->post.outputImage), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+    frame_graph_get_image(&app->frameGraph, output->frameGraphSwapChainImage), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+    1, &region, VK_FILTER_LINEAR);
+}
+
+void app_private_init_vulkan_create_swap_chain(App *app, Output *output) {
+  if(app->headless) {
+    app_private_init_vulkan_create_headless_targets(app, output);
+    return;
+  }
+
+  SwapChainSupportDetails swapChainSupport = output->swapChainSupport;
+  Output *primary = &app->outputs[0];
+
+  VkSurfaceFormatKHR surfaceFormat = app_private_init_vulkan_create_swap_chain_choose_format(swapChainSupport.formats, swapChainSupport.formatsCount);
+  VkPresentModeKHR presentMode = app_private_init_vulkan_create_swap_chain_choose_present_mode(swapChainSupport.presentModes, swapChainSupport.presentModesCount, app->framePacer.policy);
+  VkExtent2D extent = app_private_init_vulkan_create_swap_chain_choose_swap_extend(&swapChainSupport.capabilities, output->window);
+
+  // without post processing every output renders through the one render pass,
+  // which is built for the primary output's format; the blit converts otherwise
+  if(output != primary && !app->postProcess.enabled && surfaceFormat.format != primary->swapChainImageFormat) {
+    bool formatFound = false;
+    for(int i = 0; i < swapChainSupport.formatsCount && !formatFound; i++) {
+      if(swapChainSupport.formats[i].format == primary->swapChainImageFormat) {
+        surfaceFormat = swapChainSupport.formats[i];
+        formatFound = true;
+      }
+    }
+
+    if(!formatFound) {
+      printf("output %d does not support the primary output's format\n", (int)(output - app->outputs));
+      exit(1);
+    }
+  }
+
+  uint32_t imageCount = app_private_init_vulkan_create_swap_chain_choose_image_count(&swapChainSupport.capabilities, presentMode);
+
+  VkSwapchainCreateInfoKHR createInfo;
+  createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+  createInfo.surface = output->surface;
+  createInfo.minImageCount = imageCount;
+  createInfo.imageFormat = surfaceFormat.format;
+  createInfo.imageColorSpace = surfaceFormat.colorSpace;
+  createInfo.imageExtent = extent;
+  createInfo.imageArrayLayers = 1;
+  createInfo.imageUsage = app->postProcess.enabled ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+  QueueFamilyIndices indices = app->capabilities->queueFamilyIndices;
+  uint32_t queueFamilyIndices[] = {indices.graphicsFamily, indices.presentFamily};
+
+  if(indices.graphicsFamily != indices.presentFamily) {
+    createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+    createInfo.queueFamilyIndexCount = 2;
+    createInfo.pQueueFamilyIndices = queueFamilyIndices;
+  } else {
+    createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    createInfo.queueFamilyIndexCount = 0;
+    createInfo.pQueueFamilyIndices = NULL;
+  }
+  createInfo.preTransform = swapChainSupport.capabilities.currentTransform;
+  createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+  createInfo.presentMode = presentMode;
+  createInfo.clipped = VK_TRUE;
+  createInfo.oldSwapchain = VK_NULL_HANDLE;
+  createInfo.pNext = NULL;
+  createInfo.flags = 0;
+
+  if(vkCreateSwapchainKHR(app->device, &createInfo, NULL, &output->swapChain) != VK_SUCCESS) {
+    printf("failed to create swapchain\n");
+    exit(1);
+  }
+
+  vkGetSwapchainImagesKHR(app->device, output->swapChain, &imageCount, NULL);
+  output->swapChainImagesCount = imageCount;
+  output->swapChainImages = ARENA_ALLOC_ARRAY(&output->swapChainArena, VkImage, imageCount);
+  vkGetSwapchainImagesKHR(app->device, output->swapChain, &imageCount, output->swapChainImages);
+
+  output->swapChainImageFormat = surfaceFormat.format;
+  output->swapChainExtent = extent;
+
+  if(output == primary)
+    frame_pacer_swap_chain_recreated(&app->framePacer, presentMode, imageCount);
+}
+
+VkSurfaceFormatKHR app_private_init_vulkan_create_swap_chain_choose_format(VkSurfaceFormatKHR *availableFormats, uint32_t count) {
+  for(int i = 0; i < count; i++) {
+    if(availableFormats[i].format == VK_FORMAT_B8G8R8A8_SRGB && availableFormats[i].colorSpace == VK_COLORSPACE_SRGB_NONLINEAR_KHR) {
+      return availableFormats[i];
+    }
+  }
+  return availableFormats[0];
+}
+
+VkPresentModeKHR app_private_init_vulkan_create_swap_chain_choose_present_mode(VkPresentModeKHR *availablePresentModes, uint32_t count, PresentPolicy policy) {
+  VkPresentModeKHR preferred[2];
+  uint32_t preferredCount = 0;
+
+  switch(policy) {
+    case PRESENT_POLICY_LOW_LATENCY:
+      preferred[preferredCount++] = VK_PRESENT_MODE_IMMEDIATE_KHR;
+      preferred[preferredCount++] = VK_PRESENT_MODE_MAILBOX_KHR;
+      break;
+    case PRESENT_POLICY_FIFO_RELAXED:
+      preferred[preferredCount++] = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+      break;
+    case PRESENT_POLICY_POWER_SAVING:
+      break;
+  }
+
+  for(int i = 0; i < preferredCount; i++) {
+    for(int j = 0; j < count; j++) {
+      if(availablePresentModes[j] == preferred[i])
+        return preferred[i];
+    }
+  }
+  return VK_PRESENT_MODE_FIFO_KHR; // always supported
+}
+
+uint32_t app_private_init_vulkan_create_swap_chain_choose_image_count(VkSurfaceCapabilitiesKHR *capabilities, VkPresentModeKHR presentMode) {
+  uint32_t imageCount;
+
+  switch(presentMode) {
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+      // one image on screen, one queued, one to render into
+      imageCount = 3;
+      break;
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+      // nothing ever waits for vblank, extra images only add queueing
+      imageCount = 2;
+      break;
+    default:
+      imageCount = capabilities->minImageCount + 1;
+      break;
+  }
+
+  if(imageCount < capabilities->minImageCount)
+    imageCount = capabilities->minImageCount;
+  if(capabilities->maxImageCount > 0 && imageCount > capabilities->maxImageCount)
+    imageCount = capabilities->maxImageCount;
+
+  return imageCount;
+}
+
+VkExtent2D app_private_init_vulkan_create_swap_chain_choose_swap_extend(VkSurfaceCapabilitiesKHR *capabilities, GLFWwindow* window) {
+  if(capabilities->currentExtent.width != UINT32_MAX) {
+    return capabilities->currentExtent;
+  } else {
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(window, &width, &height);
+
+    VkExtent2D actualExtend = {
+      fmin(capabilities->maxImageExtent.width, fmax(width, capabilities->minImageExtent.width)),
+      fmin(capabilities->maxImageExtent.height, fmax(height, capabilities->minImageExtent.height))
+    };
+    return actualExtend;
+  }
+}
+
+void app_private_recreate_swap_chain(App *app, uint32_t outputMask) {
+  // a minimized output keeps its old swapchain and stays marked resized, the
+  // frame after it comes back presents and rebuilds it
+  for(int i = 0; i < app->outputsCount && !app->headless; i++) {
+    if(!(outputMask & (1u << i)))
+      continue;
+
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(app->outputs[i].window, &width, &height);
+    app->outputs[i].framebufferResized = width == 0 || height == 0;
+    if(app->outputs[i].framebufferResized)
+      outputMask &= ~(1u << i);
+  }
+
+  if(outputMask == 0)
+    return;
+
+  vkDeviceWaitIdle(app->device);
+
+  // the graph spans every output, so it is rebuilt even if only one changed
+  app_private_cleanup_frame_graph(app);
+
+  for(int i = 0; i < app->outputsCount; i++) {
+    Output *output = &app->outputs[i];
+    if(!(outputMask & (1u << i)))
+      continue;
+
+    app_private_cleanup_swap_chain(app, output);
+
+    // formats and present modes do not change with the window size, only the
+    // current extent does
+    if(!app->headless)
+      vkGetPhysicalDeviceSurfaceCapabilitiesKHR(app->physicalDevice, output->surface, &output->swapChainSupport.capabilities);
+
+    app_private_init_vulkan_create_swap_chain(app, output);
+    app_private_init_vulkan_create_image_views(app, output);
+  }
+
+  app_private_init_vulkan_create_frame_graph(app);
+}
+
+void app_private_cleanup_swap_chain(App *app, Output *output) {
+  for(int i = 0; i < output->swapChainImagesCount; i++) {
+    memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_IMAGE_VIEW);
+    vkDestroyImageView(app->device, output->swapChainImageViews[i], NULL);
+  }
+
+  if(app->headless) {
+    for(int i = 0; i < output->swapChainImagesCount; i++) {
+      memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_IMAGE);
+      vkDestroyImage(app->device, output->swapChainImages[i], NULL);
+      memory_tracker_free(&globalMemoryTracker, app->device, output->headlessImageMemory[i]);
+    }
+
+    for(int i = 0; i < globalConfig.framesInFlight && globalConfig.readback; i++) {
+      vkUnmapMemory(app->device, output->readbackMemory[i]);
+      memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_BUFFER);
+      vkDestroyBuffer(app->device, output->readbackBuffers[i], NULL);
+      memory_tracker_free(&globalMemoryTracker, app->device, output->readbackMemory[i]);
+    }
+  }
+  else {
+    vkDestroySwapchainKHR(app->device, output->swapChain, NULL);
+
+    for(int i = 0; i < output->swapChainImagesCount; i++) {
+      vkDestroySemaphore(app->device, output->renderFinishedSemaphores[i], NULL);
+    }
+  }
+
+  arena_reset(&output->swapChainArena);
+}
+
+void app_private_cleanup_frame_graph(App *app) {
+  frame_graph_destroy(&app->frameGraph);
+
+  for(int i = 0; i < app->outputsCount; i++) {
+    Output *output = &app->outputs[i];
+
+    for(int j = 0; j < output->swapChainFrameBuffersCount; j++) {
+      memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_FRAMEBUFFER);
+      vkDestroyFramebuffer(app->device, output->swapChainFrameBuffers[j], NULL);
+    }
+    output->swapChainFrameBuffersCount = 0;
+
+    if(app->postProcess.enabled) {
+      memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_FRAMEBUFFER);
+      vkDestroyFramebuffer(app->device, output->post.sceneFrameBuffer, NULL);
+    }
+
+    if(app->meshlets.occlusion) {
+      for(int j = 0; j < output->hiz.mipsCount; j++) {
+        memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_IMAGE_VIEW);
+        vkDestroyImageView(app->device, output->hiz.mipViews[j], NULL);
+      }
+      vkDestroyDescriptorPool(app->device, output->hiz.descriptorPool, NULL);
+      output->hiz.mipsCount = 0;
+    }
+  }
+}
+
+void app_private_init_vulkan_create_image_views(App* app, Output *output) {
+  output->swapChainImageViews = ARENA_ALLOC_ARRAY(&output->swapChainArena, VkImageView, output->swapChainImagesCount);
+  // filled by app_private_init_vulkan_create_frame_buffers with every graph rebuild
+  output->swapChainFrameBuffers = ARENA_ALLOC_ARRAY(&output->swapChainArena, VkFramebuffer, output->swapChainImagesCount);
+  output->swapChainFrameBuffersCount = 0;
+
+  for(int i = 0; i < output->swapChainImagesCount; i++) {
+    VkImageViewCreateInfo createInfo;
+    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    createInfo.image = output->swapChainImages[i];
+    createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    createInfo.format = output->swapChainImageFormat;
+    createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    createInfo.subresourceRange.baseMipLevel = 0;
+    createInfo.subresourceRange.levelCount = 1;
+    createInfo.subresourceRange.baseArrayLayer = 0;
+    createInfo.subresourceRange.layerCount = 1;
+    createInfo.pNext = NULL;
+    createInfo.flags = 0;
+
+    if(vkCreateImageView(app->device, &createInfo, NULL, &output->swapChainImageViews[i]) != VK_SUCCESS) {
+      printf("failed to create image view\n");
+      exit(1);
+    }
+    memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_IMAGE_VIEW);
+  }
+
+  if(app->headless) {
+    output->renderFinishedSemaphores = NULL;
+    return;
+  }
+
+  VkSemaphoreCreateInfo semaphoreInfo = {};
+  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+  output->renderFinishedSemaphores = ARENA_ALLOC_ARRAY(&output->swapChainArena, VkSemaphore, output->swapChainImagesCount);
+  for(int i = 0; i < output->swapChainImagesCount; i++) {
+    if(vkCreateSemaphore(app->device, &semaphoreInfo, NULL, &output->renderFinishedSemaphores[i]) != VK_SUCCESS) {
+      printf("failed to create sync objects");
+      exit(1);
+    }
+  }
+}
+
+void app_private_init_vulkan_create_render_pass(App *app) {
+  // D16_UNORM is guaranteed as a sampled depth attachment, the pyramid build samples it
+  VkFormatFeatureFlags depthFeatures = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+  VkFormatProperties formatProperties;
+  vkGetPhysicalDeviceFormatProperties(app->physicalDevice, VK_FORMAT_D32_SFLOAT, &formatProperties);
+  app->depthFormat = (formatProperties.optimalTilingFeatures & depthFeatures) == depthFeatures ? VK_FORMAT_D32_SFLOAT : VK_FORMAT_D16_UNORM;
+
+  VkAttachmentDescription attachments[2] = {};
+  VkAttachmentDescription *colorAttachment = &attachments[0];
+  colorAttachment->format = app->postProcess.enabled ? POST_SCENE_FORMAT : app->outputs[0].swapChainImageFormat;
+  colorAttachment->samples = VK_SAMPLE_COUNT_1_BIT;
+  colorAttachment->loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment->storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment->stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  colorAttachment->stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  // layout transitions and synchronization around the pass come from the frame graph
+  colorAttachment->initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  colorAttachment->finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  // stored for the depth pyramid, which reads it between the two render passes
+  VkAttachmentDescription *depthAttachment = &attachments[1];
+  depthAttachment->format = app->depthFormat;
+  depthAttachment->samples = VK_SAMPLE_COUNT_1_BIT;
+  depthAttachment->loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAttachment->storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  depthAttachment->stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAttachment->stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment->initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depthAttachment->finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference colorAttachmentRef = {};
+  colorAttachmentRef.attachment = 0;
+  colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference depthAttachmentRef = {};
+  depthAttachmentRef.attachment = 1;
+  depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription subpass = {};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorAttachmentRef;
+  subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+  VkRenderPassCreateInfo renderPassInfo = {};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = 2;
+  renderPassInfo.pAttachments = attachments;
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = 0;
+  renderPassInfo.pDependencies = NULL;
+
+  if(vkCreateRenderPass(app->device, &renderPassInfo, NULL, &app->renderPass) != VK_SUCCESS) {
+    printf("failed to create render pass\n");
+    exit(1);
+  }
+
+  // compatible with the first, so pipelines and framebuffers are shared.
+  // nothing reads the depth buffer after the late phase
+  colorAttachment->loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  depthAttachment->loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  depthAttachment->storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+  if(vkCreateRenderPass(app->device, &renderPassInfo, NULL, &app->lateRenderPass) != VK_SUCCESS) {
+    printf("failed to create late render pass\n");
+    exit(1);
+  }
+}
+
+void app_private_init_vulkan_create_graphics_pipeline(App *app) {
+  VkShaderModule vertModule = app_private_create_shader_module(app, "shaders/vert.spv");
+  VkShaderModule fragModule = app_private_create_shader_module(app, "shaders/frag.spv");
+
+  if(vertModule == VK_NULL_HANDLE || fragModule == VK_NULL_HANDLE) {
+    printf("failed to load shader code\n");
+    exit(1);
+  }
+
+  VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+  vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+  vertexInputInfo.vertexBindingDescriptionCount = 0;
+  vertexInputInfo.pVertexBindingDescriptions = NULL;
+  vertexInputInfo.vertexAttributeDescriptionCount = 0;
+  vertexInputInfo.pVertexAttributeDescriptions = NULL;
+  vertexInputInfo.pNext = NULL;
+  vertexInputInfo.flags = 0;
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 0;
+  pipelineLayoutInfo.pSetLayouts = NULL;
+  pipelineLayoutInfo.pushConstantRangeCount = 0;
+  pipelineLayoutInfo.pPushConstantRanges = NULL;
+  pipelineLayoutInfo.pNext = NULL;
+  pipelineLayoutInfo.flags = 0;
+
+  if(vkCreatePipelineLayout(app->device, &pipelineLayoutInfo, NULL, &app->pipelineLayout) != VK_SUCCESS) {
+    printf("failed to create pipeline layout\n");
+    exit(1);
+  }
+
+  VkPipelineShaderStageCreateInfo stages[] = {
+    app_private_shader_stage(VK_SHADER_STAGE_VERTEX_BIT, vertModule, NULL),
+    app_private_shader_stage(VK_SHADER_STAGE_FRAGMENT_BIT, fragModule, NULL)
+  };
+  app->graphicsPipeline = app_private_build_graphics_pipeline(app, stages, 2, &vertexInputInfo, VK_FRONT_FACE_CLOCKWISE, app->pipelineLayout);
+
+  vkDestroyShaderModule(app->device, fragModule, NULL);
+  vkDestroyShaderModule(app->device, vertModule, NULL);
+}
+
+// vertexInputInfo is NULL for mesh shading pipelines, which have neither
+// vertex input nor input assembly
+VkPipeline app_private_build_graphics_pipeline(App *app, const VkPipelineShaderStageCreateInfo *stages, uint32_t stagesCount, const VkPipelineVertexInputStateCreateInfo *vertexInputInfo, VkFrontFace frontFace, VkPipelineLayout layout) {
+  uint32_t dynamicStatesSize = 2;
+  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamicState = {};
+  dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+  dynamicState.dynamicStateCount = dynamicStatesSize,
+  dynamicState.pDynamicStates = dynamicStates;
+  dynamicState.pNext = NULL;
+  dynamicState.flags = 0;
+
+  VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+  inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  inputAssembly.primitiveRestartEnable = VK_FALSE;
+  inputAssembly.pNext = NULL;
+  inputAssembly.flags = 0;
+
+  VkViewport viewport = {};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = (float)app->outputs[0].swapChainExtent.width;
+  viewport.height = (float)app->outputs[0].swapChainExtent.height;
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+
+  VkRect2D scissor = {};
+  VkOffset2D offset = {0, 0};
+  scissor.offset = offset;
+  scissor.extent = app->outputs[0].swapChainExtent;
+
+  VkPipelineViewportStateCreateInfo viewportState = {};
+  viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewportState.viewportCount = 1;
+  viewportState.pViewports = &viewport;
+  viewportState.scissorCount = 1;
+  viewportState.pScissors = &scissor;
+  viewportState.pNext = NULL;
+  viewportState.flags = 0;
+
+  VkPipelineRasterizationStateCreateInfo rasterizer = {};
+  rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterizer.depthClampEnable = VK_FALSE;
+  rasterizer.rasterizerDiscardEnable = VK_FALSE;
+  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+  rasterizer.frontFace = frontFace;
+  rasterizer.depthBiasEnable = VK_FALSE;
+  rasterizer.depthBiasConstantFactor = 0.0f;
+  rasterizer.depthBiasClamp = 0.0f;
+  rasterizer.depthBiasSlopeFactor = 0.0f;
+  rasterizer.lineWidth = 1.0f;
+  rasterizer.pNext = NULL;
+  rasterizer.flags = 0;
+
+  VkPipelineMultisampleStateCreateInfo multisampling = {};
+  multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  multisampling.sampleShadingEnable = VK_FALSE;
+  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+  multisampling.minSampleShading = 1.0f;
+  multisampling.pSampleMask = NULL;
+  multisampling.alphaToCoverageEnable = VK_FALSE;
+  multisampling.alphaToOneEnable = VK_FALSE;
+  multisampling.pNext = NULL;
+  multisampling.flags = 0;
+
+  VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+  colorBlendAttachment.colorWriteMask =
+      VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+      VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+  colorBlendAttachment.blendEnable = VK_FALSE;
+  colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+  colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+  colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+  colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+  colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+  VkPipelineColorBlendStateCreateInfo colorBlending = {};
+  colorBlending.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  colorBlending.logicOpEnable = VK_FALSE;
+  colorBlending.logicOp = VK_LOGIC_OP_COPY;
+  colorBlending.attachmentCount = 1;
+  colorBlending.pAttachments = &colorBlendAttachment;
+  colorBlending.blendConstants[0] = 0.0f;
+  colorBlending.blendConstants[1] = 0.0f;
+  colorBlending.blendConstants[2] = 0.0f;
+  colorBlending.blendConstants[3] = 0.0f;
+  colorBlending.pNext = NULL;
+  colorBlending.flags = 0;
+
+  VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+  depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+  depthStencil.depthTestEnable = VK_TRUE;
+  depthStencil.depthWriteEnable = VK_TRUE;
+  depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+  depthStencil.depthBoundsTestEnable = VK_FALSE;
+  depthStencil.stencilTestEnable = VK_FALSE;
+  depthStencil.pNext = NULL;
+  depthStencil.flags = 0;
+
+  VkGraphicsPipelineCreateInfo pipelineInfo = {};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipelineInfo.stageCount = stagesCount;
+  pipelineInfo.pStages = stages;
+  pipelineInfo.pVertexInputState = vertexInputInfo;
+  pipelineInfo.pInputAssemblyState = vertexInputInfo != NULL ? &inputAssembly : NULL;
+  pipelineInfo.pViewportState = &viewportState;
+  pipelineInfo.pRasterizationState = &rasterizer;
+  pipelineInfo.pMultisampleState = &multisampling;
+  pipelineInfo.pDepthStencilState = &depthStencil;
+  pipelineInfo.pColorBlendState = &colorBlending;
+  pipelineInfo.pDynamicState = &dynamicState;
+  pipelineInfo.layout = layout;
+  pipelineInfo.renderPass = app->renderPass;
+  pipelineInfo.subpass = 0;
+  pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+  pipelineInfo.basePipelineIndex = -1;
+  pipelineInfo.pNext = NULL;
+  pipelineInfo.flags = 0;
+
+  VkPipeline pipeline;
+  if(vkCreateGraphicsPipelines(app->device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &pipeline) != VK_SUCCESS) {
+    printf("failed to create graphics pipeline\n");
+    exit(1);
+  }
+  memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_PIPELINE);
+
+  return pipeline;
+}
+
+VkPipelineShaderStageCreateInfo app_private_shader_stage(VkShaderStageFlagBits stage, VkShaderModule module, const VkSpecializationInfo *specialization) {
+  VkPipelineShaderStageCreateInfo stageInfo = {};
+  stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  stageInfo.stage = stage;
+  stageInfo.module = module;
+  stageInfo.pName = "main";
+  stageInfo.pSpecializationInfo = specialization;
+  stageInfo.pNext = NULL;
+  stageInfo.flags = 0;
+  return stageInfo;
+}
+
+void app_private_init_vulkan_create_frame_buffers(App* app, Output *output) {
+  // the depth buffer and, with post processing, the scene image are frame
+  // graph images, so the framebuffers are rebuilt along with the graph
+  VkImageView attachments[2] = {VK_NULL_HANDLE, frame_graph_get_view(&app->frameGraph, output->frameGraphDepthImage)};
+
+  VkFramebufferCreateInfo framebufferInfo = {};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = app->renderPass;
+  framebufferInfo.attachmentCount = 2;
+  framebufferInfo.pAttachments = attachments;
+  framebufferInfo.width = output->swapChainExtent.width;
+  framebufferInfo.height = output->swapChainExtent.height;
+  framebufferInfo.layers = 1;
+
+  if(app->postProcess.enabled) {
+    attachments[0] = frame_graph_get_view(&app->frameGraph, output->post.sceneImage);
+
+    if(vkCreateFramebuffer(app->device, &framebufferInfo, NULL, &output->post.sceneFrameBuffer) != VK_SUCCESS) {
+      printf("failed to create scene frame buffer\n");
+      exit(1);
+    }
+    memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_FRAMEBUFFER);
+    return;
+  }
+
+  for(int i = 0; i < output->swapChainImagesCount; i++) {
+    attachments[0] = output->swapChainImageViews[i];
+
+    if(vkCreateFramebuffer(app->device, &framebufferInfo, NULL, &output->swapChainFrameBuffers[i]) != VK_SUCCESS) {
+      printf("failed to create %i. frame buffer\n", i);
+      exit(1);
+    }
+    memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_FRAMEBUFFER);
+    output->swapChainFrameBuffersCount++;
+  }
+}
+
+void app_private_init_vulkan_create_frame_graph(App *app) {
+  FrameGraph *graph = &app->frameGraph;
+  QueueFamilyIndices indices = app->capabilities->queueFamilyIndices;
+  PostProcess *post = &app->postProcess;
+  bool occlusion = app->meshlets.occlusion;
+
+  frame_graph_init(graph, app->device, &app->capabilities->memoryProperties);
+  frame_graph_set_queue_families(graph, indices.graphicsFamily, indices.computeFamily);
+  frame_graph_enable_timestamps(graph, app->capabilities->properties.limits.timestampPeriod,
+    globalConfig.gpuTimings && app->capabilities->queueFamilies[indices.graphicsFamily].timestampValidBits > 0,
+    globalConfig.gpuTimings && app->capabilities->queueFamilies[indices.computeFamily].timestampValidBits > 0);
+
+  // the submit that first touches the swapchain image waits on the image
+  // available semaphore at this stage, so that is where the image's history starts
+  VkPipelineStageFlags swapChainFirstStages = post->enabled ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+  for(int i = 0; i < app->outputsCount; i++) {
+    Output *output = &app->outputs[i];
+    output->frameGraphSwapChainImage = frame_graph_import_image(graph, "swapchain", output->swapChainImageFormat, output->swapChainExtent,
+      VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, swapChainFirstStages,
+      app->headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+    VkExtent2D extent = output->swapChainExtent;
+    output->frameGraphDepthImage = frame_graph_create_image(graph, "depth", app->depthFormat, extent, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+    if(occlusion) {
+      HizTargets *hiz = &output->hiz;
+      hiz->pyramidExtent.width = (extent.width + 1) / 2;
+      hiz->pyramidExtent.height = (extent.height + 1) / 2;
+      hiz->mipsCount = 1;
+      for(uint32_t size = hiz->pyramidExtent.width > hiz->pyramidExtent.height ? hiz->pyramidExtent.width : hiz->pyramidExtent.height; size > 1; size /= 2)
+        hiz->mipsCount++;
+
+      hiz->pyramidImage = frame_graph_create_image(graph, "hi-z", VK_FORMAT_R32_SFLOAT, hiz->pyramidExtent, VK_IMAGE_ASPECT_COLOR_BIT);
+      frame_graph_set_mip_levels(graph, hiz->pyramidImage, hiz->mipsCount);
+    }
+
+    if(!post->enabled)
+      continue;
+
+    VkExtent2D halfExtent = {(extent.width + 1) / 2, (extent.height + 1) / 2};
+
+    output->post.sceneImage = frame_graph_create_image(graph, "scene", POST_SCENE_FORMAT, extent, VK_IMAGE_ASPECT_COLOR_BIT);
+    output->post.bloomImage = frame_graph_create_image(graph, "bloom", POST_SCENE_FORMAT, halfExtent, VK_IMAGE_ASPECT_COLOR_BIT);
+    output->post.bloomBlurredImage = frame_graph_create_image(graph, "bloom blurred", POST_SCENE_FORMAT, halfExtent, VK_IMAGE_ASPECT_COLOR_BIT);
+    output->post.outputImage = frame_graph_create_image(graph, "ldr", POST_OUTPUT_FORMAT, extent, VK_IMAGE_ASPECT_COLOR_BIT);
+  }
+
+  // passes are grouped by kind across outputs rather than by output, so async
+  // compute keeps the frame at three queue segments however many outputs there are
+  for(int i = 0; i < app->outputsCount; i++) {
+    Output *output = &app->outputs[i];
+    uint32_t mainPass = frame_graph_add_pass(graph, "main", app_private_frame_graph_main_pass, output);
+    frame_graph_pass_use(graph, mainPass, post->enabled ? output->post.sceneImage : output->frameGraphSwapChainImage, FRAME_GRAPH_ACCESS_COLOR_ATTACHMENT_WRITE);
+    frame_graph_pass_use(graph, mainPass, output->frameGraphDepthImage, FRAME_GRAPH_ACCESS_DEPTH_ATTACHMENT_WRITE);
+  }
+
+  // the pyramid is built from the early phase's depth on the graphics queue,
+  // the late phase right behind it cannot start any earlier
+  for(int i = 0; i < app->outputsCount && occlusion; i++) {
+    Output *output = &app->outputs[i];
+    uint32_t hizPass = frame_graph_add_pass(graph, "hi-z", app_private_frame_graph_hiz_pass, output);
+    frame_graph_pass_use(graph, hizPass, output->frameGraphDepthImage, FRAME_GRAPH_ACCESS_COMPUTE_SAMPLED_READ);
+    frame_graph_pass_use(graph, hizPass, output->hiz.pyramidImage, FRAME_GRAPH_ACCESS_COMPUTE_STORAGE_WRITE);
+  }
+
+  for(int i = 0; i < app->outputsCount && occlusion; i++) {
+    Output *output = &app->outputs[i];
+    uint32_t latePass = frame_graph_add_pass(graph, "main late", app_private_frame_graph_late_pass, output);
+    frame_graph_pass_use(graph, latePass, post->enabled ? output->post.sceneImage : output->frameGraphSwapChainImage, FRAME_GRAPH_ACCESS_COLOR_ATTACHMENT_WRITE);
+    frame_graph_pass_use(graph, latePass, output->frameGraphDepthImage, FRAME_GRAPH_ACCESS_DEPTH_ATTACHMENT_WRITE);
+    frame_graph_pass_use(graph, latePass, output->hiz.pyramidImage,
+      app->meshlets.path == MESHLET_PATH_COMPUTE ? FRAME_GRAPH_ACCESS_COMPUTE_SAMPLED_READ : FRAME_GRAPH_ACCESS_TASK_SAMPLED_READ);
+  }
+
+  if(post->enabled)
+    app_private_init_vulkan_create_frame_graph_post(app);
+
+  app_private_init_vulkan_create_frame_graph_readback(app);
+  frame_graph_compile(graph);
+
+  for(int i = 0; i < app->outputsCount; i++) {
+    Output *output = &app->outputs[i];
+    app_private_init_vulkan_create_frame_buffers(app, output);
+
+    if(post->enabled)
+      app_private_update_post_process_descriptors(app, output);
+    if(occlusion)
+      app_private_init_vulkan_create_frame_graph_hiz(app, output);
+  }
+}
+
+void app_private_init_vulkan_create_frame_graph_post(App *app) {
+  FrameGraph *graph = &app->frameGraph;
+  PostProcess *post = &app->postProcess;
+  FrameGraphQueue postQueue = post->asyncCompute ? FRAME_GRAPH_QUEUE_COMPUTE : FRAME_GRAPH_QUEUE_GRAPHICS;
+
+  for(int i = 0; i < app->outputsCount; i++) {
+    PostProcessTargets *targets = &app->outputs[i].post;
+
+    PostProcessPass *downsample = &targets->passes[POST_PASS_DOWNSAMPLE];
+    uint32_t downsamplePass = frame_graph_add_pass(graph, "downsample", app_private_frame_graph_post_pass, downsample);
+    frame_graph_pass_set_queue(graph, downsamplePass, postQueue);
+    frame_graph_pass_use(graph, downsamplePass, targets->sceneImage, FRAME_GRAPH_ACCESS_COMPUTE_STORAGE_READ);
+    frame_graph_pass_use(graph, downsamplePass, targets->bloomImage, FRAME_GRAPH_ACCESS_COMPUTE_STORAGE_WRITE);
+
+    PostProcessPass *blur = &targets->passes[POST_PASS_BLUR];
+    uint32_t blurPass = frame_graph_add_pass(graph, "blur", app_private_frame_graph_post_pass, blur);
+    frame_graph_pass_set_queue(graph, blurPass, postQueue);
+    frame_graph_pass_use(graph, blurPass, targets->bloomImage, FRAME_GRAPH_ACCESS_COMPUTE_STORAGE_READ);
+    frame_graph_pass_use(graph, blurPass, targets->bloomBlurredImage, FRAME_GRAPH_ACCESS_COMPUTE_STORAGE_WRITE);
+
+    PostProcessPass *tonemap = &targets->passes[POST_PASS_TONEMAP];
+    uint32_t tonemapPass = frame_graph_add_pass(graph, "tonemap", app_private_frame_graph_post_pass, tonemap);
+    frame_graph_pass_set_queue(graph, tonemapPass, postQueue);
+    frame_graph_pass_use(graph, tonemapPass, targets->sceneImage, FRAME_GRAPH_ACCESS_COMPUTE_STORAGE_READ);
+    frame_graph_pass_use(graph, tonemapPass, targets->bloomBlurredImage, FRAME_GRAPH_ACCESS_COMPUTE_STORAGE_READ);
+    frame_graph_pass_use(graph, tonemapPass, targets->outputImage, FRAME_GRAPH_ACCESS_COMPUTE_STORAGE_WRITE);
+  }
+
+  for(int i = 0; i < app->outputsCount; i++) {
+    Output *output = &app->outputs[i];
+    uint32_t blitPass = frame_graph_add_pass(graph, "blit", app_private_frame_graph_blit_pass, output);
+    frame_graph_pass_use(graph, blitPass, output->post.outputImage, FRAME_GRAPH_ACCESS_TRANSFER_READ);
+    frame_graph_pass_use(graph, blitPass, output->frameGraphSwapChainImage, FRAME_GRAPH_ACCESS_TRANSFER_WRITE);
+  }
+}
+
+void app_private_init_vulkan_create_frame_graph_readback(App *app) {
+  if(!globalConfig.readback)
+    return;
+
+  for(int i = 0; i < app->outputsCount; i++) {
+    Output *output = &app->outputs[i];
+    uint32_t readbackPass = frame_graph_add_pass(&app->frameGraph, "readback", app_private_frame_graph_readback_pass, output);
+    frame_graph_pass_use(&app->frameGraph, readbackPass, output->frameGraphSwapChainImage, FRAME_GRAPH_ACCESS_TRANSFER_READ);
+    frame_graph_pass_set_side_effects(&app->frameGraph, readbackPass);
+  }
+}
+
+void app_private_frame_graph_readback_pass(VkCommandBuffer commandBuffer, void *passData, void *frameData) {
+  Output *output = passData;
+  FrameContext *frame = frameData;
+  App *app = frame->app;
+
+  VkBufferImageCopy region = {};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent.width = output->swapChainExtent.width;
+  region.imageExtent.height = output->swapChainExtent.height;
+  region.imageExtent.depth = 1;
+
+  vkCmdCopyImageToBuffer(commandBuffer, frame_graph_get_image(&app->frameGraph, output->frameGraphSwapChainImage), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+    output->readbackBuffers[app->currentFrame], 1, &region);
+
+  VkMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+
+  output->readbackPending[app->currentFrame] = true;
+}
+
+// views of single mips and the sets of every reduction step, the pyramid
+// image itself comes and goes with the graph
+void app_private_init_vulkan_create_frame_graph_hiz(App *app, Output *output) {
+  MeshletRenderer *meshlets = &app->meshlets;
+  HizTargets *hiz = &output->hiz;
+  VkImage pyramid = frame_graph_get_image(&app->frameGraph, hiz->pyramidImage);
+
+  for(int i = 0; i < hiz->mipsCount; i++) {
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = pyramid;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = i;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if(vkCreateImageView(app->device, &viewInfo, NULL, &hiz->mipViews[i]) != VK_SUCCESS) {
+      printf("failed to create hi-z mip view\n");
+      exit(1);
+    }
+    memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_IMAGE_VIEW);
+  }
+
+  VkDescriptorPoolSize poolSizes[2] = {};
+  poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  poolSizes[0].descriptorCount = hiz->mipsCount + 1;
+  poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  poolSizes[1].descriptorCount = hiz->mipsCount;
+
+  VkDescriptorPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.maxSets = hiz->mipsCount + 1;
+  poolInfo.poolSizeCount = 2;
+  poolInfo.pPoolSizes = poolSizes;
+
+  if(vkCreateDescriptorPool(app->device, &poolInfo, NULL, &hiz->descriptorPool) != VK_SUCCESS) {
+    printf("failed to create hi-z descriptor pool\n");
+    exit(1);
+  }
+
+  VkDescriptorSetLayout setLayouts[HIZ_MAX_MIPS + 1];
+  VkDescriptorSet sets[HIZ_MAX_MIPS + 1];
+  for(int i = 0; i < hiz->mipsCount; i++) {
+    setLayouts[i] = meshlets->hizSetLayout;
+  }
+  setLayouts[hiz->mipsCount] = meshlets->pyramidSetLayout;
+
+  VkDescriptorSetAllocateInfo setAllocInfo = {};
+  setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  setAllocInfo.descriptorPool = hiz->descriptorPool;
+  setAllocInfo.descriptorSetCount = hiz->mipsCount + 1;
+  setAllocInfo.pSetLayouts = setLayouts;
+
+  if(vkAllocateDescriptorSets(app->device, &setAllocInfo, sets) != VK_SUCCESS) {
+    printf("failed to allocate hi-z descriptor sets\n");
+    exit(1);
+  }
+
+  memcpy(hiz->reduceSets, sets, hiz->mipsCount * sizeof(VkDescriptorSet));
+  hiz->cullSet = sets[hiz->mipsCount];
+
+  // the pass keeps the whole pyramid in GENERAL, the late phase samples it read only
+  VkDescriptorImageInfo imageInfos[HIZ_MAX_MIPS * 2 + 1];
+  VkWriteDescriptorSet writes[HIZ_MAX_MIPS * 2 + 1];
+  uint32_t writesCount = 0;
+
+  for(int i = 0; i <= hiz->mipsCount; i++) {
+    bool cull = i == hiz->mipsCount;
+    VkDescriptorImageInfo *input = &imageInfos[writesCount];
+    input->sampler = meshlets->hizSampler;
+    input->imageView = cull ? frame_graph_get_view(&app->frameGraph, hiz->pyramidImage)
+      : i == 0 ? frame_graph_get_view(&app->frameGraph, output->frameGraphDepthImage) : hiz->mipViews[i - 1];
+    input->imageLayout = cull || i == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+    memset(&writes[writesCount], 0, sizeof(VkWriteDescriptorSet));
+    writes[writesCount].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[writesCount].dstSet = sets[i];
+    writes[writesCount].dstBinding = 0;
+    writes[writesCount].descriptorCount = 1;
+    writes[writesCount].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[writesCount].pImageInfo = input;
+    writesCount++;
+
+    if(cull)
+      continue;
+
+    VkDescriptorImageInfo *target = &imageInfos[writesCount];
+    target->sampler = VK_NULL_HANDLE;
+    target->imageView = hiz->mipViews[i];
+    target->imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    memset(&writes[writesCount], 0, sizeof(VkWriteDescriptorSet));
+    writes[writesCount].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[writesCount].dstSet = sets[i];
+    writes[writesCount].dstBinding = 1;
+    writes[writesCount].descriptorCount = 1;
+    writes[writesCount].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[writesCount].pImageInfo = target;
+    writesCount++;
+  }
+
+  vkUpdateDescriptorSets(app->device, writesCount, writes, 0, NULL);
+}
+
+void app_private_frame_graph_main_pass(VkCommandBuffer commandBuffer, void *passData, void *frameData) {
+  Output *output = passData;
+  FrameContext *frame = frameData;
+  App *app = frame->app;
+  uint32_t outputIndex = output - app->outputs;
+  DrawList *drawList = &frame->drawLists[outputIndex];
+
+  // one meshlet culled draw per list, further draws of the mesh stay plain
+  const DrawCommand *meshletCommand = app_private_meshlets_find_command(app, drawList);
+
+  if(meshletCommand != NULL)
+    app_private_meshlets_record_cull(app, commandBuffer, meshletCommand, outputIndex, MESHLET_PHASE_EARLY);
+
+  // the draw record jobs fill one secondary per chunk of the list before
+  // the segments are recorded
+  app_private_frame_graph_main_pass_begin(app, commandBuffer, output, app->renderPass, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+  uint32_t chunksCount = (drawList->count + DRAW_LIST_CHUNK_COMMANDS - 1) / DRAW_LIST_CHUNK_COMMANDS;
+  if(chunksCount > 0)
+    vkCmdExecuteCommands(commandBuffer, chunksCount, app->drawCommandBuffers[app->currentFrame][outputIndex]);
+
+  vkCmdEndRenderPass(commandBuffer);
+
+  // counted here rather than by the parallel draw record jobs. the two
+  // phases split the meshlets between them, so the mesh is counted once
+  if(meshletCommand != NULL)
+    app->meshlets.submittedTriangles[app->currentFrame] += (uint64_t)meshletCommand->count / 3 * meshletCommand->instanceCount;
+
+  // with occlusion culling the late pass still adds to the counters
+  if(meshletCommand != NULL && !app->meshlets.occlusion)
+    app_private_meshlets_record_stats_barrier(app, commandBuffer);
+}
+
+// one chunk of the output's draw list into a secondary that continues the
+// main render pass, so it starts from no bound state
+void app_private_frame_graph_main_pass_record_draws(App *app, VkCommandBuffer commandBuffer, DrawList *drawList, uint32_t outputIndex, uint32_t chunk) {
+  Output *output = &app->outputs[outputIndex];
+  const DrawCommand *meshletCommand = app_private_meshlets_find_command(app, drawList);
+
+  uint32_t first = chunk * DRAW_LIST_CHUNK_COMMANDS;
+  uint32_t last = first + DRAW_LIST_CHUNK_COMMANDS < drawList->count ? first + DRAW_LIST_CHUNK_COMMANDS : drawList->count;
+
+  app_private_frame_graph_main_pass_set_viewport(commandBuffer, output);
+
+  VkPipeline boundPipeline = VK_NULL_HANDLE;
+  VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+  VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+
+  for(uint32_t i = first; i < last; i++) {
+    DrawCommand *command = &drawList->commands[i];
+
+    if(command == meshletCommand && app->meshlets.path == MESHLET_PATH_MESH_SHADER) {
+      app_private_meshlets_record_draw(app, commandBuffer, command, outputIndex, MESHLET_PHASE_EARLY);
+      boundPipeline = app->meshlets.pipeline;
+      continue;
+    }
+
+    if(command->pipeline != boundPipeline) {
+      vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, command->pipeline);
+      if(command->layout == app->meshPipelineLayout)
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, command->layout, MESH_TEXTURE_SET, 1, &app->meshTexture.sets[app->currentFrame], 0, NULL);
+      boundPipeline = command->pipeline;
+    }
+    if(command->vertexBuffer != VK_NULL_HANDLE && command->vertexBuffer != boundVertexBuffer) {
+      VkDeviceSize zeroBufferOffset = 0;
+      vkCmdBindVertexBuffers(commandBuffer, 0, 1, &command->vertexBuffer, &zeroBufferOffset);
+      boundVertexBuffer = command->vertexBuffer;
+    }
+    if(command->indexBuffer != VK_NULL_HANDLE && command->indexBuffer != boundIndexBuffer) {
+      vkCmdBindIndexBuffer(commandBuffer, command->indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+      boundIndexBuffer = command->indexBuffer;
+    }
+    if(command->hasPushConstants)
+      vkCmdPushConstants(commandBuffer, command->layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(MeshPushConstants), &command->pushConstants);
+
+    if(command == meshletCommand)
+      app_private_meshlets_record_draw(app, commandBuffer, command, outputIndex, MESHLET_PHASE_EARLY);
+    else if(command->indexBuffer != VK_NULL_HANDLE)
+      vkCmdDrawIndexed(commandBuffer, command->count, command->instanceCount, 0, 0, 0);
+    else
+      vkCmdDraw(commandBuffer, command->count, command->instanceCount, 0, 0);
+  }
+}
+
+// with secondary command buffer contents the secondaries set their own viewport
+void app_private_frame_graph_main_pass_begin(App *app, VkCommandBuffer commandBuffer, Output *output, VkRenderPass renderPass, VkSubpassContents contents) {
+  VkRenderPassBeginInfo renderPassInfo = {};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  renderPassInfo.renderPass = renderPass;
+  renderPassInfo.framebuffer = app->postProcess.enabled ? output->post.sceneFrameBuffer : output->swapChainFrameBuffers[output->imageIndex];
+
+  VkOffset2D zeroOffset = {0, 0};
+
+  // the whole target is cleared, so depth outside the render extent reads
+  // as far when the hi-z pyramid is built over it
+  renderPassInfo.renderArea.offset = zeroOffset;
+  renderPassInfo.renderArea.extent = output->swapChainExtent;
+
+  // ignored by the late render pass, which loads both attachments
+  VkClearValue clearValues[2] = {};
+  clearValues[0].color.float32[3] = 1.0f;
+  clearValues[1].depthStencil.depth = 1.0f;
+  renderPassInfo.clearValueCount = 2;
+  renderPassInfo.pClearValues = clearValues;
+
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+
+  if(contents == VK_SUBPASS_CONTENTS_INLINE)
+    app_private_frame_graph_main_pass_set_viewport(commandBuffer, output);
+}
+
+void app_private_frame_graph_main_pass_set_viewport(VkCommandBuffer commandBuffer, Output *output) {
+  VkOffset2D zeroOffset = {0, 0};
+
+  VkViewport viewport = {};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = (float)output->renderExtent.width;
+  viewport.height = (float)output->renderExtent.height;
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+  VkRect2D scissor = {};
+  scissor.offset = zeroOffset;
+  scissor.extent = output->renderExtent;
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+// reduces the early phase's depth into the pyramid one mip at a time, each
+// step waits for the one before. the graph moves the whole image into GENERAL
+// before and into SHADER_READ_ONLY for the late phase after
+void app_private_frame_graph_hiz_pass(VkCommandBuffer commandBuffer, void *passData, void *frameData) {
+  Output *output = passData;
+  FrameContext *frame = frameData;
+  App *app = frame->app;
+  MeshletRenderer *meshlets = &app->meshlets;
+  HizTargets *hiz = &output->hiz;
+  VkImage pyramid = frame_graph_get_image(&app->frameGraph, hiz->pyramidImage);
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, meshlets->hizPipeline);
+
+  for(int i = 0; i < hiz->mipsCount; i++) {
+    uint32_t width = hiz->pyramidExtent.width >> i > 0 ? hiz->pyramidExtent.width >> i : 1;
+    uint32_t height = hiz->pyramidExtent.height >> i > 0 ? hiz->pyramidExtent.height >> i : 1;
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, meshlets->hizPipelineLayout, 0, 1, &hiz->reduceSets[i], 0, NULL);
+    vkCmdDispatch(commandBuffer, (width + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (height + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+
+    if(i == hiz->mipsCount - 1)
+      break;
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = pyramid;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = i;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+  }
+}
+
+// the meshlets the early phase did not draw and the pyramid did not reject,
+// on top of the early phase's color and depth
+void app_private_frame_graph_late_pass(VkCommandBuffer commandBuffer, void *passData, void *frameData) {
+  Output *output = passData;
+  FrameContext *frame = frameData;
+  App *app = frame->app;
+  uint32_t outputIndex = output - app->outputs;
+
+  const DrawCommand *command = app_private_meshlets_find_command(app, &frame->drawLists[outputIndex]);
+  if(command == NULL)
+    return;
+
+  app_private_meshlets_record_cull(app, commandBuffer, command, outputIndex, MESHLET_PHASE_LATE);
+  app_private_frame_graph_main_pass_begin(app, commandBuffer, output, app->lateRenderPass, VK_SUBPASS_CONTENTS_INLINE);
+
+  // the compute path draws with the command's own pipeline and buffers
+  if(app->meshlets.path == MESHLET_PATH_COMPUTE) {
+    VkDeviceSize zeroBufferOffset = 0;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, command->pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, command->layout, MESH_TEXTURE_SET, 1, &app->meshTexture.sets[app->currentFrame], 0, NULL);
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &command->vertexBuffer, &zeroBufferOffset);
+    vkCmdBindIndexBuffer(commandBuffer, command->indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdPushConstants(commandBuffer, command->layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(MeshPushConstants), &command->pushConstants);
+  }
+
+  app_private_meshlets_record_draw(app, commandBuffer, command, outputIndex, MESHLET_PHASE_LATE);
+  vkCmdEndRenderPass(commandBuffer);
+
+  app_private_meshlets_record_stats_barrier(app, commandBuffer);
+}
+
+void app_private_init_vulkan_create_command_pool(App *app) {
+  QueueFamilyIndices queueFamilyIndices = app->capabilities->queueFamilyIndices;
+  bool asyncCompute = queueFamilyIndices.computeFamily != queueFamilyIndices.graphicsFamily;
+
+  VkCommandPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+
+  if(vkCreateCommandPool(app->device, &poolInfo, NULL, &app->commandPool) != VK_SUCCESS) {
+    printf("failed to create command pool\n");
+    exit(1);
+  }
+
+  for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for(int j = 0; j < FRAME_GRAPH_MAX_SEGMENTS; j++) {
+      poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+      if(vkCreateCommandPool(app->device, &poolInfo, NULL, &app->segmentCommandPools[i][j]) != VK_SUCCESS) {
+        printf("failed to create command pool\n");
+        exit(1);
+      }
+
+      app->computeSegmentCommandPools[i][j] = app->segmentCommandPools[i][j];
+      if(!asyncCompute)
+        continue;
+
+      poolInfo.queueFamilyIndex = queueFamilyIndices.computeFamily;
+      if(vkCreateCommandPool(app->device, &poolInfo, NULL, &app->computeSegmentCommandPools[i][j]) != VK_SUCCESS) {
+        printf("failed to create compute command pool\n");
+        exit(1);
+      }
+    }
+
+    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+    for(int j = 0; j < app->outputsCount; j++) {
+      for(int k = 0; k < DRAW_LIST_MAX_CHUNKS; k++) {
+        if(vkCreateCommandPool(app->device, &poolInfo, NULL, &app->drawCommandPools[i][j][k]) != VK_SUCCESS) {
+          printf("failed to create draw command pool\n");
+          exit(1);
+        }
+      }
+    }
+  }
+}
+
+void app_private_init_vulkan_create_command_buffer(App *app) {
+  VkCommandBufferAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandBufferCount = 1;
+
+  for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for(int j = 0; j < FRAME_GRAPH_MAX_SEGMENTS; j++) {
+      allocInfo.commandPool = app->segmentCommandPools[i][j];
+      if(vkAllocateCommandBuffers(app->device, &allocInfo, &app->commandBuffers[i][j]) != VK_SUCCESS) {
+        printf("failed to create command buffers\n");
+        exit(1);
+      }
+
+      allocInfo.commandPool = app->computeSegmentCommandPools[i][j];
+      if(vkAllocateCommandBuffers(app->device, &allocInfo, &app->computeCommandBuffers[i][j]) != VK_SUCCESS) {
+        printf("failed to create compute command buffers\n");
+        exit(1);
+      }
+    }
+  }
+
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+  for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for(int j = 0; j < app->outputsCount; j++) {
+      for(int k = 0; k < DRAW_LIST_MAX_CHUNKS; k++) {
+        allocInfo.commandPool = app->drawCommandPools[i][j][k];
+        if(vkAllocateCommandBuffers(app->device, &allocInfo, &app->drawCommandBuffers[i][j][k]) != VK_SUCCESS) {
+          printf("failed to create draw command buffers\n");
+          exit(1);
+        }
+      }
+    }
+  }
+}
+
+void app_private_init_vulkan_create_sync_objects(App *app) {
+  VkSemaphoreCreateInfo semaphoreInfo = {};
+  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+  VkFenceCreateInfo fenceInfo = {};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+  for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    if(vkCreateFence(app->device, &fenceInfo, NULL, &app->inFlightFences[i]) != VK_SUCCESS) {
+      printf("failed to create sync objects");
+      exit(1);
+    }
+
+    for(int j = 0; j < app->outputsCount; j++) {
+      Output *output = &app->outputs[j];
+      if(vkCreateSemaphore(app->device, &semaphoreInfo, NULL, &output->imageAvailableSemaphores[i]) != VK_SUCCESS) {
+        printf("failed to create sync objects");
+        exit(1);
+      }
+    }
+
+    for(int j = 0; j < FRAME_GRAPH_MAX_SEGMENTS; j++) {
+      if(vkCreateSemaphore(app->device, &semaphoreInfo, NULL, &app->segmentSemaphores[i][j]) != VK_SUCCESS) {
+        printf("failed to create sync objects");
+        exit(1);
+      }
+    }
+  }
+}
+
+void app_private_init_vulkan_create_texture_streamer(App *app) {
+  // without a texture the io thread and staging ring would idle for nothing
+  app->textureStreaming = globalConfig.texturePath != NULL;
+  if(!app->textureStreaming)
+    return;
+
+  QueueFamilyIndices indices = app->capabilities->queueFamilyIndices;
+
+  texture_streamer_init(&app->textureStreamer, app->physicalDevice, app->device, app->transferQueue, indices, (VkDeviceSize)globalConfig.textureBudgetMb * 1024 * 1024);
+  texture_streamer_request(&app->textureStreamer, globalConfig.texturePath);
+
+  memory_tracker_set_pressure_callback(&globalMemoryTracker, app_private_memory_pressure_callback, app_private_memory_relief_callback, app);
+}
+
+VkDeviceSize app_private_memory_pressure_callback(void *userData, VkDeviceSize bytes) {
+  App *app = userData;
+  return texture_streamer_shed(&app->textureStreamer, bytes);
+}
+
+VkDeviceSize app_private_memory_relief_callback(void *userData, VkDeviceSize bytes) {
+  App *app = userData;
+  return texture_streamer_restore(&app->textureStreamer, bytes);
+}
+
+void app_private_init_vulkan_load_mesh(App *app) {
+  app->mesh.loaded = false;
+
+  MeshFile file;
+  if(!mesh_file_map(globalConfig.meshPath, &file))
+    return;
+
+  const MeshFileHeader *header = file.header;
+
+  VkDeviceSize stagingSize = header->vertexSize + header->indexSize + header->meshletSize + header->meshletVertexSize + header->meshletTriangleSize;
+  VkBuffer stagingBuffer;
+  VkDeviceMemory stagingMemory;
+  app_private_create_buffer(app, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingMemory);
+
+  // sections are stored in their gpu layout, so they go from the page cache
+  // into staging memory without being touched by the cpu in between
+  uint8_t *staging;
+  vkMapMemory(app->device, stagingMemory, 0, stagingSize, 0, (void **)&staging);
+  memcpy(staging, file.mapped + header->vertexOffset, header->vertexSize);
+  memcpy(staging + header->vertexSize, file.mapped + header->indexOffset, header->indexSize);
+
+  VkDeviceSize meshletStagingOffset = header->vertexSize + header->indexSize;
+  memcpy(staging + meshletStagingOffset, file.mapped + header->meshletOffset, header->meshletSize);
+  memcpy(staging + meshletStagingOffset + header->meshletSize, file.mapped + header->meshletVertexOffset, header->meshletVertexSize);
+  memcpy(staging + meshletStagingOffset + header->meshletSize + header->meshletVertexSize, file.mapped + header->meshletTriangleOffset, header->meshletTriangleSize);
+  vkUnmapMemory(app->device, stagingMemory);
+
+  // the mesh shader path fetches vertices itself, so the vertex buffer doubles as a storage buffer
+  app_private_create_buffer(app, header->vertexSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &app->mesh.vertexBuffer, &app->mesh.vertexMemory);
+  app_private_create_buffer(app, header->indexSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &app->mesh.indexBuffer, &app->mesh.indexMemory);
+  app_private_create_buffer(app, header->meshletSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &app->mesh.meshletBuffer, &app->mesh.meshletMemory);
+  app_private_create_buffer(app, header->meshletVertexSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &app->mesh.meshletVertexBuffer, &app->mesh.meshletVertexMemory);
+  app_private_create_buffer(app, header->meshletTriangleSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &app->mesh.meshletTriangleBuffer, &app->mesh.meshletTriangleMemory);
+
+  VkCommandBuffer commandBuffer = app_private_begin_one_time_commands(app);
+
+  VkBufferCopy vertexCopy = {0, 0, header->vertexSize};
+  VkBufferCopy indexCopy = {header->vertexSize, 0, header->indexSize};
+  VkBufferCopy meshletCopy = {meshletStagingOffset, 0, header->meshletSize};
+  VkBufferCopy meshletVertexCopy = {meshletStagingOffset + header->meshletSize, 0, header->meshletVertexSize};
+  VkBufferCopy meshletTriangleCopy = {meshletStagingOffset + header->meshletSize + header->meshletVertexSize, 0, header->meshletTriangleSize};
+  vkCmdCopyBuffer(commandBuffer, stagingBuffer, app->mesh.vertexBuffer, 1, &vertexCopy);
+  vkCmdCopyBuffer(commandBuffer, stagingBuffer, app->mesh.indexBuffer, 1, &indexCopy);
+  vkCmdCopyBuffer(commandBuffer, stagingBuffer, app->mesh.meshletBuffer, 1, &meshletCopy);
+  vkCmdCopyBuffer(commandBuffer, stagingBuffer, app->mesh.meshletVertexBuffer, 1, &meshletVertexCopy);
+  vkCmdCopyBuffer(commandBuffer, stagingBuffer, app->mesh.meshletTriangleBuffer, 1, &meshletTriangleCopy);
+
+  app_private_end_one_time_commands(app, commandBuffer);
+
+  memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_BUFFER);
+  vkDestroyBuffer(app->device, stagingBuffer, NULL);
+  memory_tracker_free(&globalMemoryTracker, app->device, stagingMemory);
+
+  app->mesh.indexCount = header->indexCount;
+  app->mesh.vertexStride = header->vertexStride;
+  app->mesh.attributesCount = header->attributeCount;
+  app->mesh.meshletsCount = header->meshletCount;
+  app->mesh.positionOffset = -1;
+  app->mesh.normalOffset = -1;
+  app->mesh.texcoordOffset = -1;
+
+  for(int i = 0; i < header->attributeCount; i++) {
+    app->mesh.attributes[i].location = header->attributes[i].semantic;
+    app->mesh.attributes[i].binding = 0;
+    app->mesh.attributes[i].format = header->attributes[i].format;
+    app->mesh.attributes[i].offset = header->attributes[i].offset;
+
+    // the mesh shader reads these as raw floats
+    if(header->attributes[i].format == VK_FORMAT_R32G32_SFLOAT && header->attributes[i].semantic == MESH_ATTRIBUTE_TEXCOORD)
+      app->mesh.texcoordOffset = header->attributes[i].offset;
+    if(header->attributes[i].format != VK_FORMAT_R32G32B32_SFLOAT)
+      continue;
+    if(header->attributes[i].semantic == MESH_ATTRIBUTE_POSITION)
+      app->mesh.positionOffset = header->attributes[i].offset;
+    if(header->attributes[i].semantic == MESH_ATTRIBUTE_NORMAL)
+      app->mesh.normalOffset = header->attributes[i].offset;
+  }
+
+  for(int i = 0; i < 3; i++) {
+    app->mesh.boundsMin[i] = header->boundsMin[i];
+    app->mesh.boundsMax[i] = header->boundsMax[i];
+  }
+
+  app->mesh.loaded = true;
+
+  mesh_file_unmap(&file);
+}
+
+void app_private_init_vulkan_create_mesh_pipeline(App *app) {
+  app->meshPipeline = VK_NULL_HANDLE;
+  app->meshPipelineLayout = VK_NULL_HANDLE;
+
+  if(!app->mesh.loaded)
+    return;
+
+  bool texcoords = false;
+  for(int i = 0; i < app->mesh.attributesCount; i++) {
+    if(app->mesh.attributes[i].location == MESH_ATTRIBUTE_TEXCOORD)
+      texcoords = true;
+  }
+  if(!texcoords) {
+    printf("mesh has no texcoords, drawing the builtin triangle\n");
+    return;
+  }
+
+  VkShaderModule vertModule = app_private_create_shader_module(app, "shaders/mesh_vert.spv");
+  VkShaderModule fragModule = app_private_create_shader_module(app, "shaders/mesh_frag.spv");
+
+  if(vertModule == VK_NULL_HANDLE || fragModule == VK_NULL_HANDLE) {
+    printf("mesh shaders unavailable, drawing the builtin triangle\n");
+    if(vertModule != VK_NULL_HANDLE)
+      vkDestroyShaderModule(app->device, vertModule, NULL);
+    if(fragModule != VK_NULL_HANDLE)
+      vkDestroyShaderModule(app->device, fragModule, NULL);
+    return;
+  }
+
+  VkVertexInputBindingDescription bindingDescription = {};
+  bindingDescription.binding = 0;
+  bindingDescription.stride = app->mesh.vertexStride;
+  bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+  VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+  vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+  vertexInputInfo.vertexBindingDescriptionCount = 1;
+  vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+  vertexInputInfo.vertexAttributeDescriptionCount = app->mesh.attributesCount;
+  vertexInputInfo.pVertexAttributeDescriptions = app->mesh.attributes;
+  vertexInputInfo.pNext = NULL;
+  vertexInputInfo.flags = 0;
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(MeshPushConstants);
+
+  app_private_init_vulkan_create_mesh_texture(app);
+
+  MeshTexture *texture = &app->meshTexture;
+  VkDescriptorSetLayout setLayouts[MESH_TEXTURE_SET + 1];
+  for(int i = 0; i < MESH_TEXTURE_SET; i++)
+    setLayouts[i] = texture->emptySetLayout;
+  setLayouts[MESH_TEXTURE_SET] = texture->setLayout;
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = MESH_TEXTURE_SET + 1;
+  pipelineLayoutInfo.pSetLayouts = setLayouts;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  if(vkCreatePipelineLayout(app->device, &pipelineLayoutInfo, NULL, &app->meshPipelineLayout) != VK_SUCCESS) {
+    printf("failed to create mesh pipeline layout\n");
+    exit(1);
+  }
+
+  // the projection flips y, so counter clockwise obj faces stay counter
+  // clockwise in framebuffer space
+  VkPipelineShaderStageCreateInfo stages[] = {
+    app_private_shader_stage(VK_SHADER_STAGE_VERTEX_BIT, vertModule, NULL),
+    app_private_shader_stage(VK_SHADER_STAGE_FRAGMENT_BIT, fragModule, NULL)
+  };
+  app->meshPipeline = app_private_build_graphics_pipeline(app, stages, 2, &vertexInputInfo, VK_FRONT_FACE_COUNTER_CLOCKWISE, app->meshPipelineLayout);
+
+  vkDestroyShaderModule(app->device, fragModule, NULL);
+  vkDestroyShaderModule(app->device, vertModule, NULL);
+}
+
+void app_private_init_vulkan_create_mesh_texture(App *app) {
+  MeshTexture *texture = &app->meshTexture;
+
+  VkImageCreateInfo imageInfo = {};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+  imageInfo.extent.width = 1;
+  imageInfo.extent.height = 1;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  if(vkCreateImage(app->device, &imageInfo, NULL, &texture->fallbackImage) != VK_SUCCESS) {
+    printf("failed to create fallback texture\n");
+    exit(1);
+  }
+  memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_IMAGE);
+
+  VkMemoryRequirements memRequirements;
+  vkGetImageMemoryRequirements(app->device, texture->fallbackImage, &memRequirements);
+
+  VkMemoryAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = memRequirements.size;
+  allocInfo.memoryTypeIndex = app_private_find_memory_type(app, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  if(memory_tracker_allocate(&globalMemoryTracker, app->device, &allocInfo, &texture->fallbackMemory) != VK_SUCCESS) {
+    printf("failed to allocate fallback texture memory\n");
+    exit(1);
+  }
+  vkBindImageMemory(app->device, texture->fallbackImage, texture->fallbackMemory, 0);
+
+  VkImageViewCreateInfo viewInfo = {};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = texture->fallbackImage;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.layerCount = 1;
+
+  if(vkCreateImageView(app->device, &viewInfo, NULL, &texture->fallbackView) != VK_SUCCESS) {
+    printf("failed to create fallback texture view\n");
+    exit(1);
+  }
+  memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_IMAGE_VIEW);
+
+  // white, so the vertex colors come through untouched until the streamer has a view
+  VkImageSubresourceRange range = viewInfo.subresourceRange;
+  VkImageMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = texture->fallbackImage;
+  barrier.subresourceRange = range;
+
+  VkCommandBuffer commandBuffer = app_private_begin_one_time_commands(app);
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+  VkClearColorValue white = {{1.0f, 1.0f, 1.0f, 1.0f}};
+  vkCmdClearColorImage(commandBuffer, texture->fallbackImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &white, 1, &range);
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+  app_private_end_one_time_commands(app, commandBuffer);
+
+  VkSamplerCreateInfo samplerInfo = {};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_LINEAR;
+  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.maxLod = TEXTURE_MAX_MIPS;
+
+  if(vkCreateSampler(app->device, &samplerInfo, NULL, &texture->sampler) != VK_SUCCESS) {
+    printf("failed to create mesh texture sampler\n");
+    exit(1);
+  }
+
+  VkDescriptorSetLayoutBinding binding = {};
+  binding.binding = 0;
+  binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  binding.descriptorCount = 1;
+  binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  VkDescriptorSetLayoutCreateInfo setLayoutInfo = {};
+  setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutInfo.bindingCount = 1;
+  setLayoutInfo.pBindings = &binding;
+
+  if(vkCreateDescriptorSetLayout(app->device, &setLayoutInfo, NULL, &texture->setLayout) != VK_SUCCESS) {
+    printf("failed to create mesh texture descriptor set layout\n");
+    exit(1);
+  }
+
+  setLayoutInfo.bindingCount = 0;
+  setLayoutInfo.pBindings = NULL;
+
+  if(vkCreateDescriptorSetLayout(app->device, &setLayoutInfo, NULL, &texture->emptySetLayout) != VK_SUCCESS) {
+    printf("failed to create empty descriptor set layout\n");
+    exit(1);
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  poolSize.descriptorCount = globalConfig.framesInFlight;
+
+  VkDescriptorPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.maxSets = globalConfig.framesInFlight;
+  poolInfo.poolSizeCount = 1;
+  poolInfo.pPoolSizes = &poolSize;
+
+  if(vkCreateDescriptorPool(app->device, &poolInfo, NULL, &texture->descriptorPool) != VK_SUCCESS) {
+    printf("failed to create mesh texture descriptor pool\n");
+    exit(1);
+  }
+
+  VkDescriptorSetLayout setLayouts[MAX_FRAMES_IN_FLIGHT];
+  for(int i = 0; i < globalConfig.framesInFlight; i++)
+    setLayouts[i] = texture->setLayout;
+
+  VkDescriptorSetAllocateInfo setInfo = {};
+  setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  setInfo.descriptorPool = texture->descriptorPool;
+  setInfo.descriptorSetCount = globalConfig.framesInFlight;
+  setInfo.pSetLayouts = setLayouts;
+
+  if(vkAllocateDescriptorSets(app->device, &setInfo, texture->sets) != VK_SUCCESS) {
+    printf("failed to allocate mesh texture descriptor sets\n");
+    exit(1);
+  }
+
+  // written on first use by app_private_main_loop_draw_frame_update_mesh_texture
+  for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    texture->boundViews[i] = VK_NULL_HANDLE;
+}
+
+void app_private_cleanup_mesh_texture(App *app) {
+  MeshTexture *texture = &app->meshTexture;
+
+  vkDestroyDescriptorPool(app->device, texture->descriptorPool, NULL);
+  vkDestroyDescriptorSetLayout(app->device, texture->emptySetLayout, NULL);
+  vkDestroyDescriptorSetLayout(app->device, texture->setLayout, NULL);
+  vkDestroySampler(app->device, texture->sampler, NULL);
+
+  memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_IMAGE_VIEW);
+  vkDestroyImageView(app->device, texture->fallbackView, NULL);
+  memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_IMAGE);
+  vkDestroyImage(app->device, texture->fallbackImage, NULL);
+  memory_tracker_free(&globalMemoryTracker, app->device, texture->fallbackMemory);
+}
+
+void app_private_init_vulkan_create_meshlet_renderer(App *app) {
+  MeshletRenderer *meshlets = &app->meshlets;
+  memset(meshlets, 0, sizeof(MeshletRenderer));
+  meshlets->path = MESHLET_PATH_NONE;
+
+  if(app->meshPipeline == VK_NULL_HANDLE || app->mesh.meshletsCount == 0 || globalConfig.meshlets == MESHLET_MODE_OFF)
+    return;
+
+  meshlets->maxDrawIndirectCount = app->deviceFeatures.multiDrawIndirect ? app->capabilities->properties.limits.maxDrawIndirectCount : 1;
+
+  app_private_create_buffer(app, globalConfig.framesInFlight * app->outputsCount * sizeof(MeshletStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &meshlets->statsBuffer, &meshlets->statsMemory);
+  vkMapMemory(app->device, meshlets->statsMemory, 0, VK_WHOLE_SIZE, 0, (void **)&meshlets->stats);
+  memset(meshlets->stats, 0, globalConfig.framesInFlight * app->outputsCount * sizeof(MeshletStats));
+
+  if(globalConfig.meshlets == MESHLET_MODE_MESH_SHADER && !app->meshShaderEnabled)
+    printf("device has no mesh shaders, meshlets culled in compute instead\n");
+
+  // before the paths, their culling shaders come with and without occlusion culling
+  if(globalConfig.occlusion)
+    app_private_init_vulkan_create_meshlet_renderer_occlusion(app);
+
+  if(app->meshShaderEnabled && globalConfig.meshlets != MESHLET_MODE_COMPUTE && app_private_init_vulkan_create_meshlet_renderer_mesh_shader(app))
+    meshlets->path = MESHLET_PATH_MESH_SHADER;
+  else if(app_private_init_vulkan_create_meshlet_renderer_compute(app))
+    meshlets->path = MESHLET_PATH_COMPUTE;
+
+  if(meshlets->path == MESHLET_PATH_NONE) {
+    printf("meshlet shaders missing, drawing the mesh unculled\n");
+    if(meshlets->occlusion)
+      app_private_cleanup_meshlet_occlusion(app);
+    vkUnmapMemory(app->device, meshlets->statsMemory);
+    memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_BUFFER);
+    vkDestroyBuffer(app->device, meshlets->statsBuffer, NULL);
+    memory_tracker_free(&globalMemoryTracker, app->device, meshlets->statsMemory);
+    return;
+  }
+
+  printf("%u meshlets culled %s%s\n", app->mesh.meshletsCount, meshlets->path == MESHLET_PATH_MESH_SHADER ? "in the task shader" : "in compute",
+    meshlets->occlusion ? ", occlusion culled against a depth pyramid" : "");
+}
+
+bool app_private_init_vulkan_create_meshlet_renderer_mesh_shader(App *app) {
+  MeshletRenderer *meshlets = &app->meshlets;
+  Mesh *mesh = &app->mesh;
+
+  if(mesh->positionOffset < 0 || mesh->normalOffset < 0 || mesh->texcoordOffset < 0 || mesh->vertexStride % 4 != 0
+     || mesh->positionOffset % 4 != 0 || mesh->normalOffset % 4 != 0 || mesh->texcoordOffset % 4 != 0) {
+    printf("mesh vertices cannot be fetched as floats, meshlets culled in compute instead\n");
+    return false;
+  }
+
+  VkShaderModule taskModule = app_private_create_shader_module(app, meshlets->occlusion ? "shaders/meshlet_task_occlusion.spv" : "shaders/meshlet_task.spv");
+  VkShaderModule meshModule = app_private_create_shader_module(app, "shaders/meshlet_mesh.spv");
+  VkShaderModule fragModule = app_private_create_shader_module(app, "shaders/mesh_frag.spv");
+
+  if(taskModule == VK_NULL_HANDLE || meshModule == VK_NULL_HANDLE || fragModule == VK_NULL_HANDLE) {
+    VkShaderModule modules[] = {taskModule, meshModule, fragModule};
+    for(int i = 0; i < 3; i++) {
+      if(modules[i] != VK_NULL_HANDLE)
+        vkDestroyShaderModule(app->device, modules[i], NULL);
+    }
+    return false;
+  }
+
+  meshlets->drawMeshTasks = (PFN_vkCmdDrawMeshTasksEXT)vkGetDeviceProcAddr(app->device, "vkCmdDrawMeshTasksEXT");
+
+  VkBuffer buffers[] = {mesh->meshletBuffer, meshlets->statsBuffer, mesh->vertexBuffer, mesh->meshletVertexBuffer, mesh->meshletTriangleBuffer, meshlets->visibilityBuffer};
+  app_private_init_vulkan_create_meshlet_renderer_descriptors(app, VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT, meshlets->occlusion ? 6 : 5, buffers);
+
+  // vertex layout of the loaded file, in floats
+  uint32_t layout[4] = {mesh->vertexStride / 4, mesh->positionOffset / 4, mesh->normalOffset / 4, mesh->texcoordOffset / 4};
+  VkSpecializationMapEntry entries[4];
+  for(int i = 0; i < 4; i++) {
+    entries[i].constantID = i;
+    entries[i].offset = i * sizeof(uint32_t);
+    entries[i].size = sizeof(uint32_t);
+  }
+
+  VkSpecializationInfo specialization = {};
+  specialization.mapEntryCount = 4;
+  specialization.pMapEntries = entries;
+  specialization.dataSize = sizeof(layout);
+  specialization.pData = layout;
+
+  VkPipelineShaderStageCreateInfo stages[] = {
+    app_private_shader_stage(VK_SHADER_STAGE_TASK_BIT_EXT, taskModule, NULL),
+    app_private_shader_stage(VK_SHADER_STAGE_MESH_BIT_EXT, meshModule, &specialization),
+    app_private_shader_stage(VK_SHADER_STAGE_FRAGMENT_BIT, fragModule, NULL)
+  };
+  meshlets->pipeline = app_private_build_graphics_pipeline(app, stages, 3, NULL, VK_FRONT_FACE_COUNTER_CLOCKWISE, meshlets->pipelineLayout);
+
+  vkDestroyShaderModule(app->device, fragModule, NULL);
+  vkDestroyShaderModule(app->device, meshModule, NULL);
+  vkDestroyShaderModule(app->device, taskModule, NULL);
+  return true;
+}
+
+bool app_private_init_vulkan_create_meshlet_renderer_compute(App *app) {
+  MeshletRenderer *meshlets = &app->meshlets;
+
+  VkShaderModule module = app_private_create_shader_module(app, meshlets->occlusion ? "shaders/meshlet_cull_occlusion_comp.spv" : "shaders/meshlet_cull_comp.spv");
+  if(module == VK_NULL_HANDLE)
+    return false;
+
+  uint32_t phasesCount = meshlets->occlusion ? MESHLET_PHASE_COUNT : 1;
+  app_private_create_buffer(app, globalConfig.framesInFlight * app->outputsCount * phasesCount * app->mesh.meshletsCount * sizeof(VkDrawIndexedIndirectCommand),
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &meshlets->drawBuffer, &meshlets->drawMemory);
+
+  VkBuffer buffers[] = {app->mesh.meshletBuffer, meshlets->statsBuffer, meshlets->drawBuffer, meshlets->visibilityBuffer};
+  app_private_init_vulkan_create_meshlet_renderer_descriptors(app, VK_SHADER_STAGE_COMPUTE_BIT, meshlets->occlusion ? 4 : 3, buffers);
+
+  VkComputePipelineCreateInfo pipelineInfo = {};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage = app_private_shader_stage(VK_SHADER_STAGE_COMPUTE_BIT, module, NULL);
+  pipelineInfo.layout = meshlets->pipelineLayout;
+
+  if(vkCreateComputePipelines(app->device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &meshlets->pipeline) != VK_SUCCESS) {
+    printf("failed to create meshlet cull pipeline\n");
+    exit(1);
+  }
+  memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_PIPELINE);
+
+  vkDestroyShaderModule(app->device, module, NULL);
+  return true;
+}
+
+// visibility buffer, pyramid build pipeline and the layout of the pyramid
+// set, the per output pyramids are created with the frame graph
+void app_private_init_vulkan_create_meshlet_renderer_occlusion(App *app) {
+  MeshletRenderer *meshlets = &app->meshlets;
+
+  VkShaderModule module = app_private_create_shader_module(app, "shaders/hiz_reduce_comp.spv");
+  if(module == VK_NULL_HANDLE) {
+    printf("hi-z shader missing, meshlets are not occlusion culled\n");
+    return;
+  }
+
+  meshlets->occlusion = true;
+
+  // all zero, the first frame draws everything in the late phase
+  VkDeviceSize visibilitySize = (VkDeviceSize)app->outputsCount * app->mesh.meshletsCount * sizeof(uint32_t);
+  app_private_create_buffer(app, visibilitySize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &meshlets->visibilityBuffer, &meshlets->visibilityMemory);
+
+  VkCommandBuffer commandBuffer = app_private_begin_one_time_commands(app);
+  vkCmdFillBuffer(commandBuffer, meshlets->visibilityBuffer, 0, visibilitySize, 0);
+  app_private_end_one_time_commands(app, commandBuffer);
+
+  VkSamplerCreateInfo samplerInfo = {};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_NEAREST;
+  samplerInfo.minFilter = VK_FILTER_NEAREST;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.maxLod = HIZ_MAX_MIPS;
+
+  if(vkCreateSampler(app->device, &samplerInfo, NULL, &meshlets->hizSampler) != VK_SUCCESS) {
+    printf("failed to create hi-z sampler\n");
+    exit(1);
+  }
+
+  VkDescriptorSetLayoutBinding bindings[2] = {};
+  bindings[0].binding = 0;
+  bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  bindings[0].descriptorCount = 1;
+  bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  bindings[1].binding = 1;
+  bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  bindings[1].descriptorCount = 1;
+  bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  VkDescriptorSetLayoutCreateInfo setLayoutInfo = {};
+  setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutInfo.bindingCount = 2;
+  setLayoutInfo.pBindings = bindings;
+
+  if(vkCreateDescriptorSetLayout(app->device, &setLayoutInfo, NULL, &meshlets->hizSetLayout) != VK_SUCCESS) {
+    printf("failed to create hi-z descriptor set layout\n");
+    exit(1);
+  }
+
+  // the pyramid alone, for whichever stage culls
+  bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | (app->meshShaderEnabled ? VK_SHADER_STAGE_TASK_BIT_EXT : 0);
+  setLayoutInfo.bindingCount = 1;
+
+  if(vkCreateDescriptorSetLayout(app->device, &setLayoutInfo, NULL, &meshlets->pyramidSetLayout) != VK_SUCCESS) {
+    printf("failed to create pyramid descriptor set layout\n");
+    exit(1);
+  }
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &meshlets->hizSetLayout;
+
+  if(vkCreatePipelineLayout(app->device, &pipelineLayoutInfo, NULL, &meshlets->hizPipelineLayout) != VK_SUCCESS) {
+    printf("failed to create hi-z pipeline layout\n");
+    exit(1);
+  }
+
+  VkComputePipelineCreateInfo pipelineInfo = {};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage = app_private_shader_stage(VK_SHADER_STAGE_COMPUTE_BIT, module, NULL);
+  pipelineInfo.layout = meshlets->hizPipelineLayout;
+
+  if(vkCreateComputePipelines(app->device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &meshlets->hizPipeline) != VK_SUCCESS) {
+    printf("failed to create hi-z pipeline\n");
+    exit(1);
+  }
+  memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_PIPELINE);
+
+  vkDestroyShaderModule(app->device, module, NULL);
+}
+
+void app_private_cleanup_meshlet_occlusion(App *app) {
+  MeshletRenderer *meshlets = &app->meshlets;
+
+  memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_PIPELINE);
+  vkDestroyPipeline(app->device, meshlets->hizPipeline, NULL);
+  vkDestroyPipelineLayout(app->device, meshlets->hizPipelineLayout, NULL);
+  vkDestroyDescriptorSetLayout(app->device, meshlets->hizSetLayout, NULL);
+  vkDestroyDescriptorSetLayout(app->device, meshlets->pyramidSetLayout, NULL);
+  vkDestroySampler(app->device, meshlets->hizSampler, NULL);
+
+  memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_BUFFER);
+  vkDestroyBuffer(app->device, meshlets->visibilityBuffer, NULL);
+  memory_tracker_free(&globalMemoryTracker, app->device, meshlets->visibilityMemory);
+
+  meshlets->occlusion = false;
+}
+
+// one set for the whole renderer, binding i is buffers[i]; per frame and
+// output data is picked with push constant indices instead of more sets.
+// with occlusion culling the output's pyramid is set 1, the mesh shader path
+// draws as well and adds the mesh texture at MESH_TEXTURE_SET
+void app_private_init_vulkan_create_meshlet_renderer_descriptors(App *app, VkShaderStageFlags stages, uint32_t bindingsCount, const VkBuffer *buffers) {
+  MeshletRenderer *meshlets = &app->meshlets;
+
+  VkDescriptorSetLayoutBinding bindings[6] = {};
+  for(int i = 0; i < bindingsCount; i++) {
+    bindings[i].binding = i;
+    bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = stages;
+  }
+
+  VkDescriptorSetLayoutCreateInfo setLayoutInfo = {};
+  setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  setLayoutInfo.bindingCount = bindingsCount;
+  setLayoutInfo.pBindings = bindings;
+
+  if(vkCreateDescriptorSetLayout(app->device, &setLayoutInfo, NULL, &meshlets->setLayout) != VK_SUCCESS) {
+    printf("failed to create meshlet descriptor set layout\n");
+    exit(1);
+  }
+
+  VkPushConstantRange pushConstantRange = {};
+  pushConstantRange.stageFlags = stages;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(MeshletPushConstants);
+
+  VkDescriptorSetLayout setLayouts[MESH_TEXTURE_SET + 1] = {meshlets->setLayout, meshlets->occlusion ? meshlets->pyramidSetLayout : app->meshTexture.emptySetLayout, app->meshTexture.setLayout};
+  bool textured = (stages & VK_SHADER_STAGE_MESH_BIT_EXT) != 0;
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = textured ? MESH_TEXTURE_SET + 1 : meshlets->occlusion ? 2 : 1;
+  pipelineLayoutInfo.pSetLayouts = setLayouts;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  if(vkCreatePipelineLayout(app->device, &pipelineLayoutInfo, NULL, &meshlets->pipelineLayout) != VK_SUCCESS) {
+    printf("failed to create meshlet pipeline layout\n");
+    exit(1);
+  }
+
+  VkDescriptorPoolSize poolSize = {};
+  poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSize.descriptorCount = bindingsCount;
+
+  VkDescriptorPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.maxSets = 1;
+  poolInfo.poolSizeCount = 1;
+  poolInfo.pPoolSizes = &poolSize;
+
+  if(vkCreateDescriptorPool(app->device, &poolInfo, NULL, &meshlets->descriptorPool) != VK_SUCCESS) {
+    printf("failed to create meshlet descriptor pool\n");
+    exit(1);
+  }
+
+  VkDescriptorSetAllocateInfo setAllocInfo = {};
+  setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  setAllocInfo.descriptorPool = meshlets->descriptorPool;
+  setAllocInfo.descriptorSetCount = 1;
+  setAllocInfo.pSetLayouts = &meshlets->setLayout;
+
+  if(vkAllocateDescriptorSets(app->device, &setAllocInfo, &meshlets->descriptorSet) != VK_SUCCESS) {
+    printf("failed to allocate meshlet descriptor set\n");
+    exit(1);
+  }
+
+  VkDescriptorBufferInfo bufferInfos[6];
+  VkWriteDescriptorSet writes[6];
+
+  for(int i = 0; i < bindingsCount; i++) {
+    bufferInfos[i].buffer = buffers[i];
+    bufferInfos[i].offset = 0;
+    bufferInfos[i].range = VK_WHOLE_SIZE;
+
+    memset(&writes[i], 0, sizeof(VkWriteDescriptorSet));
+    writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[i].dstSet = meshlets->descriptorSet;
+    writes[i].dstBinding = i;
+    writes[i].descriptorCount = 1;
+    writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[i].pBufferInfo = &bufferInfos[i];
+  }
+
+  vkUpdateDescriptorSets(app->device, bindingsCount, writes, 0, NULL);
+}
+
+bool app_private_meshlets_applicable(App *app, const DrawCommand *command) {
+  // replayed traces may name the mesh with other push constants or a partial range
+  return app->meshlets.path != MESHLET_PATH_NONE
+    && command->kind == DRAW_COMMAND_MESHLETS
+    && command->hasPushConstants
+    && command->indexBuffer == app->mesh.indexBuffer
+    && command->count == app->mesh.indexCount;
+}
+
+const DrawCommand *app_private_meshlets_find_command(App *app, const DrawList *drawList) {
+  for(int i = 0; i < drawList->count; i++) {
+    if(app_private_meshlets_applicable(app, &drawList->commands[i]))
+      return &drawList->commands[i];
+  }
+  return NULL;
+}
+
+MeshletPushConstants app_private_meshlets_push_constants(App *app, const DrawCommand *command, uint32_t output, MeshletPhase phase) {
+  uint32_t slot = app->currentFrame * app->outputsCount + output;
+  uint32_t phasesCount = app->meshlets.occlusion ? MESHLET_PHASE_COUNT : 1;
+
+  MeshletPushConstants pushConstants = {};
+  pushConstants.mesh = command->pushConstants;
+  pushConstants.meshletsCount = app->mesh.meshletsCount;
+  pushConstants.firstDraw = (slot * phasesCount + phase) * app->mesh.meshletsCount;
+  pushConstants.statsIndex = slot;
+  pushConstants.instanceCount = command->instanceCount;
+  pushConstants.phase = phase;
+  pushConstants.firstVisibility = output * app->mesh.meshletsCount;
+  pushConstants.depthWidth = app->outputs[output].renderExtent.width;
+  pushConstants.depthHeight = app->outputs[output].renderExtent.height;
+  return pushConstants;
+}
+
+// compute path only, must be recorded outside the render pass
+void app_private_meshlets_record_cull(App *app, VkCommandBuffer commandBuffer, const DrawCommand *command, uint32_t output, MeshletPhase phase) {
+  MeshletRenderer *meshlets = &app->meshlets;
+  MeshletPushConstants pushConstants = app_private_meshlets_push_constants(app, command, output, phase);
+
+  // each phase reads the visibility the previous one wrote, the early
+  // phase's predecessor being last frame's late phase
+  if(meshlets->occlusion) {
+    VkPipelineStageFlags cullStage = meshlets->path == MESHLET_PATH_COMPUTE ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT;
+
+    VkBufferMemoryBarrier visibilityBarrier = {};
+    visibilityBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    visibilityBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    visibilityBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    visibilityBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    visibilityBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    visibilityBarrier.buffer = meshlets->visibilityBuffer;
+    visibilityBarrier.offset = (VkDeviceSize)pushConstants.firstVisibility * sizeof(uint32_t);
+    visibilityBarrier.size = (VkDeviceSize)pushConstants.meshletsCount * sizeof(uint32_t);
+
+    vkCmdPipelineBarrier(commandBuffer, cullStage, cullStage, 0, 0, NULL, 1, &visibilityBarrier, 0, NULL);
+  }
+
+  // the task shader culls as it draws
+  if(meshlets->path != MESHLET_PATH_COMPUTE)
+    return;
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, meshlets->pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, meshlets->pipelineLayout, 0, 1, &meshlets->descriptorSet, 0, NULL);
+  if(meshlets->occlusion)
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, meshlets->pipelineLayout, 1, 1, &app->outputs[output].hiz.cullSet, 0, NULL);
+  vkCmdPushConstants(commandBuffer, meshlets->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(MeshletPushConstants), &pushConstants);
+  vkCmdDispatch(commandBuffer, (pushConstants.meshletsCount + MESHLET_CULL_GROUP_SIZE - 1) / MESHLET_CULL_GROUP_SIZE, 1, 1);
+
+  VkBufferMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = meshlets->drawBuffer;
+  barrier.offset = (VkDeviceSize)pushConstants.firstDraw * sizeof(VkDrawIndexedIndirectCommand);
+  barrier.size = (VkDeviceSize)pushConstants.meshletsCount * sizeof(VkDrawIndexedIndirectCommand);
+
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 0, NULL, 1, &barrier, 0, NULL);
+}
+
+// inside the render pass. the compute path expects the command's own
+// pipeline, buffers and push constants bound, the mesh shader path binds its own
+void app_private_meshlets_record_draw(App *app, VkCommandBuffer commandBuffer, const DrawCommand *command, uint32_t output, MeshletPhase phase) {
+  MeshletRenderer *meshlets = &app->meshlets;
+  MeshletPushConstants pushConstants = app_private_meshlets_push_constants(app, command, output, phase);
+
+  if(meshlets->path == MESHLET_PATH_COMPUTE) {
+    VkDeviceSize offset = (VkDeviceSize)pushConstants.firstDraw * sizeof(VkDrawIndexedIndirectCommand);
+    for(uint32_t first = 0; first < pushConstants.meshletsCount; first += meshlets->maxDrawIndirectCount) {
+      uint32_t count = pushConstants.meshletsCount - first < meshlets->maxDrawIndirectCount ? pushConstants.meshletsCount - first : meshlets->maxDrawIndirectCount;
+      vkCmdDrawIndexedIndirect(commandBuffer, meshlets->drawBuffer, offset + first * sizeof(VkDrawIndexedIndirectCommand), count, sizeof(VkDrawIndexedIndirectCommand));
+    }
+    return;
+  }
+
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshlets->pipeline);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshlets->pipelineLayout, 0, 1, &meshlets->descriptorSet, 0, NULL);
+  if(meshlets->occlusion)
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshlets->pipelineLayout, 1, 1, &app->outputs[output].hiz.cullSet, 0, NULL);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshlets->pipelineLayout, MESH_TEXTURE_SET, 1, &app->meshTexture.sets[app->currentFrame], 0, NULL);
+  vkCmdPushConstants(commandBuffer, meshlets->pipelineLayout, VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT, 0, sizeof(MeshletPushConstants), &pushConstants);
+
+  // instances are the y workgroups, split so no draw goes past the
+  // guaranteed per dimension and total task workgroup limits
+  uint32_t groupsCount = (pushConstants.meshletsCount + MESHLET_TASK_GROUP_SIZE - 1) / MESHLET_TASK_GROUP_SIZE;
+  uint32_t instancesPerDraw = MESHLET_MAX_TASK_GROUPS / groupsCount;
+  instancesPerDraw = instancesPerDraw < 1 ? 1 : instancesPerDraw > 65535 ? 65535 : instancesPerDraw;
+
+  for(uint32_t first = 0; first < command->instanceCount; first += instancesPerDraw) {
+    uint32_t instances = command->instanceCount - first < instancesPerDraw ? command->instanceCount - first : instancesPerDraw;
+    meshlets->drawMeshTasks(commandBuffer, groupsCount, instances, 1);
+  }
+}
+
+// makes the culling counters visible to collect_stats after the frame's fence
+void app_private_meshlets_record_stats_barrier(App *app, VkCommandBuffer commandBuffer) {
+  VkMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+  VkPipelineStageFlags srcStage = app->meshlets.path == MESHLET_PATH_COMPUTE ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT;
+  vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
+// after the frame's fence, the shaders' counters for that frame are final
+void app_private_meshlets_collect_stats(App *app) {
+  MeshletRenderer *meshlets = &app->meshlets;
+  if(meshlets->path == MESHLET_PATH_NONE)
+    return;
+
+  for(int i = 0; i < app->outputsCount; i++) {
+    MeshletStats *stats = &meshlets->stats[app->currentFrame * app->outputsCount + i];
+    meshlets->reportVisibleMeshlets += stats->visibleMeshlets;
+    meshlets->reportVisibleTriangles += stats->visibleTriangles;
+    meshlets->reportOccludedMeshlets += stats->occludedMeshlets;
+    memset(stats, 0, sizeof(MeshletStats));
+  }
+
+  meshlets->reportSubmittedTriangles += meshlets->submittedTriangles[app->currentFrame];
+  meshlets->submittedTriangles[app->currentFrame] = 0;
+
+  if(++meshlets->framesSinceReport < MESHLET_REPORT_FRAMES)
+    return;
+
+  if(meshlets->reportSubmittedTriangles > 0)
+    printf("meshlets: %.1f%% of triangles reach the rasterizer, %.1f meshlets visible per frame\n",
+      100.0 * meshlets->reportVisibleTriangles / meshlets->reportSubmittedTriangles, (double)meshlets->reportVisibleMeshlets / meshlets->framesSinceReport);
+  if(meshlets->occlusion)
+    printf("meshlets: %.1f occluded per frame\n", (double)meshlets->reportOccludedMeshlets / meshlets->framesSinceReport);
+
+  meshlets->framesSinceReport = 0;
+  meshlets->reportSubmittedTriangles = 0;
+  meshlets->reportVisibleTriangles = 0;
+  meshlets->reportVisibleMeshlets = 0;
+  meshlets->reportOccludedMeshlets = 0;
+}
+
+// the post process targets are the internal resolution targets, without
+// them the scene goes straight into the swapchain and cannot be scaled
+void app_private_init_vulkan_create_resolution_controller(App *app) {
+  double targetMs = globalConfig.targetFrameMs;
+
+  if(targetMs > 0.0 && !app->postProcess.enabled) {
+    printf("dynamic resolution needs post processing to upscale from, rendering at full size\n");
+    targetMs = 0.0;
+  }
+  if(targetMs > 0.0 && !app->frameGraph.timestampsEnabled[FRAME_GRAPH_QUEUE_GRAPHICS]) {
+    printf("dynamic resolution needs gpu timings, rendering at full size\n");
+    targetMs = 0.0;
+  }
+
+  resolution_controller_init(&app->resolution, targetMs, globalConfig.minRenderScale);
+
+  if(app->resolution.enabled)
+    printf("dynamic resolution holding %.2f ms, down to %.0f%% of the swapchain size\n", targetMs, app->resolution.minScale * 100.0);
+}
+
+void app_private_init_vulkan_collect_trace_handles(App *app) {
+  TraceHandles *handles = &app->traceHandles;
+  memset(handles, 0, sizeof(TraceHandles));
+
+  handles->pipelines[handles->pipelinesCount] = app->graphicsPipeline;
+  handles->layouts[handles->pipelinesCount++] = app->pipelineLayout;
+  if(app->meshPipeline != VK_NULL_HANDLE) {
+    handles->pipelines[handles->pipelinesCount] = app->meshPipeline;
+    handles->layouts[handles->pipelinesCount++] = app->meshPipelineLayout;
+  }
+
+  handles->buffers[handles->buffersCount++] = VK_NULL_HANDLE;
+  if(app->mesh.loaded) {
+    handles->buffers[handles->buffersCount++] = app->mesh.vertexBuffer;
+    handles->buffers[handles->buffersCount++] = app->mesh.indexBuffer;
+  }
+}
+
+void app_private_init_vulkan_create_headless_targets(App *app, Output *output) {
+  output->swapChainImagesCount = HEADLESS_IMAGE_COUNT;
+  output->swapChainImages = ARENA_ALLOC_ARRAY(&output->swapChainArena, VkImage, HEADLESS_IMAGE_COUNT);
+  output->headlessImageMemory = ARENA_ALLOC_ARRAY(&output->swapChainArena, VkDeviceMemory, HEADLESS_IMAGE_COUNT);
+  output->swapChainImageFormat = HEADLESS_FORMAT;
+  output->swapChainExtent = app->headlessExtent;
+
+  for(int i = 0; i < HEADLESS_IMAGE_COUNT; i++) {
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = HEADLESS_FORMAT;
+    imageInfo.extent.width = app->headlessExtent.width;
+    imageInfo.extent.height = app->headlessExtent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if(vkCreateImage(app->device, &imageInfo, NULL, &output->swapChainImages[i]) != VK_SUCCESS) {
+      printf("failed to create headless image\n");
+      exit(1);
+    }
+    memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_IMAGE);
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(app->device, output->swapChainImages[i], &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = app_private_find_memory_type(app, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if(memory_tracker_allocate(&globalMemoryTracker, app->device, &allocInfo, &output->headlessImageMemory[i]) != VK_SUCCESS) {
+      printf("failed to allocate headless image memory\n");
+      exit(1);
+    }
+    vkBindImageMemory(app->device, output->swapChainImages[i], output->headlessImageMemory[i], 0);
+  }
+
+  if(!globalConfig.readback)
+    return;
+
+  // HEADLESS_FORMAT is four bytes a texel
+  output->readbackSize = (VkDeviceSize)app->headlessExtent.width * app->headlessExtent.height * 4;
+  for(int i = 0; i < globalConfig.framesInFlight; i++) {
+    app_private_create_buffer(app, output->readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &output->readbackBuffers[i], &output->readbackMemory[i]);
+    vkMapMemory(app->device, output->readbackMemory[i], 0, VK_WHOLE_SIZE, 0, (void **)&output->readbackMapped[i]);
+    output->readbackPending[i] = false;
+  }
+}
+
+VkShaderModule app_private_create_shader_module(App *app, const char *path) {
+  size_t codeSize;
+  uint8_t *code = helper_read_file(path, &codeSize);
+
+  if(code == NULL)
+    return VK_NULL_HANDLE;
+
+  VkShaderModuleCreateInfo createInfo = {};
+  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  createInfo.codeSize = codeSize;
+  createInfo.pCode = (uint32_t*)code;
+  createInfo.pNext = NULL;
+  createInfo.flags = 0;
+
+  VkShaderModule module;
+  if(vkCreateShaderModule(app->device, &createInfo, NULL, &module) != VK_SUCCESS) {
+    printf("failed to create shader module %s\n", path);
+    exit(1);
+  }
+
+  free(code);
+  return module;
+}
+
+uint32_t app_private_find_memory_type(App *app, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+  VkPhysicalDeviceMemoryProperties *memProperties = &app->capabilities->memoryProperties;
+
+  for(uint32_t i = 0; i < memProperties->memoryTypeCount; i++) {
+    if((typeFilter & (1u << i)) && (memProperties->memoryTypes[i].propertyFlags & properties) == properties)
+      return i;
+  }
+
+  printf("failed to find suitable memory type\n");
+  exit(1);
+}
+
+void app_private_create_buffer(App *app, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer *buffer, VkDeviceMemory *memory) {
+  VkBufferCreateInfo bufferInfo = {};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size = size;
+  bufferInfo.usage = usage;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  if(vkCreateBuffer(app->device, &bufferInfo, NULL, buffer) != VK_SUCCESS) {
+    printf("failed to create buffer\n");
+    exit(1);
+  }
+  memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_BUFFER);
+
+  VkMemoryRequirements memRequirements;
+  vkGetBufferMemoryRequirements(app->device, *buffer, &memRequirements);
+
+  VkMemoryAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = memRequirements.size;
+  allocInfo.memoryTypeIndex = app_private_find_memory_type(app, memRequirements.memoryTypeBits, properties);
+
+  if(memory_tracker_allocate(&globalMemoryTracker, app->device, &allocInfo, memory) != VK_SUCCESS) {
+    printf("failed to allocate buffer memory\n");
+    exit(1);
+  }
+
+  vkBindBufferMemory(app->device, *buffer, *memory, 0);
+}
+
+VkCommandBuffer app_private_begin_one_time_commands(App *app) {
+  VkCommandBufferAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.commandPool = app->commandPool;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandBufferCount = 1;
+
+  VkCommandBuffer commandBuffer;
+  if(vkAllocateCommandBuffers(app->device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+    printf("failed to create command buffers\n");
+    exit(1);
+  }
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  return commandBuffer;
+}
+
+void app_private_end_one_time_commands(App *app, VkCommandBuffer commandBuffer) {
+  vkEndCommandBuffer(commandBuffer);
+
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+
+  if(vkQueueSubmit(app->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+    printf("failed to submit one time commands\n");
+    exit(1);
+  }
+  vkQueueWaitIdle(app->graphicsQueue);
+
+  vkFreeCommandBuffers(app->device, app->commandPool, 1, &commandBuffer);
+}
+
+VkDebugUtilsMessengerCreateInfoEXT app_private_populate_debug_messenger_info() {
+  VkDebugUtilsMessengerCreateInfoEXT createInfo;
+  createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+  createInfo.messageSeverity = globalDebugLogger.severityMask;
+  createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
+                           VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+                           VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+  createInfo.pfnUserCallback = app_private_debug_callback;
+  createInfo.pUserData = &globalDebugLogger;
+  createInfo.flags = 0;
+  createInfo.pNext = NULL;
+  return createInfo;
+}
+
+VKAPI_ATTR VkBool32 VKAPI_CALL app_private_debug_callback(
+  VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+  VkDebugUtilsMessageTypeFlagsEXT messageType,
+  const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
+  void *pUserData) {
+
+  debug_logger_submit(pUserData, messageSeverity, pCallbackData->messageIdNumber, pCallbackData->pMessageIdName, pCallbackData->pMessage);
+
+  return VK_FALSE;
+}
+
+static void app_private_framebuffer_resize_callback(GLFWwindow *window, int width, int height) {
+  App *app = glfwGetWindowUserPointer(window);
+  for(int i = 0; i < app->outputsCount; i++) {
+    if(app->outputs[i].window == window)
+      app->outputs[i].framebufferResized = true;
+  }
+  app->frameDirty = true;
+}
+
+static void app_private_key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+  App *app = glfwGetWindowUserPointer(window);
+  app->frameDirty = true;
+}
+
+static void app_private_cursor_position_callback(GLFWwindow *window, double x, double y) {
+  App *app = glfwGetWindowUserPointer(window);
+  app->frameDirty = true;
+}
+
+static void app_private_mouse_button_callback(GLFWwindow *window, int button, int action, int mods) {
+  App *app = glfwGetWindowUserPointer(window);
+  app->frameDirty = true;
+}
+
+static void app_private_scroll_callback(GLFWwindow *window, double x, double y) {
+  App *app = glfwGetWindowUserPointer(window);
+  app->frameDirty = true;
+}
+
+static void app_private_window_refresh_callback(GLFWwindow *window) {
+  App *app = glfwGetWindowUserPointer(window);
+  app->frameDirty = true;
+}
+
+void app_wake(App *app) {
+  uint64_t one = 1;
+  if(write(app->wakeFd, &one, sizeof(one)) < 0) {
+    // counter saturated, a wake-up is already pending
+  }
+}
+
+void *app_private_wake_thread(void *arg) {
+  App *app = arg;
+  struct pollfd pfd = {app->wakeFd, POLLIN, 0};
+
+  while(true) {
+    if(poll(&pfd, 1, -1) <= 0)
+      continue;
+
+    uint64_t count;
+    if(read(app->wakeFd, &count, sizeof(count)) < 0)
+      continue;
+
+    pthread_mutex_lock(&app->wakeMutex);
+    bool running = app->wakeRunning;
+    app->wakePending = true;
+    pthread_mutex_unlock(&app->wakeMutex);
+
+    if(!running)
+      break;
+
+    glfwPostEmptyEvent();
+  }
+
+  return NULL;
+}
+
+void app_private_main_loop_wait_for_work(App *app) {
+  double now = helper_time_ns() / 1e9;
+  double timeout = -1.0; // block until an event arrives
+
+  if(globalConfig.animationTickRate > 0.0)
+    timeout = fmax(0.0, app->lastAnimationTick + 1.0 / globalConfig.animationTickRate - now);
+
+  if(app->textureStreaming && !texture_streamer_idle(&app->textureStreamer))
+    timeout = timeout < 0.0 ? ON_DEMAND_STREAMING_POLL_INTERVAL : fmin(timeout, ON_DEMAND_STREAMING_POLL_INTERVAL);
+
+  if(app->frameDirty)
+    glfwPollEvents();
+  else if(timeout < 0.0)
+    glfwWaitEvents();
+  else
+    glfwWaitEventsTimeout(timeout);
+
+  pthread_mutex_lock(&app->wakeMutex);
+  if(app->wakePending) {
+    app->wakePending = false;
+    app->frameDirty = true;
+  }
+  pthread_mutex_unlock(&app->wakeMutex);
+
+  now = helper_time_ns() / 1e9;
+  if(globalConfig.animationTickRate > 0.0 && now - app->lastAnimationTick >= 1.0 / globalConfig.animationTickRate) {
+    app->animationTime += now - app->lastAnimationTick;
+    app->lastAnimationTick = now;
+    app->frameDirty = true;
+  }
+}
+
+void app_private_main_loop(App* app) {
+  uint64_t loopStart = helper_time_ns();
+
+  while(!app_private_main_loop_should_close(app)) {
+#ifndef NDEBUG
+    uint64_t heapAllocationsBefore = globalHeapAllocationsCount;
+#endif
+
+    if(app->renderMode == RENDER_MODE_ON_DEMAND) {
+      app_private_main_loop_wait_for_work(app);
+
+      // frames update the streamer in one of their jobs
+      if(!app->frameDirty) {
+        if(app->textureStreaming) {
+          texture_streamer_update(&app->textureStreamer, &app->submitBatcher);
+          submit_batcher_flush(&app->submitBatcher, VK_NULL_HANDLE);
+        }
+        continue;
+      }
+    }
+    else {
+      double now = helper_time_ns() / 1e9;
+      app->animationTime += now - app->lastAnimationTick;
+      app->lastAnimationTick = now;
+    }
+
+    app->frameDirty = false;
+    uint64_t frameStart = helper_time_ns();
+
+    if(app->headless && globalConfig.resizeInterval > 0 && app->framesDrawn > 0 && app->framesDrawn % globalConfig.resizeInterval == 0)
+      app_private_main_loop_resize_storm(app);
+
+    frame_pacer_wait(&app->framePacer, app->device, app->outputs[0].swapChain);
+
+    if(!app->headless)
+      glfwPollEvents();
+    frame_pacer_sample_input(&app->framePacer);
+
+    app_private_main_loop_draw_frame(app);
+    app->framesDrawn++;
+
+    uint64_t frameEnd = helper_time_ns();
+    if(app->framesDrawn == 1)
+      app->benchmark.firstFrameTime = frameEnd - app->benchmark.startTime;
+    if(app->benchmark.frameTimes != NULL && app->benchmark.frameTimesCount < globalConfig.frames)
+      app->benchmark.frameTimes[app->benchmark.frameTimesCount++] = frameEnd - frameStart;
+
+#ifndef NDEBUG
+    // only sees allocations checked through CHECK_ALLOC_FOR_NULL, malloc calls
+    // made elsewhere (libc, glfw, the driver) are not counted
+    assert(globalHeapAllocationsCount == heapAllocationsBefore && "heap allocation in the frame loop");
+#endif
+  }
+
+  // queued frames belong to the loop's throughput
+  vkDeviceWaitIdle(app->device);
+  app->benchmark.loopTime = helper_time_ns() - loopStart;
+}
+
+// the outputs only make sense together, closing any window ends the run
+bool app_private_main_loop_should_close(App *app) {
+  if(globalConfig.frames > 0 && app->framesDrawn >= globalConfig.frames)
+    return true;
+
+  for(int i = 0; i < app->outputsCount && !app->headless; i++) {
+    if(glfwWindowShouldClose(app->outputs[i].window))
+      return true;
+  }
+  return false;
+}
+
+// alternates the headless target between the configured size and half of
+// it, which rebuilds the targets, the frame graph and everything sized by them
+void app_private_main_loop_resize_storm(App *app) {
+  bool full = app->headlessExtent.width == globalConfig.windowWidth && app->headlessExtent.height == globalConfig.windowHeight;
+  app->headlessExtent.width = full ? (globalConfig.windowWidth + 1) / 2 : globalConfig.windowWidth;
+  app->headlessExtent.height = full ? (globalConfig.windowHeight + 1) / 2 : globalConfig.windowHeight;
+  app_private_recreate_swap_chain(app, 1u);
+}
+
+void app_private_replay_loop(App *app) {
+  TracePlayer *player = &app->tracePlayer;
+
+  uint32_t firstFrame = globalConfig.replayFrame >= 0 ? (uint32_t)globalConfig.replayFrame : 0;
+  uint32_t endFrame = globalConfig.replayFrame >= 0 ? firstFrame + 1 : player->framesCount;
+
+  if(firstFrame >= player->framesCount) {
+    printf("replay: trace has %u frames, frame %u requested\n", player->framesCount, firstFrame);
+    exit(1);
+  }
+
+  // isolating one frame waits for the gpu after every submit so each sample
+  // is the frame's full latency, whole trace replays measure throughput
+  bool isolate = globalConfig.replayFrame >= 0;
+
+  uint64_t samplesCount = (uint64_t)(endFrame - firstFrame) * globalConfig.replayRepeat;
+  uint64_t *frameTimes = malloc(samplesCount * sizeof(uint64_t));
+  CHECK_ALLOC_FOR_NULL(frameTimes);
+
+  uint64_t slowestTime = 0;
+  uint32_t slowestFrame = firstFrame;
+  uint64_t samples = 0;
+
+  uint64_t start = helper_time_ns();
+  uint64_t previous = start;
+
+  for(uint32_t pass = 0; pass < globalConfig.replayRepeat; pass++) {
+    uint64_t passStart = helper_time_ns();
+    uint64_t traceStart = trace_player_frame(player, firstFrame)->timeNs;
+
+    for(uint32_t i = firstFrame; i < endFrame; i++) {
+      const TraceFrameHeader *frame = trace_player_frame(player, i);
+
+      if(globalConfig.replayTiming == REPLAY_TIMING_ORIGINAL)
+        helper_sleep_until_ns(passStart + (frame->timeNs - traceStart));
+
+      if(frame->width != app->outputs[0].swapChainExtent.width || frame->height != app->outputs[0].swapChainExtent.height) {
+        app->headlessExtent.width = frame->width;
+        app->headlessExtent.height = frame->height;
+        app_private_recreate_swap_chain(app, 1u);
+      }
+
+      app->replayFrame = i;
+      app_private_main_loop_draw_frame(app);
+
+      if(isolate)
+        vkDeviceWaitIdle(app->device);
+
+      uint64_t now = helper_time_ns();
+      frameTimes[samples++] = now - previous;
+      if(now - previous > slowestTime) {
+        slowestTime = now - previous;
+        slowestFrame = i;
+      }
+      previous = now;
+    }
+  }
+
+  vkDeviceWaitIdle(app->device);
+  uint64_t total = helper_time_ns() - start;
+
+  helper_sort_u64(frameTimes, samples);
+
+  printf("replay: %llu frames in %.1f ms (%.1f fps), frame ms median %.3f p99 %.3f max %.3f (trace frame %u, captured %.3f)\n",
+    (unsigned long long)samples, total / 1e6, samples / (total / 1e9),
+    frameTimes[samples / 2] / 1e6, frameTimes[samples * 99 / 100] / 1e6, frameTimes[samples - 1] / 1e6,
+    slowestFrame, trace_player_frame(player, slowestFrame)->cpuTimeNs / 1e6);
+
+  free(frameTimes);
+}
+
+// key value lines, read by perf/run.sh
+void app_private_write_benchmark(App *app) {
+  Benchmark *benchmark = &app->benchmark;
+
+  FILE *file = fopen(globalConfig.benchmarkPath, "w");
+  if(file == NULL) {
+    printf("failed to open benchmark file %s\n", globalConfig.benchmarkPath);
+    exit(1);
+  }
+
+  uint64_t count = benchmark->frameTimesCount;
+  helper_sort_u64(benchmark->frameTimes, count);
+
+  fprintf(file, "device %s\n", app->capabilities->properties.deviceName);
+  fprintf(file, "frames %llu\n", (unsigned long long)count);
+  fprintf(file, "startup_ms %.3f\n", benchmark->initTime / 1e6);
+  fprintf(file, "first_frame_ms %.3f\n", benchmark->firstFrameTime / 1e6);
+  if(count > 0) {
+    fprintf(file, "frame_ms_median %.3f\n", benchmark->frameTimes[count / 2] / 1e6);
+    fprintf(file, "frame_ms_p99 %.3f\n", benchmark->frameTimes[count * 99 / 100] / 1e6);
+    fprintf(file, "frame_ms_max %.3f\n", benchmark->frameTimes[count - 1] / 1e6);
+    fprintf(file, "frame_ms_mean %.3f\n", benchmark->loopTime / 1e6 / count);
+  }
+  if(globalConfig.readback)
+    fprintf(file, "readback_checksum %016llx\n", (unsigned long long)benchmark->readbackChecksum);
+
+  fclose(file);
+  printf("benchmark: %llu frames, results in %s\n", (unsigned long long)count, globalConfig.benchmarkPath);
+}
+
+void app_private_main_loop_draw_frame(App* app) {
+  VkFence inFlightFence = app->inFlightFences[app->currentFrame];
+  Arena *frameArena = &app->frameArenas[app->currentFrame];
+
+  vkWaitForFences(app->device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+  memory_tracker_update(&globalMemoryTracker);
+  app_private_meshlets_collect_stats(app);
+  app_private_main_loop_draw_frame_collect_readback(app);
+
+  // outputs acquired before a failing one already hold an image and a pending
+  // semaphore signal that only this frame's submit and present consume, so
+  // nothing is rebuilt mid frame. a minimized output, or one whose acquire
+  // comes back out of date, sits the frame out and is rebuilt after the
+  // present; a failed acquire signalled nothing
+  uint32_t droppedMask = 0;
+  uint32_t rebuildMask = 0;
+
+  for(int i = 0; i < app->outputsCount; i++) {
+    Output *output = &app->outputs[i];
+
+    if(app->headless) {
+      output->imageIndex = app->headlessFrame++ % output->swapChainImagesCount;
+      continue;
+    }
+
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(output->window, &width, &height);
+    if(width == 0 || height == 0) {
+      droppedMask |= 1u << i;
+      continue;
+    }
+
+    VkResult result = vkAcquireNextImageKHR(app->device, output->swapChain, UINT64_MAX, output->imageAvailableSemaphores[app->currentFrame], VK_NULL_HANDLE, &output->imageIndex);
+
+    if(result == VK_ERROR_OUT_OF_DATE_KHR) {
+      droppedMask |= 1u << i;
+      rebuildMask |= 1u << i;
+    }
+    else if(result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+      printf("failed to acquire swap chain image\n");
+      exit(1);
+    }
+  }
+
+  // nothing to show: no image is held and the fence is still signalled, so
+  // rebuild now, or sleep until a minimized window comes back
+  if(droppedMask == (1u << app->outputsCount) - 1) {
+    if(rebuildMask != 0)
+      app_private_recreate_swap_chain(app, rebuildMask);
+    else
+      glfwWaitEvents();
+    return;
+  }
+
+  // only reset once we know work will be submitted, otherwise the next wait deadlocks
+  vkResetFences(app->device, 1, &inFlightFence);
+  arena_reset(frameArena);
+
+  FrameGraph *graph = &app->frameGraph;
+  frame_graph_begin_frame(graph, app->currentFrame);
+  app_private_main_loop_draw_frame_update_render_extent(app);
+  app_private_main_loop_draw_frame_update_mesh_texture(app);
+
+  for(int i = 0; i < app->outputsCount; i++) {
+    Output *output = &app->outputs[i];
+    if(droppedMask & (1u << i))
+      frame_graph_set_imported_image(graph, output->frameGraphSwapChainImage, VK_NULL_HANDLE, VK_NULL_HANDLE);
+    else
+      frame_graph_set_imported_image(graph, output->frameGraphSwapChainImage, output->swapChainImages[output->imageIndex], output->swapChainImageViews[output->imageIndex]);
+  }
+
+  // the frame as jobs: texture uploads run beside everything, each output's
+  // draw list is built on its own, then recorded into its main pass
+  // secondaries a chunk per job, and every segment is recorded once all the
+  // draws are. the main thread helps until they finish, then submits
+  JobSystem *jobs = &app->jobSystem;
+  DrawList *drawLists = ARENA_ALLOC_ARRAY(frameArena, DrawList, app->outputsCount);
+  FrameJob *outputJobs = ARENA_ALLOC_ARRAY(frameArena, FrameJob, app->outputsCount);
+  FrameJob *chunkJobs = ARENA_ALLOC_ARRAY(frameArena, FrameJob, app->outputsCount * DRAW_LIST_MAX_CHUNKS);
+  FrameJob *segmentJobs = ARENA_ALLOC_ARRAY(frameArena, FrameJob, graph->segmentsCount);
+  uint32_t buildJobs[MAX_OUTPUTS];
+  uint32_t drawJobs[MAX_OUTPUTS * DRAW_LIST_MAX_CHUNKS];
+  uint32_t recordJobs[FRAME_GRAPH_MAX_SEGMENTS];
+
+  uint32_t texturesJob = UINT32_MAX;
+  if(app->textureStreaming)
+    texturesJob = job_system_add(jobs, "textures", app_private_frame_job_update_textures, app);
+
+  // the arena and the trace player are not thread safe: lists are allocated
+  // here, and replays read theirs from the trace up front
+  for(int i = 0; i < app->outputsCount; i++) {
+    outputJobs[i] = (FrameJob){app, drawLists, i, 0};
+    buildJobs[i] = UINT32_MAX;
+
+    // a dropped output's offscreen passes still run, on an empty list,
+    // unless the capture needs it
+    if(app->replaying)
+      drawLists[i] = trace_player_build_draw_list(&app->tracePlayer, app->replayFrame, &app->traceHandles, frameArena);
+    else {
+      draw_list_init(&drawLists[i], frameArena, DRAW_LIST_MAX_COMMANDS);
+      if(!(droppedMask & (1u << i)) || (app->capturing && i == 0))
+        buildJobs[i] = job_system_add(jobs, "draw list", app_private_frame_job_build_draw_list, &outputJobs[i]);
+    }
+  }
+
+  uint32_t captureJob = UINT32_MAX;
+  if(app->capturing) {
+    captureJob = job_system_add(jobs, "capture", app_private_frame_job_capture, &outputJobs[0]);
+    if(buildJobs[0] != UINT32_MAX)
+      job_system_depend(jobs, captureJob, buildJobs[0]);
+  }
+
+  // the list's length is only known once it is built, chunks past it
+  // leave their secondary unused
+  uint32_t drawJobsCount = app->outputsCount * DRAW_LIST_MAX_CHUNKS;
+  for(int i = 0; i < drawJobsCount; i++) {
+    chunkJobs[i] = (FrameJob){app, drawLists, i / DRAW_LIST_MAX_CHUNKS, i % DRAW_LIST_MAX_CHUNKS};
+    drawJobs[i] = job_system_add(jobs, "draw record", app_private_frame_job_record_draws, &chunkJobs[i]);
+    if(buildJobs[chunkJobs[i].index] != UINT32_MAX)
+      job_system_depend(jobs, drawJobs[i], buildJobs[chunkJobs[i].index]);
+  }
+
+  for(int i = 0; i < graph->segmentsCount; i++) {
+    segmentJobs[i] = (FrameJob){app, drawLists, i, 0};
+    recordJobs[i] = job_system_add(jobs, "record", app_private_frame_job_record, &segmentJobs[i]);
+
+    for(int j = 0; j < drawJobsCount; j++) {
+      job_system_depend(jobs, recordJobs[i], drawJobs[j]);
+    }
+  }
+
+  if(texturesJob != UINT32_MAX)
+    job_system_submit(jobs, texturesJob);
+  for(int i = 0; i < app->outputsCount; i++) {
+    if(buildJobs[i] != UINT32_MAX)
+      job_system_submit(jobs, buildJobs[i]);
+  }
+  if(captureJob != UINT32_MAX)
+    job_system_submit(jobs, captureJob);
+  for(int i = 0; i < drawJobsCount; i++) {
+    job_system_submit(jobs, drawJobs[i]);
+  }
+  for(int i = 0; i < graph->segmentsCount; i++) {
+    job_system_submit(jobs, recordJobs[i]);
+  }
+
+  job_system_wait(jobs);
+
+  // dropped outputs neither wait for nor signal anything, and are left out
+  // of the present
+  VkPipelineStageFlags swapChainWaitStages[MAX_OUTPUTS];
+  uint32_t swapChainSegments[MAX_OUTPUTS];
+  VkSemaphore signalSemaphores[MAX_OUTPUTS];
+  uint32_t presentOutputs[MAX_OUTPUTS];
+  uint32_t presentOutputsCount = 0;
+
+  for(int i = 0; i < app->outputsCount; i++) {
+    Output *output = &app->outputs[i];
+    swapChainSegments[i] = frame_graph_first_use(graph, output->frameGraphSwapChainImage, &swapChainWaitStages[i]);
+    if(droppedMask & (1u << i))
+      continue;
+
+    signalSemaphores[presentOutputsCount] = app->headless ? VK_NULL_HANDLE : output->renderFinishedSemaphores[output->imageIndex];
+    presentOutputs[presentOutputsCount++] = i;
+  }
+
+  // one batch per queue segment, chained with semaphores; crossing a queue
+  // waits at ALL_COMMANDS, which the graph's cross queue barriers rely on.
+  // the textures job's upload batch is already in, the flush sends both
+  SubmitBatcher *batcher = &app->submitBatcher;
+
+  for(int i = 0; i < graph->segmentsCount; i++) {
+    bool compute = graph->segments[i].queue == FRAME_GRAPH_QUEUE_COMPUTE;
+    bool last = i == graph->segmentsCount - 1;
+    VkCommandBuffer commandBuffer = compute ? app->computeCommandBuffers[app->currentFrame][i] : app->commandBuffers[app->currentFrame][i];
+
+    submit_batcher_begin(batcher, compute ? app->computeQueue : app->graphicsQueue);
+
+    if(i > 0)
+      submit_batcher_add_wait(batcher, app->segmentSemaphores[app->currentFrame][i - 1], VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    for(int j = 0; j < app->outputsCount && !app->headless; j++) {
+      if(swapChainSegments[j] == i && !(droppedMask & (1u << j)))
+        submit_batcher_add_wait(batcher, app->outputs[j].imageAvailableSemaphores[app->currentFrame], swapChainWaitStages[j]);
+    }
+
+    submit_batcher_add_command_buffer(batcher, commandBuffer);
+
+    // nothing presents headless, so nothing would wait on the last segment
+    if(!last)
+      submit_batcher_add_signal(batcher, app->segmentSemaphores[app->currentFrame][i]);
+    for(int j = 0; j < presentOutputsCount && last && !app->headless; j++) {
+      submit_batcher_add_signal(batcher, signalSemaphores[j]);
+    }
+  }
+
+  submit_batcher_flush(batcher, inFlightFence);
+
+  if(app->headless) {
+    app->currentFrame = (app->currentFrame + 1) % globalConfig.framesInFlight;
+    return;
+  }
+
+  VkSwapchainKHR swapChains[MAX_OUTPUTS];
+  uint32_t imageIndices[MAX_OUTPUTS];
+  uint64_t presentIds[MAX_OUTPUTS];
+  VkResult results[MAX_OUTPUTS];
+
+  // the pacer follows the primary output, the others present without an id
+  for(int i = 0; i < presentOutputsCount; i++) {
+    Output *output = &app->outputs[presentOutputs[i]];
+    swapChains[i] = output->swapChain;
+    imageIndices[i] = output->imageIndex;
+    presentIds[i] = presentOutputs[i] == 0 ? frame_pacer_next_present_id(&app->framePacer) : 0;
+  }
+
+  VkPresentIdKHR presentIdInfo = {};
+  presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+  presentIdInfo.swapchainCount = presentOutputsCount;
+  presentIdInfo.pPresentIds = presentIds;
+
+  VkPresentInfoKHR presentInfo = {};
+  presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+  presentInfo.waitSemaphoreCount = presentOutputsCount;
+  presentInfo.pWaitSemaphores = signalSemaphores;
+  presentInfo.swapchainCount = presentOutputsCount;
+  presentInfo.pSwapchains = swapChains;
+  presentInfo.pImageIndices = imageIndices;
+  presentInfo.pResults = results;
+  presentInfo.pNext = app->framePacer.presentWaitEnabled ? &presentIdInfo : NULL;
+
+  // every output goes out in one present, results come back per swapchain
+  // so an out of date output only rebuilds itself
+  vkQueuePresentKHR(app->presentQueue, &presentInfo);
+  if(presentOutputs[0] == 0)
+    frame_pacer_presented(&app->framePacer);
+
+  for(int i = 0; i < presentOutputsCount; i++) {
+    Output *output = &app->outputs[presentOutputs[i]];
+
+    if(results[i] == VK_ERROR_OUT_OF_DATE_KHR || results[i] == VK_SUBOPTIMAL_KHR || output->framebufferResized)
+      rebuildMask |= 1u << presentOutputs[i];
+    else if(results[i] != VK_SUCCESS) {
+      printf("failed to present swap chain image\n");
+      exit(1);
+    }
+  }
+
+  if(rebuildMask != 0)
+    app_private_recreate_swap_chain(app, rebuildMask);
+
+  app->currentFrame = (app->currentFrame + 1) % globalConfig.framesInFlight;
+}
+
+// the frame's fence signalled, so its copies are complete; every word is
+// read so readback benchmarks pay for the host side too
+void app_private_main_loop_draw_frame_collect_readback(App *app) {
+  for(int i = 0; i < app->outputsCount; i++) {
+    Output *output = &app->outputs[i];
+    if(!output->readbackPending[app->currentFrame])
+      continue;
+
+    const uint64_t *words = output->readbackMapped[app->currentFrame];
+    uint64_t checksum = 0;
+    for(VkDeviceSize j = 0; j < output->readbackSize / sizeof(uint64_t); j++) {
+      checksum = (checksum ^ words[j]) * 0x100000001b3ull;
+    }
+
+    app->benchmark.readbackChecksum ^= checksum;
+    output->readbackPending[app->currentFrame] = false;
+  }
+}
+
+// the timings of the frame whose fence just signalled pick this frame's
+// render extent; the post passes only cover that part of their images
+void app_private_main_loop_draw_frame_update_render_extent(App *app) {
+  PostProcess *post = &app->postProcess;
+
+  resolution_controller_update(&app->resolution, app->currentFrame, app->frameGraph.stats.gpuFrameTimeMs);
+
+  for(int i = 0; i < app->outputsCount; i++) {
+    Output *output = &app->outputs[i];
+    output->renderExtent = resolution_controller_extent(&app->resolution, output->swapChainExtent);
+
+    if(!post->enabled)
+      continue;
+
+    PostProcessTargets *targets = &output->post;
+    VkExtent2D extent = output->renderExtent;
+    VkExtent2D halfExtent = {(extent.width + 1) / 2, (extent.height + 1) / 2};
+
+    targets->pushConstants = post->pushConstants;
+    targets->pushConstants.renderWidth = extent.width;
+    targets->pushConstants.renderHeight = extent.height;
+
+    targets->passes[POST_PASS_DOWNSAMPLE].groupsX = (halfExtent.width + 7) / 8;
+    targets->passes[POST_PASS_DOWNSAMPLE].groupsY = (halfExtent.height + 7) / 8;
+    targets->passes[POST_PASS_BLUR].groupsX = (halfExtent.width + 15) / 16;
+    targets->passes[POST_PASS_BLUR].groupsY = (halfExtent.height + 15) / 16;
+    targets->passes[POST_PASS_TONEMAP].groupsX = (extent.width + 7) / 8;
+    targets->passes[POST_PASS_TONEMAP].groupsY = (extent.height + 7) / 8;
+  }
+}
+
+// before the textures job runs, the view read here stays alive for
+// TEXTURE_STREAMER_VIEW_RETIRE_FRAMES after the streamer replaces it, which
+// outlasts every frame in flight that still samples through this set
+void app_private_main_loop_draw_frame_update_mesh_texture(App *app) {
+  if(app->meshPipeline == VK_NULL_HANDLE)
+    return;
+
+  MeshTexture *texture = &app->meshTexture;
+  VkImageView view = app->textureStreaming ? texture_streamer_get_view(&app->textureStreamer, 0) : VK_NULL_HANDLE;
+  if(view == VK_NULL_HANDLE)
+    view = texture->fallbackView;
+
+  if(view == texture->boundViews[app->currentFrame])
+    return;
+
+  VkDescriptorImageInfo imageInfo = {};
+  imageInfo.sampler = texture->sampler;
+  imageInfo.imageView = view;
+  imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  VkWriteDescriptorSet write = {};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = texture->sets[app->currentFrame];
+  write.dstBinding = 0;
+  write.descriptorCount = 1;
+  write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  write.pImageInfo = &imageInfo;
+
+  vkUpdateDescriptorSets(app->device, 1, &write, 0, NULL);
+  texture->boundViews[app->currentFrame] = view;
+}
+
+void app_private_main_loop_draw_frame_record_command_buffer(App *app, VkCommandBuffer commandBuffer, DrawList *drawLists, uint32_t segment) {
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = 0;
+  beginInfo.pInheritanceInfo = NULL;
+
+  if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    printf("failed to begin recording command buffer\n");
+    exit(1);
+  }
+
+  FrameContext frame = {app, drawLists};
+  frame_graph_execute_segment(&app->frameGraph, segment, commandBuffer, app->currentFrame, &frame);
+
+  if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    printf("failed to record command buffer\n");
+    exit(1);
+  }
+}
+
+// fills an empty list, draw jobs for different outputs run at the same time
+void app_private_main_loop_draw_frame_build_draw_list(App *app, DrawList *drawList, VkExtent2D extent) {
+  if(app->meshPipeline == VK_NULL_HANDLE) {
+    DrawCommand *command = draw_list_push(drawList);
+    command->pipeline = app->graphicsPipeline;
+    command->layout = app->pipelineLayout;
+    command->count = 3;
+    command->instanceCount = globalConfig.instances;
+
+    app_private_main_loop_draw_frame_repeat_draw(drawList);
+    return;
+  }
+
+  float center[3], radius = 0.0f;
+  for(int i = 0; i < 3; i++) {
+    center[i] = (app->mesh.boundsMin[i] + app->mesh.boundsMax[i]) * 0.5f;
+    float halfExtent = (app->mesh.boundsMax[i] - app->mesh.boundsMin[i]) * 0.5f;
+    radius += halfExtent * halfExtent;
+  }
+  radius = radius > 0.0f ? sqrt(radius) : 1.0f;
+
+  float angle = (float)app->animationTime * 0.5f;
+  float distance = radius * 2.5f;
+  float eye[3] = {
+    center[0] + sin(angle) * distance,
+    center[1] + distance * 0.3f,
+    center[2] + cos(angle) * distance
+  };
+  float up[3] = {0.0f, 1.0f, 0.0f};
+
+  float aspect = (float)extent.width / (float)extent.height;
+  Mat4 projection = mat4_perspective(0.785398f, aspect, distance - radius * 1.5f > 0.01f ? distance - radius * 1.5f : 0.01f, distance + radius * 1.5f);
+  projection.m[5] *= -1.0f;
+
+  DrawCommand *command = draw_list_push(drawList);
+  command->kind = DRAW_COMMAND_MESHLETS;
+  command->pipeline = app->meshPipeline;
+  command->layout = app->meshPipelineLayout;
+  command->vertexBuffer = app->mesh.vertexBuffer;
+  command->indexBuffer = app->mesh.indexBuffer;
+  command->count = app->mesh.indexCount;
+  command->instanceCount = globalConfig.instances;
+  command->hasPushConstants = true;
+  command->pushConstants.viewProjection = mat4_multiply(projection, mat4_look_at(eye, center, up));
+  for(int i = 0; i < 3; i++) {
+    command->pushConstants.cameraPosition[i] = eye[i];
+  }
+  command->pushConstants.cameraPosition[3] = 1.0f;
+
+  app_private_main_loop_draw_frame_repeat_draw(drawList);
+}
+
+// --draws, the copies are identical so only the per draw cost grows
+void app_private_main_loop_draw_frame_repeat_draw(DrawList *drawList) {
+  for(uint32_t i = 1; i < globalConfig.draws; i++) {
+    DrawCommand *command = draw_list_push(drawList);
+    *command = drawList->commands[0];
+  }
+}
+
+// the upload batch goes into the frame's batcher ahead of the segments, which
+// the main thread only adds once every frame job finished
+void app_private_frame_job_update_textures(void *data) {
+  App *app = data;
+  texture_streamer_update(&app->textureStreamer, &app->submitBatcher);
+}
+
+void app_private_frame_job_build_draw_list(void *data) {
+  FrameJob *job = data;
+  App *app = job->app;
+  app_private_main_loop_draw_frame_build_draw_list(app, &job->drawLists[job->index], app->outputs[job->index].swapChainExtent);
+}
+
+void app_private_frame_job_capture(void *data) {
+  FrameJob *job = data;
+  App *app = job->app;
+  trace_recorder_write_frame(&app->traceRecorder, &app->traceHandles, &job->drawLists[0], app->outputs[0].swapChainExtent, app->framePacer.presentMode, app->outputs[0].imageIndex);
+}
+
+// segments only share read only state, each has its own command pool
+void app_private_frame_job_record(void *data) {
+  FrameJob *job = data;
+  App *app = job->app;
+  bool compute = app->frameGraph.segments[job->index].queue == FRAME_GRAPH_QUEUE_COMPUTE;
+  VkCommandBuffer commandBuffer = compute ? app->computeCommandBuffers[app->currentFrame][job->index] : app->commandBuffers[app->currentFrame][job->index];
+
+  vkResetCommandBuffer(commandBuffer, 0);
+  app_private_main_loop_draw_frame_record_command_buffer(app, commandBuffer, job->drawLists, job->index);
+}
+
+// each output and chunk has its own pool, so the chunks record side by side
+void app_private_frame_job_record_draws(void *data) {
+  FrameJob *job = data;
+  App *app = job->app;
+  DrawList *drawList = &job->drawLists[job->index];
+  if(job->chunk * DRAW_LIST_CHUNK_COMMANDS >= drawList->count)
+    return;
+
+  VkCommandBuffer commandBuffer = app->drawCommandBuffers[app->currentFrame][job->index][job->chunk];
+  vkResetCommandBuffer(commandBuffer, 0);
+
+  // any framebuffer of the render pass, the scene target or a swap chain image
+  VkCommandBufferInheritanceInfo inheritanceInfo = {};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritanceInfo.renderPass = app->renderPass;
+  inheritanceInfo.subpass = 0;
+  inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+
+  VkCommandBufferBeginInfo beginInfo = {};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+  if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    printf("failed to begin recording draw command buffer\n");
+    exit(1);
+  }
+
+  app_private_frame_graph_main_pass_record_draws(app, commandBuffer, drawList, job->index, job->chunk);
+
+  if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    printf("failed to record draw command buffer\n");
+    exit(1);
+  }
+}
+
+void app_private_cleanup(App* app) {
+  if(!app->headless) {
+    pthread_mutex_lock(&app->wakeMutex);
+    app->wakeRunning = false;
+    pthread_mutex_unlock(&app->wakeMutex);
+
+    app_wake(app);
+    pthread_join(app->wakeThread, NULL);
+    pthread_mutex_destroy(&app->wakeMutex);
+    close(app->wakeFd);
+  }
+
+  job_system_destroy(&app->jobSystem);
+  if(app->textureStreaming)
+    texture_streamer_destroy(&app->textureStreamer);
+
+  if(app->mesh.loaded) {
+    memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_BUFFER);
+    vkDestroyBuffer(app->device, app->mesh.vertexBuffer, NULL);
+    memory_tracker_free(&globalMemoryTracker, app->device, app->mesh.vertexMemory);
+    memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_BUFFER);
+    vkDestroyBuffer(app->device, app->mesh.indexBuffer, NULL);
+    memory_tracker_free(&globalMemoryTracker, app->device, app->mesh.indexMemory);
+
+    VkBuffer meshletBuffers[] = {app->mesh.meshletBuffer, app->mesh.meshletVertexBuffer, app->mesh.meshletTriangleBuffer};
+    VkDeviceMemory meshletMemories[] = {app->mesh.meshletMemory, app->mesh.meshletVertexMemory, app->mesh.meshletTriangleMemory};
+    for(int i = 0; i < 3; i++) {
+      memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_BUFFER);
+      vkDestroyBuffer(app->device, meshletBuffers[i], NULL);
+      memory_tracker_free(&globalMemoryTracker, app->device, meshletMemories[i]);
+    }
+  }
+  if(app->meshlets.path != MESHLET_PATH_NONE) {
+    MeshletRenderer *meshlets = &app->meshlets;
+    memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_PIPELINE);
+    vkDestroyPipeline(app->device, meshlets->pipeline, NULL);
+    vkDestroyPipelineLayout(app->device, meshlets->pipelineLayout, NULL);
+    vkDestroyDescriptorPool(app->device, meshlets->descriptorPool, NULL);
+    vkDestroyDescriptorSetLayout(app->device, meshlets->setLayout, NULL);
+
+    vkUnmapMemory(app->device, meshlets->statsMemory);
+    memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_BUFFER);
+    vkDestroyBuffer(app->device, meshlets->statsBuffer, NULL);
+    memory_tracker_free(&globalMemoryTracker, app->device, meshlets->statsMemory);
+
+    if(meshlets->path == MESHLET_PATH_COMPUTE) {
+      memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_BUFFER);
+      vkDestroyBuffer(app->device, meshlets->drawBuffer, NULL);
+      memory_tracker_free(&globalMemoryTracker, app->device, meshlets->drawMemory);
+    }
+
+    if(meshlets->occlusion)
+      app_private_cleanup_meshlet_occlusion(app);
+  }
+  if(app->meshPipeline != VK_NULL_HANDLE) {
+    memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_PIPELINE);
+    vkDestroyPipeline(app->device, app->meshPipeline, NULL);
+    vkDestroyPipelineLayout(app->device, app->meshPipelineLayout, NULL);
+    app_private_cleanup_mesh_texture(app);
+  }
+
+  for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    vkDestroyFence(app->device, app->inFlightFences[i], NULL);
+
+    for(int j = 0; j < app->outputsCount; j++) {
+      vkDestroySemaphore(app->device, app->outputs[j].imageAvailableSemaphores[i], NULL);
+    }
+
+    for(int j = 0; j < FRAME_GRAPH_MAX_SEGMENTS; j++) {
+      vkDestroySemaphore(app->device, app->segmentSemaphores[i][j], NULL);
+    }
+  }
+
+  for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for(int j = 0; j < FRAME_GRAPH_MAX_SEGMENTS; j++) {
+      if(app->computeSegmentCommandPools[i][j] != app->segmentCommandPools[i][j])
+        vkDestroyCommandPool(app->device, app->computeSegmentCommandPools[i][j], NULL);
+      vkDestroyCommandPool(app->device, app->segmentCommandPools[i][j], NULL);
+    }
+
+    for(int j = 0; j < app->outputsCount; j++) {
+      for(int k = 0; k < DRAW_LIST_MAX_CHUNKS; k++) {
+        vkDestroyCommandPool(app->device, app->drawCommandPools[i][j][k], NULL);
+      }
+    }
+  }
+  vkDestroyCommandPool(app->device, app->commandPool, NULL);
+
+  app_private_cleanup_frame_graph(app);
+  for(int i = 0; i < app->outputsCount; i++) {
+    app_private_cleanup_swap_chain(app, &app->outputs[i]);
+  }
+
+  if(app->postProcess.enabled) {
+    for(int i = 0; i < POST_PASS_COUNT; i++) {
+      memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_PIPELINE);
+      vkDestroyPipeline(app->device, app->postProcess.pipelines[i], NULL);
+    }
+    vkDestroyPipelineLayout(app->device, app->postProcess.pipelineLayout, NULL);
+    vkDestroyDescriptorPool(app->device, app->postProcess.descriptorPool, NULL);
+    vkDestroyDescriptorSetLayout(app->device, app->postProcess.setLayout, NULL);
+  }
+
+  memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_PIPELINE);
+  vkDestroyPipeline(app->device, app->graphicsPipeline, NULL);
+  vkDestroyPipelineLayout(app->device, app->pipelineLayout, NULL);
+  vkDestroyRenderPass(app->device, app->lateRenderPass, NULL);
+  vkDestroyRenderPass(app->device, app->renderPass, NULL);
+
+  memory_tracker_destroy(&globalMemoryTracker);
+  vkDestroyDevice(app->device, NULL);
+  for(int i = 0; i < app->outputsCount && !app->headless; i++) {
+    vkDestroySurfaceKHR(app->instance, app->outputs[i].surface, NULL);
+  }
+
+  if(globalConfig.validation != VALIDATION_MODE_OFF) {
+    PFN_vkDestroyDebugUtilsMessengerEXT func = (PFN_vkDestroyDebugUtilsMessengerEXT)
+      vkGetInstanceProcAddr(app->instance, "vkDestroyDebugUtilsMessengerEXT");
+
+    if(func != NULL)
+      func(app->instance, app->debugMessenger, NULL);
+    else {
+      printf("failed to load messenger destroy function\n");
+      exit(1);
+    }
+  }
+
+  vkDestroyInstance(app->instance, NULL);
+
+  if(globalConfig.validation != VALIDATION_MODE_OFF)
+    debug_logger_destroy(&globalDebugLogger);
+
+  if(!app->headless) {
+    for(int i = 0; i < app->outputsCount; i++) {
+      glfwDestroyWindow(app->outputs[i].window);
+    }
+    glfwTerminate();
+  }
+
+  for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    arena_destroy(&app->frameArenas[i]);
+  }
+  arena_destroy(&app->scratchArena);
+
+  for(int i = 0; i < app->outputsCount; i++) {
+    arena_destroy(&app->outputs[i].supportArena);
+    arena_destroy(&app->outputs[i].swapChainArena);
+  }
+
+  for(int i = 0; i < app->deviceCapabilitiesCount; i++) {
+    device_capabilities_destroy(&app->deviceCapabilities[i]);
+  }
+}
+
+
+
+QueueFamilyIndices queue_families_find(const DeviceCapabilities *capabilities) {
+  QueueFamilyIndices indices;
+  indices.isComplete = false;
+
+  const VkQueueFamilyProperties *queueFamilies = capabilities->queueFamilies;
+
+  for(int i = 0; i < capabilities->queueFamiliesCount; i++) {
+    uint8_t conditionsMet = 0;
+
+    if(capabilities->queueFamiliesPresentSupport[i]) {
+      indices.presentFamily = i;
+      conditionsMet++;
+    }
+
+    if(queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+      indices.graphicsFamily = i;
+      conditionsMet++;
+    }
+
+    if(conditionsMet >= globalQueueFamilyIndicesFieldCount) {
+      indices.isComplete = true;
+      break;
+    }
+  }
+
+  if(indices.isComplete) {
+    indices.transferFamily = indices.graphicsFamily;
+    indices.computeFamily = indices.graphicsFamily;
+
+    for(int i = 0; i < capabilities->queueFamiliesCount; i++) {
+      if((queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+        indices.computeFamily = i;
+        break;
+      }
+    }
+
+    for(int i = 0; i < capabilities->queueFamiliesCount; i++) {
+      if((queueFamilies[i].queueFlags & VK_QUEUE_TRANSFER_BIT)
+         && !(queueFamilies[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+      ){
+        indices.transferFamily = i;
+        break;
+      }
+    }
+  }
+
+  return indices;
+}
+
+
+
+SwapChainSupportDetails swap_chain_support_details_query(VkPhysicalDevice device, VkSurfaceKHR surface, Arena *arena) {
+  SwapChainSupportDetails details;
+
+  vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
+
+  vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &details.formatsCount, NULL);
+
+  if(details.formatsCount != 0) {
+    details.formats = ARENA_ALLOC_ARRAY(arena, VkSurfaceFormatKHR, details.formatsCount);
+    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &details.formatsCount, details.formats);
+  }
+
+  vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &details.presentModesCount, NULL);
+
+  if(details.presentModesCount != 0) {
+    details.presentModes = ARENA_ALLOC_ARRAY(arena, VkPresentModeKHR, details.presentModesCount);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &details.presentModesCount, details.presentModes);
+  }
+
+  return details;
+}
+
+
+
+void device_capabilities_query(DeviceCapabilities *capabilities, VkPhysicalDevice device, VkSurfaceKHR surface) {
+  arena_init(&capabilities->arena, DEVICE_CAPABILITIES_ARENA_SIZE);
+  capabilities->physicalDevice = device;
+
+  vkGetPhysicalDeviceProperties(device, &capabilities->properties);
+  vkGetPhysicalDeviceFeatures(device, &capabilities->features);
+  vkGetPhysicalDeviceMemoryProperties(device, &capabilities->memoryProperties);
+
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &capabilities->queueFamiliesCount, NULL);
+  capabilities->queueFamilies = ARENA_ALLOC_ARRAY(&capabilities->arena, VkQueueFamilyProperties, capabilities->queueFamiliesCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &capabilities->queueFamiliesCount, capabilities->queueFamilies);
+
+  vkEnumerateDeviceExtensionProperties(device, NULL, &capabilities->extensionsCount, NULL);
+  capabilities->extensions = ARENA_ALLOC_ARRAY(&capabilities->arena, VkExtensionProperties, capabilities->extensionsCount);
+  vkEnumerateDeviceExtensionProperties(device, NULL, &capabilities->extensionsCount, capabilities->extensions);
+
+  capabilities->surfaceMark = arena_mark(&capabilities->arena);
+  device_capabilities_refresh_surface(capabilities, surface);
+}
+
+void device_capabilities_refresh_surface(DeviceCapabilities *capabilities, VkSurfaceKHR surface) {
+  arena_pop_to(&capabilities->arena, capabilities->surfaceMark);
+  capabilities->surface = surface;
+
+  capabilities->queueFamiliesPresentSupport = ARENA_ALLOC_ARRAY(&capabilities->arena, VkBool32, capabilities->queueFamiliesCount);
+
+  // headless, nothing presents so any family qualifies and the present
+  // family collapses onto the graphics one
+  for(int i = 0; i < capabilities->queueFamiliesCount; i++) {
+    capabilities->queueFamiliesPresentSupport[i] = surface == VK_NULL_HANDLE;
+    if(surface != VK_NULL_HANDLE)
+      vkGetPhysicalDeviceSurfaceSupportKHR(capabilities->physicalDevice, i, surface, &capabilities->queueFamiliesPresentSupport[i]);
+  }
+
+  capabilities->queueFamilyIndices = queue_families_find(capabilities);
+
+  if(surface != VK_NULL_HANDLE)
+    capabilities->swapChainSupport = swap_chain_support_details_query(capabilities->physicalDevice, surface, &capabilities->arena);
+  else
+    memset(&capabilities->swapChainSupport, 0, sizeof(SwapChainSupportDetails));
+}
+
+bool device_capabilities_has_extension(const DeviceCapabilities *capabilities, const char *name) {
+  for(int i = 0; i < capabilities->extensionsCount; i++) {
+    if(strcmp(name, capabilities->extensions[i].extensionName) == 0)
+      return true;
+  }
+  return false;
+}
+
+void device_capabilities_destroy(DeviceCapabilities *capabilities) {
+  arena_destroy(&capabilities->arena);
+}
+
+
+
+void frame_pacer_init(FramePacer *pacer, PresentPolicy policy, uint32_t frameCap) {
+  memset(pacer, 0, sizeof(FramePacer));
+  pacer->policy = policy;
+  pacer->frameCap = frameCap;
+  pacer->lastReportTime = helper_time_ns();
+}
+
+void frame_pacer_swap_chain_recreated(FramePacer *pacer, VkPresentModeKHR presentMode, uint32_t imageCount) {
+  pacer->presentMode = presentMode;
+  pacer->imageCount = imageCount;
+  pacer->presentId = 0;
+  pacer->pendingLatencyPresentId = 0;
+
+  printf("present mode %s, %u images, present wait %s\n",
+    present_mode_name(presentMode), imageCount, pacer->presentWaitEnabled ? "on" : "off");
+}
+
+void frame_pacer_wait(FramePacer *pacer, VkDevice device, VkSwapchainKHR swapChain) {
+  if(pacer->policy == PRESENT_POLICY_POWER_SAVING && pacer->frameCap > 0)
+    helper_sleep_until_ns(pacer->frameStartTime + 1000000000ull / pacer->frameCap);
+
+  // low latency: do not start sampling input for a new frame while an older
+  // one is still queued, so input is never more than one present old
+  if(pacer->presentWaitEnabled && pacer->presentId > 0 && pacer->policy == PRESENT_POLICY_LOW_LATENCY)
+    pacer->waitForPresent(device, swapChain, pacer->presentId, FRAME_PACER_WAIT_TIMEOUT_NS);
+
+  // the measured present is the one just waited for, or one that completed
+  // earlier, so this is an upper bound when the CPU is the bottleneck
+  if(pacer->pendingLatencyPresentId != 0 && pacer->presentWaitEnabled) {
+    if(pacer->waitForPresent(device, swapChain, pacer->pendingLatencyPresentId, 0) == VK_SUCCESS) {
+      double latencyMs = (helper_time_ns() - pacer->inputTimes[pacer->pendingLatencyPresentId % FRAME_PACER_HISTORY]) / 1e6;
+      pacer->latencySumMs += latencyMs;
+      pacer->latencyMaxMs = fmax(pacer->latencyMaxMs, latencyMs);
+      pacer->latencySamples++;
+      pacer->pendingLatencyPresentId = 0;
+    }
+  }
+
+  uint64_t now = helper_time_ns();
+  pacer->frameStartTime = now;
+
+  if(now - pacer->lastReportTime >= FRAME_PACER_REPORT_INTERVAL_NS) {
+    if(pacer->latencySamples > 0) {
+      printf("input-to-%s latency: avg %.2f ms, max %.2f ms over %u frames (%s)\n",
+        pacer->presentWaitEnabled ? "present" : "queue-present",
+        pacer->latencySumMs / pacer->latencySamples, pacer->latencyMaxMs, pacer->latencySamples,
+        present_mode_name(pacer->presentMode));
+    }
+    pacer->lastReportTime = now;
+    pacer->latencySamples = 0;
+    pacer->latencySumMs = 0.0;
+    pacer->latencyMaxMs = 0.0;
+  }
+}
+
+void frame_pacer_sample_input(FramePacer *pacer) {
+  pacer->inputTimes[(pacer->presentId + 1) % FRAME_PACER_HISTORY] = helper_time_ns();
+}
+
+uint64_t frame_pacer_next_present_id(FramePacer *pacer) {
+  return pacer->presentId + 1;
+}
+
+void frame_pacer_presented(FramePacer *pacer) {
+  pacer->presentId++;
+
+  // without present wait, the best we can see is vkQueuePresentKHR returning
+  if(!pacer->presentWaitEnabled) {
+    double latencyMs = (helper_time_ns() - pacer->inputTimes[pacer->presentId % FRAME_PACER_HISTORY]) / 1e6;
+    pacer->latencySumMs += latencyMs;
+    pacer->latencyMaxMs = fmax(pacer->latencyMaxMs, latencyMs);
+    pacer->latencySamples++;
+  }
+  else if(pacer->pendingLatencyPresentId == 0)
+    pacer->pendingLatencyPresentId = pacer->presentId;
+}
+
+const char *present_mode_name(VkPresentModeKHR presentMode) {
+  switch(presentMode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR: return "IMMEDIATE";
+    case VK_PRESENT_MODE_MAILBOX_KHR: return "MAILBOX";
+    case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO_RELAXED";
+    default: return "UNKNOWN";
+  }
+}
+
+
+
+void resolution_controller_init(ResolutionController *controller, double targetMs, double minScale) {
+  memset(controller, 0, sizeof(ResolutionController));
+  controller->enabled = targetMs > 0.0;
+  controller->targetMs = targetMs;
+  controller->minScale = fmin(fmax(minScale, 0.1), 1.0);
+  controller->scale = 1.0;
+  for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    controller->frameScales[i] = 1.0;
+  }
+}
+
+// frameIndex is the frame about to be recorded, its slot still holds the
+// scale of the frame gpuTimeMs was measured on
+void resolution_controller_update(ResolutionController *controller, uint32_t frameIndex, double gpuTimeMs) {
+  if(!controller->enabled)
+    return;
+
+  if(gpuTimeMs > 0.0) {
+    double ratio = controller->targetMs / gpuTimeMs;
+
+    if(fabs(ratio - 1.0) > RESOLUTION_DEADBAND) {
+      // gpu time follows the pixel count, so the square of the scale
+      double wanted = fmin(fmax(controller->frameScales[frameIndex] * sqrt(ratio), controller->minScale), 1.0);
+      double gain = wanted < controller->scale ? RESOLUTION_GAIN_DOWN : RESOLUTION_GAIN_UP;
+      controller->scale += (wanted - controller->scale) * gain;
+    }
+
+    controller->gpuTimeSumMs += gpuTimeMs;
+    controller->timedFrames++;
+  }
+
+  controller->frameScales[frameIndex] = controller->scale;
+  controller->scaleSum += controller->scale;
+
+  if(++controller->framesSinceReport < RESOLUTION_REPORT_FRAMES)
+    return;
+
+  if(controller->timedFrames > 0)
+    printf("dynamic resolution: %.0f%% average scale, %.2f ms average gpu time for a %.2f ms target\n",
+      100.0 * controller->scaleSum / controller->framesSinceReport, controller->gpuTimeSumMs / controller->timedFrames, controller->targetMs);
+
+  controller->framesSinceReport = 0;
+  controller->timedFrames = 0;
+  controller->scaleSum = 0.0;
+  controller->gpuTimeSumMs = 0.0;
+}
+
+VkExtent2D resolution_controller_extent(const ResolutionController *controller, VkExtent2D extent) {
+  VkExtent2D scaled = {
+    (uint32_t)(extent.width * controller->scale + 0.5),
+    (uint32_t)(extent.height * controller->scale + 0.5)
+  };
+  scaled.width = scaled.width < 1 ? 1 : scaled.width > extent.width ? extent.width : scaled.width;
+  scaled.height = scaled.height < 1 ? 1 : scaled.height > extent.height ? extent.height : scaled.height;
+  return scaled;
+}
+
+
+
+void arena_init(Arena *arena, size_t capacity) {
+  arena->base = malloc(capacity);
+  CHECK_ALLOC_FOR_NULL(arena->base);
+  arena->capacity = capacity;
+  arena->offset = 0;
+}
+
+void *arena_alloc(Arena *arena, size_t size, size_t alignment) {
+  size_t offset = (arena->offset + alignment - 1) & ~(alignment - 1);
+
+  if(offset + size > arena->capacity) {
+    printf("arena exhausted (%zu of %zu bytes)\n", offset + size, arena->capacity);
+    exit(1);
+  }
+
+  arena->offset = offset + size;
+  return arena->base + offset;
+}
+
+size_t arena_mark(Arena *arena) {
+  return arena->offset;
+}
+
+void arena_pop_to(Arena *arena, size_t mark) {
+  arena->offset = mark;
+}
+
+void arena_reset(Arena *arena) {
+  arena->offset = 0;
+}
+
+void arena_destroy(Arena *arena) {
+  free(arena->base);
+  arena->base = NULL;
+  arena->capacity = 0;
+  arena->offset = 0;
+}
+
+
+
+void draw_list_init(DrawList *drawList, Arena *arena, uint32_t capacity) {
+  drawList->commands = ARENA_ALLOC_ARRAY(arena, DrawCommand, capacity);
+  drawList->count = 0;
+  drawList->capacity = capacity;
+}
+
+DrawCommand *draw_list_push(DrawList *drawList) {
+  if(drawList->count >= drawList->capacity) {
+    printf("draw list full\n");
+    exit(1);
+  }
+
+  DrawCommand *command = &drawList->commands[drawList->count++];
+  memset(command, 0, sizeof(DrawCommand));
+  command->instanceCount = 1;
+  return command;
+}
+
+
+
+const FrameGraphAccessInfo globalFrameGraphAccessInfos[FRAME_GRAPH_ACCESS_COUNT] = {
+  [FRAME_GRAPH_ACCESS_COLOR_ATTACHMENT_WRITE] = {
+    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true},
+  [FRAME_GRAPH_ACCESS_DEPTH_ATTACHMENT_WRITE] = {
+    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+    VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true},
+  [FRAME_GRAPH_ACCESS_DEPTH_ATTACHMENT_READ] = {
+    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+    VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, false},
+  [FRAME_GRAPH_ACCESS_FRAGMENT_SAMPLED_READ] = {
+    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false},
+  [FRAME_GRAPH_ACCESS_COMPUTE_SAMPLED_READ] = {
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false},
+  [FRAME_GRAPH_ACCESS_TASK_SAMPLED_READ] = {
+    VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT, VK_ACCESS_SHADER_READ_BIT,
+    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false},
+  [FRAME_GRAPH_ACCESS_COMPUTE_STORAGE_READ] = {
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+    VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false},
+  [FRAME_GRAPH_ACCESS_COMPUTE_STORAGE_WRITE] = {
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+    VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, true},
+  [FRAME_GRAPH_ACCESS_TRANSFER_READ] = {
+    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false},
+  [FRAME_GRAPH_ACCESS_TRANSFER_WRITE] = {
+    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, true},
+  [FRAME_GRAPH_ACCESS_PRESENT] = {
+    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+    VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0, false},
+};
+
+void frame_graph_init(FrameGraph *graph, VkDevice device, const VkPhysicalDeviceMemoryProperties *memoryProperties) {
+  memset(graph, 0, sizeof(FrameGraph));
+  graph->device = device;
+  graph->memoryProperties = memoryProperties;
+}
+
+void frame_graph_set_queue_families(FrameGraph *graph, uint32_t graphicsFamily, uint32_t computeFamily) {
+  graph->queueFamilies[FRAME_GRAPH_QUEUE_GRAPHICS] = graphicsFamily;
+  graph->queueFamilies[FRAME_GRAPH_QUEUE_COMPUTE] = computeFamily;
+}
+
+void frame_graph_enable_timestamps(FrameGraph *graph, float timestampPeriod, bool graphicsTimestamps, bool computeTimestamps) {
+  graph->timestampPeriod = timestampPeriod;
+  graph->timestampsEnabled[FRAME_GRAPH_QUEUE_GRAPHICS] = graphicsTimestamps;
+  graph->timestampsEnabled[FRAME_GRAPH_QUEUE_COMPUTE] = computeTimestamps;
+
+  VkQueryPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  poolInfo.queryCount = FRAME_GRAPH_MAX_PASSES * 2;
+
+  for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    if(vkCreateQueryPool(graph->device, &poolInfo, NULL, &graph->queryPools[i]) != VK_SUCCESS) {
+      printf("frame graph: failed to create timestamp query pool\n");
+      exit(1);
+    }
+    graph->queryPoolsWritten[i] = false;
+  }
+}
+
+uint32_t frame_graph_import_image(FrameGraph *graph, const char *name, VkFormat format, VkExtent2D extent, VkImageAspectFlags aspect, VkImageLayout initialLayout, VkPipelineStageFlags initialStages, VkImageLayout finalLayout) {
+  if(graph->resourcesCount >= FRAME_GRAPH_MAX_RESOURCES) {
+    printf("frame graph: too many resources\n");
+    exit(1);
+  }
+
+  FrameGraphResource *resource = &graph->resources[graph->resourcesCount];
+  memset(resource, 0, sizeof(FrameGraphResource));
+  resource->name = name;
+  resource->imported = true;
+  resource->format = format;
+  resource->extent = extent;
+  resource->aspect = aspect;
+  resource->mipLevels = 1;
+  resource->initialLayout = initialLayout;
+  resource->initialStages = initialStages;
+  resource->finalLayout = finalLayout;
+
+  return graph->resourcesCount++;
+}
+
+uint32_t frame_graph_create_image(FrameGraph *graph, const char *name, VkFormat format, VkExtent2D extent, VkImageAspectFlags aspect) {
+  uint32_t index = frame_graph_import_image(graph, name, format, extent, aspect, VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_IMAGE_LAYOUT_UNDEFINED);
+  graph->resources[index].imported = false;
+  return index;
+}
+
+uint32_t frame_graph_add_pass(FrameGraph *graph, const char *name, FrameGraphPassExecute execute, void *passData) {
+  if(graph->passesCount >= FRAME_GRAPH_MAX_PASSES) {
+    printf("frame graph: too many passes\n");
+    exit(1);
+  }
+
+  FrameGraphPass *pass = &graph->passes[graph->passesCount];
+  memset(pass, 0, sizeof(FrameGraphPass));
+  pass->name = name;
+  pass->execute = execute;
+  pass->passData = passData;
+  pass->queue = FRAME_GRAPH_QUEUE_GRAPHICS;
+
+  return graph->passesCount++;
+}
+
+void frame_graph_pass_set_queue(FrameGraph *graph, uint32_t pass, FrameGraphQueue queue) {
+  graph->passes[pass].queue = queue;
+}
+
+void frame_graph_pass_set_side_effects(FrameGraph *graph, uint32_t pass) {
+  graph->passes[pass].sideEffects = true;
+}
+
+// the view frame_graph_get_view hands out spans every level, views of
+// single levels are up to the caller
+void frame_graph_set_mip_levels(FrameGraph *graph, uint32_t resource, uint32_t mipLevels) {
+  graph->resources[resource].mipLevels = mipLevels;
+}
+
+void frame_graph_pass_use(FrameGraph *graph, uint32_t pass, uint32_t resource, FrameGraphAccess access) {
+  FrameGraphPass *p = &graph->passes[pass];
+
+  if(p->accessesCount >= FRAME_GRAPH_MAX_PASS_ACCESSES) {
+    printf("frame graph: too many accesses in pass %s\n", p->name);
+    exit(1);
+  }
+
+  p->accesses[p->accessesCount].resource = resource;
+  p->accesses[p->accessesCount].access = access;
+  p->accessesCount++;
+
+  graph->resources[resource].usage |= globalFrameGraphAccessInfos[access].usage;
+}
+
+void frame_graph_compile(FrameGraph *graph) {
+  frame_graph_private_cull(graph);
+  frame_graph_private_build_segments(graph);
+  frame_graph_private_allocate_transients(graph);
+  frame_graph_private_build_barriers(graph);
+
+  graph->stats.passesCount = graph->passesCount;
+
+  printf("frame graph: %u passes (%u culled) in %u queue segments, %u barriers in %u batches, transient memory %.2f MiB (%.2f MiB without aliasing)\n",
+    graph->stats.passesCount, graph->stats.culledPassesCount, graph->segmentsCount,
+    graph->stats.barriersCount, graph->stats.barrierBatchesCount,
+    graph->stats.transientMemorySize / (1024.0 * 1024.0), graph->stats.transientMemorySizeUnaliased / (1024.0 * 1024.0));
+}
+
+// a null image marks the resource absent for this frame: passes touching it
+// are skipped and its barriers dropped, everything else runs as compiled
+void frame_graph_set_imported_image(FrameGraph *graph, uint32_t resource, VkImage image, VkImageView view) {
+  graph->resources[resource].image = image;
+  graph->resources[resource].view = view;
+}
+
+VkImageView frame_graph_get_view(FrameGraph *graph, uint32_t resource) {
+  return graph->resources[resource].view;
+}
+
+VkExtent2D frame_graph_get_extent(FrameGraph *graph, uint32_t resource) {
+  return graph->resources[resource].extent;
+}
+
+VkImage frame_graph_get_image(FrameGraph *graph, uint32_t resource) {
+  return graph->resources[resource].image;
+}
+
+uint32_t frame_graph_first_use(FrameGraph *graph, uint32_t resource, VkPipelineStageFlags *stages) {
+  uint32_t firstPass = graph->resources[resource].firstPass;
+  *stages = graph->resources[resource].initialStages;
+
+  for(int i = 0; i < graph->segmentsCount; i++) {
+    if(firstPass >= graph->segments[i].firstPass && firstPass <= graph->segments[i].lastPass)
+      return i;
+  }
+  return 0;
+}
+
+void frame_graph_begin_frame(FrameGraph *graph, uint32_t frameIndex) {
+  graph->stats.gpuFrameTimeMs = 0.0;
+  if(!graph->queryPoolsWritten[frameIndex])
+    return;
+
+  // the frame's fence has signalled, so written queries are ready without
+  // waiting. culled passes and queues without timestamps never write theirs,
+  // which makes the whole read VK_NOT_READY, so every query comes back as a
+  // value and availability pair and only the available ones are used
+  uint64_t timestamps[FRAME_GRAPH_MAX_PASSES * 2][2];
+  VkResult result = vkGetQueryPoolResults(graph->device, graph->queryPools[frameIndex], 0, graph->passesCount * 2,
+    sizeof(timestamps), timestamps, sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+  if(result == VK_SUCCESS || result == VK_NOT_READY) {
+    for(int i = 0; i < graph->passesCount; i++) {
+      uint64_t *begin = timestamps[i * 2];
+      uint64_t *end = timestamps[i * 2 + 1];
+      if(begin[1] == 0 || end[1] == 0)
+        continue;
+
+      double ms = (double)(end[0] - begin[0]) * graph->timestampPeriod / 1e6;
+      graph->stats.passGpuTimesMs[i] = graph->stats.passGpuTimesMs[i] * 0.95 + ms * 0.05;
+      graph->stats.gpuFrameTimeMs += ms;
+    }
+  }
+
+  if(++graph->framesSinceReport >= FRAME_GRAPH_TIMING_REPORT_FRAMES) {
+    char line[512];
+    int length = snprintf(line, sizeof(line), "gpu pass times:");
+
+    for(int i = 0; i < graph->passesCount && length < (int)sizeof(line); i++) {
+      FrameGraphPass *pass = &graph->passes[i];
+      if(pass->culled || !graph->timestampsEnabled[pass->queue])
+        continue;
+      length += snprintf(line + length, sizeof(line) - length, " %s%s %.3f ms", pass->name,
+        pass->queue == FRAME_GRAPH_QUEUE_COMPUTE ? " (compute)" : "", graph->stats.passGpuTimesMs[i]);
+    }
+
+    printf("%s\n", line);
+    graph->framesSinceReport = 0;
+  }
+}
+
+void frame_graph_execute_segment(FrameGraph *graph, uint32_t segment, VkCommandBuffer commandBuffer, uint32_t frameIndex, void *frameData) {
+  FrameGraphSegment *s = &graph->segments[segment];
+  VkQueryPool queryPool = graph->queryPools[frameIndex];
+  bool timestamps = queryPool != VK_NULL_HANDLE && graph->timestampsEnabled[s->queue];
+
+  // every query of the frame is reset up front by the first segment, later
+  // segments only run after it through the semaphore chain
+  if(segment == 0 && queryPool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(commandBuffer, queryPool, 0, graph->passesCount * 2);
+    graph->queryPoolsWritten[frameIndex] = true;
+  }
+
+  for(uint32_t i = s->firstPass; i <= s->lastPass; i++) {
+    FrameGraphPass *pass = &graph->passes[i];
+    if(pass->culled)
+      continue;
+
+    if(timestamps)
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, i * 2);
+
+    frame_graph_private_record_barriers(graph, commandBuffer, &pass->before);
+    if(!frame_graph_private_pass_absent(graph, pass))
+      pass->execute(commandBuffer, pass->passData, frameData);
+
+    if(timestamps)
+      vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, i * 2 + 1);
+  }
+
+  if(segment == graph->segmentsCount - 1)
+    frame_graph_private_record_barriers(graph, commandBuffer, &graph->after);
+}
+
+void frame_graph_destroy(FrameGraph *graph) {
+  for(int i = 0; i < graph->resourcesCount; i++) {
+    FrameGraphResource *resource = &graph->resources[i];
+    if(resource->imported || !resource->used)
+      continue;
+
+    memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_IMAGE_VIEW);
+    vkDestroyImageView(graph->device, resource->view, NULL);
+    memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_IMAGE);
+    vkDestroyImage(graph->device, resource->image, NULL);
+  }
+
+  if(graph->transientMemory != VK_NULL_HANDLE)
+    memory_tracker_free(&globalMemoryTracker, graph->device, graph->transientMemory);
+
+  for(int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    if(graph->queryPools[i] != VK_NULL_HANDLE)
+      vkDestroyQueryPool(graph->device, graph->queryPools[i], NULL);
+    graph->queryPools[i] = VK_NULL_HANDLE;
+  }
+
+  graph->transientMemory = VK_NULL_HANDLE;
+  graph->resourcesCount = 0;
+  graph->passesCount = 0;
+}
+
+void frame_graph_private_cull(FrameGraph *graph) {
+  // walk backwards: a pass survives if it writes an imported image,
+  // something a surviving later pass reads or something outside the graph
+  bool needed[FRAME_GRAPH_MAX_RESOURCES] = {false};
+
+  for(int i = 0; i < graph->resourcesCount; i++) {
+    needed[i] = graph->resources[i].imported;
+  }
+
+  graph->stats.culledPassesCount = 0;
+
+  for(int i = (int)graph->passesCount - 1; i >= 0; i--) {
+    FrameGraphPass *pass = &graph->passes[i];
+    pass->culled = !pass->sideEffects;
+
+    for(int j = 0; j < pass->accessesCount; j++) {
+      FrameGraphResourceAccess *access = &pass->accesses[j];
+      if(globalFrameGraphAccessInfos[access->access].write && needed[access->resource])
+        pass->culled = false;
+      if(access->access == FRAME_GRAPH_ACCESS_PRESENT)
+        pass->culled = false;
+    }
+
+    if(pass->culled) {
+      graph->stats.culledPassesCount++;
+      continue;
+    }
+
+    for(int j = 0; j < pass->accessesCount; j++) {
+      if(!globalFrameGraphAccessInfos[pass->accesses[j].access].write)
+        needed[pass->accesses[j].resource] = true;
+    }
+  }
+
+  for(int i = 0; i < graph->resourcesCount; i++) {
+    graph->resources[i].used = false;
+  }
+
+  for(int i = 0; i < graph->passesCount; i++) {
+    FrameGraphPass *pass = &graph->passes[i];
+    if(pass->culled)
+      continue;
+
+    for(int j = 0; j < pass->accessesCount; j++) {
+      FrameGraphResource *resource = &graph->resources[pass->accesses[j].resource];
+      if(!resource->used)
+        resource->firstPass = i;
+      resource->used = true;
+      resource->lastPass = i;
+    }
+  }
+}
+
+void frame_graph_private_build_segments(FrameGraph *graph) {
+  graph->segmentsCount = 0;
+
+  for(int i = 0; i < graph->passesCount; i++) {
+    FrameGraphPass *pass = &graph->passes[i];
+    if(pass->culled)
+      continue;
+
+    if(graph->segmentsCount > 0 && graph->segments[graph->segmentsCount - 1].queue == pass->queue) {
+      graph->segments[graph->segmentsCount - 1].lastPass = i;
+      continue;
+    }
+
+    if(graph->segmentsCount >= FRAME_GRAPH_MAX_SEGMENTS) {
+      printf("frame graph: too many queue switches\n");
+      exit(1);
+    }
+
+    FrameGraphSegment *segment = &graph->segments[graph->segmentsCount++];
+    segment->queue = pass->queue;
+    segment->firstPass = i;
+    segment->lastPass = i;
+  }
+
+  if(graph->segmentsCount == 0) {
+    printf("frame graph: every pass was culled\n");
+    exit(1);
+  }
+}
+
+void frame_graph_private_allocate_transients(FrameGraph *graph) {
+  uint32_t order[FRAME_GRAPH_MAX_RESOURCES];
+  uint32_t orderCount = 0;
+  uint32_t memoryTypeBits = UINT32_MAX;
+
+  graph->stats.transientMemorySize = 0;
+  graph->stats.transientMemorySizeUnaliased = 0;
+
+  for(int i = 0; i < graph->resourcesCount; i++) {
+    FrameGraphResource *resource = &graph->resources[i];
+    if(resource->imported || !resource->used)
+      continue;
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.flags = 0;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = resource->format;
+    imageInfo.extent.width = resource->extent.width;
+    imageInfo.extent.height = resource->extent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = resource->mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = resource->usage;
+
+    if(graph->queueFamilies[FRAME_GRAPH_QUEUE_GRAPHICS] != graph->queueFamilies[FRAME_GRAPH_QUEUE_COMPUTE]) {
+      imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+      imageInfo.queueFamilyIndexCount = FRAME_GRAPH_QUEUE_COUNT;
+      imageInfo.pQueueFamilyIndices = graph->queueFamilies;
+    }
+    else
+      imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if(vkCreateImage(graph->device, &imageInfo, NULL, &resource->image) != VK_SUCCESS) {
+      printf("frame graph: failed to create image %s\n", resource->name);
+      exit(1);
+    }
+    memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_IMAGE);
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(graph->device, resource->image, &requirements);
+    resource->memorySize = requirements.size;
+    resource->memoryAlignment = requirements.alignment;
+    resource->memoryTypeBits = requirements.memoryTypeBits;
+    memoryTypeBits &= requirements.memoryTypeBits;
+
+    graph->stats.transientMemorySizeUnaliased += requirements.size;
+    order[orderCount++] = i;
+  }
+
+  if(orderCount == 0)
+    return;
+
+  // largest first, each at the lowest offset that does not collide with an
+  // already placed image whose lifetime overlaps
+  for(int i = 1; i < orderCount; i++) {
+    uint32_t current = order[i];
+    int j = i - 1;
+    while(j >= 0 && graph->resources[order[j]].memorySize < graph->resources[current].memorySize) {
+      order[j + 1] = order[j];
+      j--;
+    }
+    order[j + 1] = current;
+  }
+
+  VkDeviceSize heapSize = 0;
+
+  for(int i = 0; i < orderCount; i++) {
+    FrameGraphResource *resource = &graph->resources[order[i]];
+    VkDeviceSize offset = 0;
+    bool moved = true;
+
+    while(moved) {
+      moved = false;
+
+      for(int j = 0; j < i; j++) {
+        FrameGraphResource *placed = &graph->resources[order[j]];
+        bool livesOverlap = resource->firstPass <= placed->lastPass && placed->firstPass <= resource->lastPass;
+        bool memoryOverlaps = offset < placed->memoryOffset + placed->memorySize && placed->memoryOffset < offset + resource->memorySize;
+
+        if(livesOverlap && memoryOverlaps) {
+          offset = placed->memoryOffset + placed->memorySize;
+          offset = (offset + resource->memoryAlignment - 1) / resource->memoryAlignment * resource->memoryAlignment;
+          moved = true;
+        }
+      }
+    }
+
+    resource->memoryOffset = offset;
+    if(offset + resource->memorySize > heapSize)
+      heapSize = offset + resource->memorySize;
+  }
+
+  uint32_t memoryType = UINT32_MAX;
+  for(uint32_t i = 0; i < graph->memoryProperties->memoryTypeCount; i++) {
+    if((memoryTypeBits & (1u << i)) && (graph->memoryProperties->memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) {
+      memoryType = i;
+      break;
+    }
+  }
+
+  if(memoryType == UINT32_MAX) {
+    printf("frame graph: transient images share no device local memory type\n");
+    exit(1);
+  }
+
+  VkMemoryAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = heapSize;
+  allocInfo.memoryTypeIndex = memoryType;
+
+  if(memory_tracker_allocate(&globalMemoryTracker, graph->device, &allocInfo, &graph->transientMemory) != VK_SUCCESS) {
+    printf("frame graph: failed to allocate %llu bytes of transient memory\n", (unsigned long long)heapSize);
+    exit(1);
+  }
+
+  graph->stats.transientMemorySize = heapSize;
+
+  for(int i = 0; i < orderCount; i++) {
+    FrameGraphResource *resource = &graph->resources[order[i]];
+    vkBindImageMemory(graph->device, resource->image, graph->transientMemory, resource->memoryOffset);
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = resource->image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = resource->format;
+    viewInfo.subresourceRange.aspectMask = resource->aspect;
+    viewInfo.subresourceRange.levelCount = resource->mipLevels;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if(vkCreateImageView(graph->device, &viewInfo, NULL, &resource->view) != VK_SUCCESS) {
+      printf("frame graph: failed to create view for %s\n", resource->name);
+      exit(1);
+    }
+    memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_IMAGE_VIEW);
+  }
+}
+
+void frame_graph_private_build_barriers(FrameGraph *graph) {
+  VkImageLayout layouts[FRAME_GRAPH_MAX_RESOURCES];
+  VkPipelineStageFlags stages[FRAME_GRAPH_MAX_RESOURCES]; // stages of the accesses since the last write
+  VkAccessFlags pendingWrites[FRAME_GRAPH_MAX_RESOURCES]; // written and not yet made visible
+  bool crossQueue[FRAME_GRAPH_MAX_RESOURCES]; // last touched on the other queue, or on both
+  FrameGraphQueue queues[FRAME_GRAPH_MAX_RESOURCES];
+
+  for(int i = 0; i < graph->resourcesCount; i++) {
+    FrameGraphResource *resource = &graph->resources[i];
+    layouts[i] = resource->initialLayout;
+    stages[i] = resource->initialStages;
+    pendingWrites[i] = 0;
+    queues[i] = FRAME_GRAPH_QUEUE_GRAPHICS;
+    crossQueue[i] = false;
+
+    // a transient's first use discards its contents, but it still has to wait
+    // for whatever last used the same memory, in this frame or the previous one
+    if(!resource->imported && resource->used) {
+      queues[i] = graph->passes[resource->firstPass].queue;
+
+      for(int j = 0; j < graph->resourcesCount; j++) {
+        FrameGraphResource *other = &graph->resources[j];
+        if(other->imported || !other->used)
+          continue;
+        if(resource->memoryOffset < other->memoryOffset + other->memorySize && other->memoryOffset < resource->memoryOffset + resource->memorySize) {
+          FrameGraphPass *lastPass = &graph->passes[other->lastPass];
+          if(lastPass->queue != graph->passes[resource->firstPass].queue)
+            crossQueue[i] = true;
+
+          for(int k = 0; k < lastPass->accessesCount; k++) {
+            if(lastPass->accesses[k].resource != j)
+              continue;
+            FrameGraphAccessInfo info = globalFrameGraphAccessInfos[lastPass->accesses[k].access];
+            stages[i] |= info.stages;
+            if(info.write)
+              pendingWrites[i] |= info.access;
+          }
+        }
+      }
+    }
+  }
+
+  graph->stats.barriersCount = 0;
+  graph->stats.barrierBatchesCount = 0;
+
+  for(int i = 0; i < graph->passesCount; i++) {
+    FrameGraphPass *pass = &graph->passes[i];
+    FrameGraphBarrierBatch *batch = &pass->before;
+    memset(batch, 0, sizeof(FrameGraphBarrierBatch));
+
+    if(pass->culled)
+      continue;
+
+    // merge repeated uses of one resource inside the pass (e.g. storage read + write)
+    uint32_t resources[FRAME_GRAPH_MAX_PASS_ACCESSES];
+    FrameGraphAccessInfo merged[FRAME_GRAPH_MAX_PASS_ACCESSES];
+    uint32_t mergedCount = 0;
+
+    for(int j = 0; j < pass->accessesCount; j++) {
+      FrameGraphAccessInfo info = globalFrameGraphAccessInfos[pass->accesses[j].access];
+      int k = 0;
+      while(k < mergedCount && resources[k] != pass->accesses[j].resource)
+        k++;
+
+      if(k == mergedCount) {
+        resources[mergedCount] = pass->accesses[j].resource;
+        merged[mergedCount++] = info;
+      }
+      else {
+        if(merged[k].layout != info.layout) {
+          printf("frame graph: pass %s uses %s in two layouts\n", pass->name, graph->resources[resources[k]].name);
+          exit(1);
+        }
+        merged[k].stages |= info.stages;
+        merged[k].access |= info.access;
+        merged[k].write |= info.write;
+      }
+    }
+
+    for(int j = 0; j < mergedCount; j++) {
+      uint32_t r = resources[j];
+      FrameGraphAccessInfo info = merged[j];
+
+      // the submit boundary semaphore waits at ALL_COMMANDS and makes the other
+      // queue's writes visible, the barrier only has to chain onto it
+      if(crossQueue[r] || queues[r] != pass->queue) {
+        stages[r] = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        pendingWrites[r] = 0;
+        crossQueue[r] = false;
+      }
+      queues[r] = pass->queue;
+
+      bool layoutChange = layouts[r] != info.layout;
+      bool readAfterWrite = pendingWrites[r] != 0;
+      bool writeAfterRead = info.write && stages[r] != 0;
+
+      if(!layoutChange && !readAfterWrite && !writeAfterRead) {
+        // read after read in the same layout needs nothing
+        stages[r] |= info.stages;
+        continue;
+      }
+
+      batch->srcStages |= stages[r] ? stages[r] : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+      batch->dstStages |= info.stages;
+
+      if(layoutChange || readAfterWrite) {
+        VkImageMemoryBarrier *barrier = &batch->barriers[batch->barriersCount];
+        barrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier->srcAccessMask = pendingWrites[r];
+        barrier->dstAccessMask = info.access;
+        barrier->oldLayout = layouts[r];
+        barrier->newLayout = info.layout;
+        barrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier->subresourceRange.aspectMask = graph->resources[r].aspect;
+        barrier->subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        barrier->subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+        batch->barrierResources[batch->barriersCount++] = r;
+        graph->stats.barriersCount++;
+      }
+      // a pure write-after-read hazard only needs the execution dependency
+
+      layouts[r] = info.layout;
+      stages[r] = info.stages;
+      pendingWrites[r] = info.write ? info.access & (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT) : 0;
+    }
+
+    if(batch->srcStages != 0)
+      graph->stats.barrierBatchesCount++;
+  }
+
+  FrameGraphBarrierBatch *batch = &graph->after;
+  memset(batch, 0, sizeof(FrameGraphBarrierBatch));
+
+  for(int i = 0; i < graph->resourcesCount; i++) {
+    FrameGraphResource *resource = &graph->resources[i];
+    if(!resource->imported || resource->finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || layouts[i] == resource->finalLayout)
+      continue;
+
+    if(batch->barriersCount >= FRAME_GRAPH_MAX_PASS_ACCESSES) {
+      printf("frame graph: too many imported images\n");
+      exit(1);
+    }
+
+    batch->srcStages |= stages[i] ? stages[i] : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    batch->dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+    VkImageMemoryBarrier *barrier = &batch->barriers[batch->barriersCount];
+    barrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier->srcAccessMask = pendingWrites[i];
+    barrier->dstAccessMask = 0; // presentation engine visibility is handled by the semaphore
+    barrier->oldLayout = layouts[i];
+    barrier->newLayout = resource->finalLayout;
+    barrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier->subresourceRange.aspectMask = resource->aspect;
+    barrier->subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+    barrier->subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+    batch->barrierResources[batch->barriersCount++] = i;
+    graph->stats.barriersCount++;
+  }
+
+  if(batch->srcStages != 0)
+    graph->stats.barrierBatchesCount++;
+}
+
+void frame_graph_private_record_barriers(FrameGraph *graph, VkCommandBuffer commandBuffer, FrameGraphBarrierBatch *batch) {
+  if(batch->srcStages == 0)
+    return;
+
+  // the batch is compiled once, absent images are left out of a copy
+  VkImageMemoryBarrier barriers[FRAME_GRAPH_MAX_PASS_ACCESSES];
+  uint32_t barriersCount = 0;
+
+  for(int i = 0; i < batch->barriersCount; i++) {
+    VkImage image = graph->resources[batch->barrierResources[i]].image;
+    if(image == VK_NULL_HANDLE)
+      continue;
+
+    barriers[barriersCount] = batch->barriers[i];
+    barriers[barriersCount].image = image;
+    barriersCount++;
+  }
+
+  vkCmdPipelineBarrier(commandBuffer, batch->srcStages, batch->dstStages, 0, 0, NULL, 0, NULL, barriersCount, barriers);
+}
+
+bool frame_graph_private_pass_absent(FrameGraph *graph, FrameGraphPass *pass) {
+  for(int i = 0; i < pass->accessesCount; i++) {
+    if(graph->resources[pass->accesses[i].resource].image == VK_NULL_HANDLE)
+      return true;
+  }
+  return false;
+}
+
+
+
+bool mesh_file_map(const char *path, MeshFile *file) {
+  file->fd = open(path, O_RDONLY);
+  if(file->fd < 0)
+    return false;
+
+  struct stat fileStat;
+  if(fstat(file->fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(MeshFileHeader)) {
+    printf("invalid mesh file %s\n", path);
+    close(file->fd);
+    return false;
+  }
+
+  file->size = fileStat.st_size;
+  file->mapped = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, file->fd, 0);
+
+  if(file->mapped == MAP_FAILED) {
+    printf("failed to map mesh file %s\n", path);
+    close(file->fd);
+    return false;
+  }
+  posix_madvise(file->mapped, file->size, POSIX_MADV_SEQUENTIAL | POSIX_MADV_WILLNEED);
+
+  const MeshFileHeader *header = (const MeshFileHeader *)file->mapped;
+  file->header = header;
+
+  if(header->magic == MESH_FILE_MAGIC && header->version != MESH_FILE_VERSION) {
+    printf("mesh file %s is version %u, expected %u, rebuild it with mesh_convert\n", path, header->version, MESH_FILE_VERSION);
+    mesh_file_unmap(file);
+    return false;
+  }
+
+  bool valid = header->magic == MESH_FILE_MAGIC
+    && header->version == MESH_FILE_VERSION
+    && header->vertexStride > 0
+    && header->attributeCount > 0 && header->attributeCount <= MESH_MAX_ATTRIBUTES
+    && header->vertexSize == (uint64_t)header->vertexCount * header->vertexStride
+    && header->indexSize == (uint64_t)header->indexCount * sizeof(uint32_t)
+    && header->meshletSize == (uint64_t)header->meshletCount * sizeof(Meshlet)
+    && header->meshletVertexSize == (uint64_t)header->meshletVertexCount * sizeof(uint32_t)
+    && header->meshletTriangleSize % sizeof(uint32_t) == 0
+    && header->vertexOffset % MESH_FILE_ALIGNMENT == 0
+    && header->indexOffset % MESH_FILE_ALIGNMENT == 0
+    && header->meshletOffset % MESH_FILE_ALIGNMENT == 0
+    && header->meshletVertexOffset % MESH_FILE_ALIGNMENT == 0
+    && header->meshletTriangleOffset % MESH_FILE_ALIGNMENT == 0
+    && header->vertexOffset <= file->size && header->vertexSize <= file->size - header->vertexOffset
+    && header->indexOffset <= file->size && header->indexSize <= file->size - header->indexOffset
+    && header->meshletOffset <= file->size && header->meshletSize <= file->size - header->meshletOffset
+    && header->meshletVertexOffset <= file->size && header->meshletVertexSize <= file->size - header->meshletVertexOffset
+    && header->meshletTriangleOffset <= file->size && header->meshletTriangleSize <= file->size - header->meshletTriangleOffset
+    && header->vertexCount > 0
+    && header->indexCount > 0
+    && header->meshletCount > 0;
+
+  // the sections are in bounds, now every index in them has to be too
+  if(!valid || !mesh_file_private_check_indices(file)) {
+    printf("invalid mesh file %s\n", path);
+    mesh_file_unmap(file);
+    return false;
+  }
+
+  return true;
+}
+
+void mesh_file_unmap(MeshFile *file) {
+  munmap(file->mapped, file->size);
+  close(file->fd);
+}
+
+// the shaders index the vertex section with these without any bounds checks
+bool mesh_file_private_check_indices(const MeshFile *file) {
+  const MeshFileHeader *header = file->header;
+  const uint32_t *indices = (const uint32_t *)(file->mapped + header->indexOffset);
+  const Meshlet *meshlets = (const Meshlet *)(file->mapped + header->meshletOffset);
+  const uint32_t *meshletVertices = (const uint32_t *)(file->mapped + header->meshletVertexOffset);
+  const uint8_t *meshletTriangles = (const uint8_t *)(file->mapped + header->meshletTriangleOffset);
+
+  for(uint32_t i = 0; i < header->indexCount; i++) {
+    if(indices[i] >= header->vertexCount)
+      return false;
+  }
+
+  for(uint32_t i = 0; i < header->meshletVertexCount; i++) {
+    if(meshletVertices[i] >= header->vertexCount)
+      return false;
+  }
+
+  for(uint32_t i = 0; i < header->meshletCount; i++) {
+    const Meshlet *meshlet = &meshlets[i];
+
+    bool valid = meshlet->vertexCount <= MESHLET_MAX_VERTICES
+      && meshlet->indexCount % 3 == 0
+      && meshlet->indexCount / 3 <= MESHLET_MAX_TRIANGLES
+      && (uint64_t)meshlet->firstIndex + meshlet->indexCount <= header->indexCount
+      && (uint64_t)meshlet->vertexOffset + meshlet->vertexCount <= header->meshletVertexCount
+      && meshlet->triangleOffset % 4 == 0
+      && (uint64_t)meshlet->triangleOffset + meshlet->indexCount <= header->meshletTriangleSize;
+    if(!valid)
+      return false;
+
+    for(uint32_t j = 0; j < meshlet->indexCount; j++) {
+      if(meshletTriangles[meshlet->triangleOffset + j] >= meshlet->vertexCount)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+
+
+bool trace_recorder_open(TraceRecorder *recorder, const char *path, VkExtent2D extent, VkFormat format, VkPresentModeKHR presentMode) {
+  memset(&recorder->header, 0, sizeof(TraceFileHeader));
+  recorder->failed = false;
+
+  recorder->file = fopen(path, "wb");
+  if(recorder->file == NULL) {
+    printf("failed to open capture file %s\n", path);
+    return false;
+  }
+  setvbuf(recorder->file, recorder->buffer, _IOFBF, sizeof(recorder->buffer));
+
+  TraceFileHeader *header = &recorder->header;
+  header->magic = TRACE_FILE_MAGIC;
+  header->version = TRACE_FILE_VERSION;
+  header->width = extent.width;
+  header->height = extent.height;
+  header->format = format;
+  header->presentMode = presentMode;
+  strncpy(header->meshPath, globalConfig.meshPath, sizeof(header->meshPath) - 1);
+
+  if(fwrite(header, sizeof(TraceFileHeader), 1, recorder->file) != 1) {
+    printf("failed to write capture file %s\n", path);
+    fclose(recorder->file);
+    return false;
+  }
+
+  recorder->startTime = helper_time_ns();
+  recorder->lastFrameTime = recorder->startTime;
+
+  printf("capturing frames to %s\n", path);
+  return true;
+}
+
+void trace_recorder_write_frame(TraceRecorder *recorder, const TraceHandles *handles, const DrawList *drawList, VkExtent2D extent, VkPresentModeKHR presentMode, uint32_t imageIndex) {
+  if(recorder->failed)
+    return;
+
+  uint64_t now = helper_time_ns();
+
+  TraceFrameHeader frame = {};
+  frame.magic = TRACE_FRAME_MAGIC;
+  frame.commandsCount = drawList->count;
+  frame.timeNs = now - recorder->startTime;
+  frame.cpuTimeNs = now - recorder->lastFrameTime;
+  frame.width = extent.width;
+  frame.height = extent.height;
+  frame.presentMode = presentMode;
+  frame.imageIndex = imageIndex;
+  recorder->lastFrameTime = now;
+
+  bool written = fwrite(&frame, sizeof(frame), 1, recorder->file) == 1;
+
+  for(int i = 0; i < drawList->count && written; i++) {
+    const DrawCommand *command = &drawList->commands[i];
+
+    TraceDrawCommand record = {};
+    record.pipeline = UINT16_MAX;
+    record.vertexBuffer = UINT16_MAX;
+    record.indexBuffer = UINT16_MAX;
+
+    for(int j = 0; j < handles->pipelinesCount; j++) {
+      if(handles->pipelines[j] == command->pipeline && handles->layouts[j] == command->layout)
+        record.pipeline = j;
+    }
+    for(int j = 0; j < handles->buffersCount; j++) {
+      if(handles->buffers[j] == command->vertexBuffer)
+        record.vertexBuffer = j;
+      if(handles->buffers[j] == command->indexBuffer)
+        record.indexBuffer = j;
+    }
+
+    if(record.pipeline == UINT16_MAX || record.vertexBuffer == UINT16_MAX || record.indexBuffer == UINT16_MAX) {
+      printf("capture: draw uses an object the trace cannot name, capture stopped\n");
+      recorder->failed = true;
+      return;
+    }
+
+    record.flags = (command->hasPushConstants ? TRACE_COMMAND_PUSH_CONSTANTS : 0) | (command->kind == DRAW_COMMAND_MESHLETS ? TRACE_COMMAND_MESHLETS : 0);
+    record.count = command->count;
+    record.instanceCount = command->instanceCount;
+
+    written = fwrite(&record, sizeof(record), 1, recorder->file) == 1;
+    if(written && command->hasPushConstants)
+      written = fwrite(&command->pushConstants, sizeof(MeshPushConstants), 1, recorder->file) == 1;
+  }
+
+  if(!written) {
+    printf("capture: write failed, capture stopped\n");
+    recorder->failed = true;
+    return;
+  }
+
+  recorder->header.framesCount++;
+}
+
+void trace_recorder_close(TraceRecorder *recorder) {
+  // a failed capture keeps the frames written before the failure
+  if(fseek(recorder->file, 0, SEEK_SET) != 0 || fwrite(&recorder->header, sizeof(TraceFileHeader), 1, recorder->file) != 1)
+    printf("capture: failed to finalize header\n");
+
+  fclose(recorder->file);
+  printf("captured %u frames\n", recorder->header.framesCount);
+}
+
+bool trace_player_open(TracePlayer *player, const char *path) {
+  memset(player, 0, sizeof(TracePlayer));
+
+  player->fd = open(path, O_RDONLY);
+  if(player->fd < 0) {
+    printf("failed to open trace %s\n", path);
+    return false;
+  }
+
+  struct stat fileStat;
+  if(fstat(player->fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(TraceFileHeader)) {
+    printf("invalid trace %s\n", path);
+    close(player->fd);
+    return false;
+  }
+
+  player->size = fileStat.st_size;
+  player->mapped = mmap(NULL, player->size, PROT_READ, MAP_PRIVATE, player->fd, 0);
+
+  if(player->mapped == MAP_FAILED) {
+    printf("failed to map trace %s\n", path);
+    close(player->fd);
+    return false;
+  }
+  posix_madvise(player->mapped, player->size, POSIX_MADV_SEQUENTIAL | POSIX_MADV_WILLNEED);
+
+  player->header = (const TraceFileHeader *)player->mapped;
+
+  if(player->header->magic != TRACE_FILE_MAGIC || player->header->version != TRACE_FILE_VERSION || player->header->framesCount == 0
+     || player->header->width == 0 || player->header->height == 0
+  ){
+    printf("invalid trace %s\n", path);
+    munmap(player->mapped, player->size);
+    close(player->fd);
+    return false;
+  }
+
+  player->frameOffsets = malloc(player->header->framesCount * sizeof(uint64_t));
+  CHECK_ALLOC_FOR_NULL(player->frameOffsets);
+
+  // validate every record up front so building draw lists needs no checks
+  uint64_t offset = sizeof(TraceFileHeader);
+  for(uint32_t i = 0; i < player->header->framesCount; i++) {
+    const TraceFrameHeader *frame = (const TraceFrameHeader *)(player->mapped + offset);
+    if(offset + sizeof(TraceFrameHeader) > player->size || frame->magic != TRACE_FRAME_MAGIC || frame->commandsCount > DRAW_LIST_MAX_COMMANDS)
+      break;
+
+    uint64_t next = offset + sizeof(TraceFrameHeader);
+    bool valid = true;
+    for(uint32_t j = 0; j < frame->commandsCount && valid; j++) {
+      const TraceDrawCommand *record = (const TraceDrawCommand *)(player->mapped + next);
+      valid = next + sizeof(TraceDrawCommand) <= player->size;
+      if(valid)
+        next += sizeof(TraceDrawCommand) + (record->flags & TRACE_COMMAND_PUSH_CONSTANTS ? sizeof(MeshPushConstants) : 0);
+      valid = valid && next <= player->size;
+    }
+    if(!valid)
+      break;
+
+    player->frameOffsets[player->framesCount++] = offset;
+    offset = next;
+  }
+
+  if(player->framesCount == 0) {
+    printf("trace %s holds no complete frame\n", path);
+    trace_player_close(player);
+    return false;
+  }
+  if(player->framesCount != player->header->framesCount)
+    printf("trace %s truncated, replaying the first %u of %u frames\n", path, player->framesCount, player->header->framesCount);
+
+  if(strncmp(player->header->meshPath, globalConfig.meshPath, sizeof(player->header->meshPath)) != 0)
+    printf("trace was captured with %s, replaying against %s\n", player->header->meshPath, globalConfig.meshPath);
+
+  printf("replaying %s: %u frames at %ux%u\n", path, player->framesCount, player->header->width, player->header->height);
+  return true;
+}
+
+const TraceFrameHeader *trace_player_frame(TracePlayer *player, uint32_t frame) {
+  return (const TraceFrameHeader *)(player->mapped + player->frameOffsets[frame]);
+}
+
+DrawList trace_player_build_draw_list(TracePlayer *player, uint32_t frame, const TraceHandles *handles, Arena *arena) {
+  const TraceFrameHeader *header = trace_player_frame(player, frame);
+
+  DrawList drawList;
+  draw_list_init(&drawList, arena, DRAW_LIST_MAX_COMMANDS);
+
+  const uint8_t *cursor = (const uint8_t *)(header + 1);
+  for(uint32_t i = 0; i < header->commandsCount; i++) {
+    const TraceDrawCommand *record = (const TraceDrawCommand *)cursor;
+    cursor += sizeof(TraceDrawCommand);
+
+    // commands naming objects this process did not create (e.g. the mesh
+    // failed to load) are dropped rather than guessed at
+    if(record->pipeline >= handles->pipelinesCount || record->vertexBuffer >= handles->buffersCount || record->indexBuffer >= handles->buffersCount) {
+      if(record->flags & TRACE_COMMAND_PUSH_CONSTANTS)
+        cursor += sizeof(MeshPushConstants);
+      continue;
+    }
+
+    DrawCommand *command = draw_list_push(&drawList);
+    command->kind = record->flags & TRACE_COMMAND_MESHLETS ? DRAW_COMMAND_MESHLETS : DRAW_COMMAND_PLAIN;
+    command->pipeline = handles->pipelines[record->pipeline];
+    command->layout = handles->layouts[record->pipeline];
+    command->vertexBuffer = handles->buffers[record->vertexBuffer];
+    command->indexBuffer = handles->buffers[record->indexBuffer];
+    command->count = record->count;
+    command->instanceCount = record->instanceCount;
+    command->hasPushConstants = record->flags & TRACE_COMMAND_PUSH_CONSTANTS;
+
+    if(command->hasPushConstants) {
+      memcpy(&command->pushConstants, cursor, sizeof(MeshPushConstants));
+      cursor += sizeof(MeshPushConstants);
+    }
+  }
+
+  return drawList;
+}
+
+void trace_player_close(TracePlayer *player) {
+  free(player->frameOffsets);
+  munmap(player->mapped, player->size);
+  close(player->fd);
+}
+
+
+
+Mat4 mat4_multiply(Mat4 a, Mat4 b) {
+  Mat4 result;
+
+  for(int column = 0; column < 4; column++) {
+    for(int row = 0; row < 4; row++) {
+      float sum = 0.0f;
+      for(int k = 0; k < 4; k++)
+        sum += a.m[k * 4 + row] * b.m[column * 4 + k];
+      result.m[column * 4 + row] = sum;
+    }
+  }
+
+  return result;
+}
+
+Mat4 mat4_perspective(float fovY, float aspect, float near, float far) {
+  Mat4 result = {};
+  float focal = 1.0f / tan(fovY * 0.5f);
+
+  // right handed, depth mapped to vulkan's [0, 1]
+  result.m[0] = focal / aspect;
+  result.m[5] = focal;
+  result.m[10] = far / (near - far);
+  result.m[11] = -1.0f;
+  result.m[14] = (near * far) / (near - far);
+
+  return result;
+}
+
+Mat4 mat4_look_at(const float eye[3], const float center[3], const float up[3]) {
+  float forward[3] = {center[0] - eye[0], center[1] - eye[1], center[2] - eye[2]};
+  float forwardLength = sqrt(forward[0] * forward[0] + forward[1] * forward[1] + forward[2] * forward[2]);
+  for(int i = 0; i < 3; i++)
+    forward[i] /= forwardLength;
+
+  float side[3] = {
+    forward[1] * up[2] - forward[2] * up[1],
+    forward[2] * up[0] - forward[0] * up[2],
+    forward[0] * up[1] - forward[1] * up[0]
+  };
+  float sideLength = sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+  for(int i = 0; i < 3; i++)
+    side[i] /= sideLength;
+
+  float trueUp[3] = {
+    side[1] * forward[2] - side[2] * forward[1],
+    side[2] * forward[0] - side[0] * forward[2],
+    side[0] * forward[1] - side[1] * forward[0]
+  };
+
+  Mat4 result = {};
+  result.m[0] = side[0];
+  result.m[4] = side[1];
+  result.m[8] = side[2];
+  result.m[1] = trueUp[0];
+  result.m[5] = trueUp[1];
+  result.m[9] = trueUp[2];
+  result.m[2] = -forward[0];
+  result.m[6] = -forward[1];
+  result.m[10] = -forward[2];
+  result.m[12] = -(side[0] * eye[0] + side[1] * eye[1] + side[2] * eye[2]);
+  result.m[13] = -(trueUp[0] * eye[0] + trueUp[1] * eye[1] + trueUp[2] * eye[2]);
+  result.m[14] = forward[0] * eye[0] + forward[1] * eye[1] + forward[2] * eye[2];
+  result.m[15] = 1.0f;
+
+  return result;
+}
+
+
+
+void memory_tracker_init(MemoryTracker *tracker, VkPhysicalDevice physicalDevice, bool budgetSupported) {
+  memset(tracker, 0, sizeof(MemoryTracker));
+
+  tracker->physicalDevice = physicalDevice;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &tracker->memoryProperties);
+  pthread_mutex_init(&tracker->mutex, NULL);
+
+  MemoryStats *stats = &tracker->stats;
+  stats->budgetSupported = budgetSupported;
+  stats->heapsCount = tracker->memoryProperties.memoryHeapCount;
+
+  for(int i = 0; i < stats->heapsCount; i++) {
+    stats->heapSize[i] = tracker->memoryProperties.memoryHeaps[i].size;
+    stats->heapDeviceLocal[i] = tracker->memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+  }
+
+  memory_tracker_private_query_budget(tracker);
+
+  printf("memory budget: %s\n", budgetSupported ? "VK_EXT_memory_budget" : "heap sizes (VK_EXT_memory_budget unavailable)");
+}
+
+void memory_tracker_set_pressure_callback(MemoryTracker *tracker, MemoryPressureCallback callback, MemoryPressureCallback reliefCallback, void *userData) {
+  tracker->pressureCallback = callback;
+  tracker->reliefCallback = reliefCallback;
+  tracker->pressureUserData = userData;
+}
+
+VkResult memory_tracker_allocate(MemoryTracker *tracker, VkDevice device, const VkMemoryAllocateInfo *allocInfo, VkDeviceMemory *memory) {
+  VkResult result = vkAllocateMemory(device, allocInfo, NULL, memory);
+  if(result != VK_SUCCESS)
+    return result;
+
+  pthread_mutex_lock(&tracker->mutex);
+
+  if(tracker->allocationsCount >= MEMORY_TRACKER_MAX_ALLOCATIONS) {
+    printf("memory tracker: too many live allocations\n");
+    exit(1);
+  }
+
+  MemoryStats *stats = &tracker->stats;
+  uint32_t heap = tracker->memoryProperties.memoryTypes[allocInfo->memoryTypeIndex].heapIndex;
+
+  MemoryAllocation *allocation = &tracker->allocations[tracker->allocationsCount++];
+  allocation->memory = *memory;
+  allocation->size = allocInfo->allocationSize;
+  allocation->heap = heap;
+
+  stats->heapAllocated[heap] += allocInfo->allocationSize;
+  stats->heapAllocationsCount[heap]++;
+  stats->allocationsTotal++;
+
+  VkDeviceSize allocated = 0;
+  for(int i = 0; i < stats->heapsCount; i++) {
+    allocated += stats->heapAllocated[i];
+  }
+  if(allocated > stats->allocatedPeak)
+    stats->allocatedPeak = allocated;
+
+  pthread_mutex_unlock(&tracker->mutex);
+
+  return VK_SUCCESS;
+}
+
+void memory_tracker_free(MemoryTracker *tracker, VkDevice device, VkDeviceMemory memory) {
+  if(memory == VK_NULL_HANDLE)
+    return;
+
+  pthread_mutex_lock(&tracker->mutex);
+
+  uint32_t i = 0;
+  while(i < tracker->allocationsCount && tracker->allocations[i].memory != memory)
+    i++;
+
+  if(i == tracker->allocationsCount) {
+    printf("memory tracker: freeing untracked memory\n");
+    exit(1);
+  }
+
+  MemoryStats *stats = &tracker->stats;
+  MemoryAllocation *allocation = &tracker->allocations[i];
+  stats->heapAllocated[allocation->heap] -= allocation->size;
+  stats->heapAllocationsCount[allocation->heap]--;
+  stats->freesTotal++;
+
+  tracker->allocations[i] = tracker->allocations[--tracker->allocationsCount];
+
+  pthread_mutex_unlock(&tracker->mutex);
+
+  vkFreeMemory(device, memory, NULL);
+}
+
+void memory_tracker_object_created(MemoryTracker *tracker, MemoryObjectType type) {
+  pthread_mutex_lock(&tracker->mutex);
+  tracker->stats.liveObjects[type]++;
+  pthread_mutex_unlock(&tracker->mutex);
+}
+
+void memory_tracker_object_destroyed(MemoryTracker *tracker, MemoryObjectType type) {
+  pthread_mutex_lock(&tracker->mutex);
+  tracker->stats.liveObjects[type]--;
+  pthread_mutex_unlock(&tracker->mutex);
+}
+
+void memory_tracker_update(MemoryTracker *tracker) {
+  memory_tracker_private_query_budget(tracker);
+
+  MemoryStats *stats = &tracker->stats;
+
+  // only device local heaps page, host heaps are bounded by system memory
+  VkDeviceSize overBytes = 0;
+  VkDeviceSize headroom = UINT64_MAX; // below the low water mark on the fullest heap
+  bool underPressure = false;
+
+  for(int i = 0; i < stats->heapsCount; i++) {
+    if(!stats->heapDeviceLocal[i])
+      continue;
+
+    VkDeviceSize highWater = (VkDeviceSize)(stats->heapBudget[i] * MEMORY_PRESSURE_HIGH_WATER);
+    VkDeviceSize lowWater = (VkDeviceSize)(stats->heapBudget[i] * MEMORY_PRESSURE_LOW_WATER);
+
+    if(stats->heapUsage[i] > highWater) {
+      underPressure = true;
+      overBytes += stats->heapUsage[i] - lowWater;
+    }
+    VkDeviceSize heapHeadroom = stats->heapUsage[i] < lowWater ? lowWater - stats->heapUsage[i] : 0;
+    if(heapHeadroom < headroom)
+      headroom = heapHeadroom;
+  }
+
+  tracker->framesSincePressure++;
+
+  if(underPressure && tracker->framesSincePressure >= MEMORY_PRESSURE_COOLDOWN_FRAMES) {
+    tracker->framesSincePressure = 0;
+    stats->pressureEvents++;
+
+    VkDeviceSize freed = 0;
+    if(tracker->pressureCallback != NULL)
+      freed = tracker->pressureCallback(tracker->pressureUserData, overBytes);
+    stats->pressureBytesFreed += freed;
+
+    printf("memory pressure: %.1f MiB over the low water mark, %.1f MiB released\n",
+      overBytes / (1024.0 * 1024.0), freed / (1024.0 * 1024.0));
+    memory_tracker_log(tracker);
+  }
+  // the gap between the water marks is the hysteresis: what was shed above the
+  // high mark only grows back into room below the low one, and not before the
+  // cooldown since the last pressure event
+  else if(!underPressure && headroom != UINT64_MAX && headroom > 0
+          && tracker->framesSincePressure >= MEMORY_PRESSURE_COOLDOWN_FRAMES && tracker->reliefCallback != NULL
+  ){
+    VkDeviceSize granted = tracker->reliefCallback(tracker->pressureUserData, headroom);
+    if(granted > 0)
+      printf("memory pressure eased: %.1f MiB handed back\n", granted / (1024.0 * 1024.0));
+  }
+
+  if(++tracker->framesSinceReport >= MEMORY_TRACKER_REPORT_FRAMES) {
+    tracker->framesSinceReport = 0;
+    memory_tracker_log(tracker);
+  }
+}
+
+void memory_tracker_get_stats(MemoryTracker *tracker, MemoryStats *stats) {
+  pthread_mutex_lock(&tracker->mutex);
+  *stats = tracker->stats;
+  pthread_mutex_unlock(&tracker->mutex);
+}
+
+void memory_tracker_log(MemoryTracker *tracker) {
+  MemoryStats stats;
+  memory_tracker_get_stats(tracker, &stats);
+
+  char line[512];
+  int length = snprintf(line, sizeof(line), "memory:");
+
+  for(int i = 0; i < stats.heapsCount && length < (int)sizeof(line); i++) {
+    length += snprintf(line + length, sizeof(line) - length, " heap%d%s %.1f/%.1f MiB (ours %.1f MiB in %u)", i,
+      stats.heapDeviceLocal[i] ? " local" : "", stats.heapUsage[i] / (1024.0 * 1024.0), stats.heapBudget[i] / (1024.0 * 1024.0),
+      stats.heapAllocated[i] / (1024.0 * 1024.0), stats.heapAllocationsCount[i]);
+  }
+
+  for(int i = 0; i < MEMORY_OBJECT_COUNT && length < (int)sizeof(line); i++) {
+    length += snprintf(line + length, sizeof(line) - length, " %s %lld", globalMemoryObjectNames[i], (long long)stats.liveObjects[i]);
+  }
+
+  printf("%s\n", line);
+}
+
+void memory_tracker_destroy(MemoryTracker *tracker) {
+  MemoryStats *stats = &tracker->stats;
+
+  printf("memory: %llu allocations, %llu frees, peak %.1f MiB, %u pressure events\n",
+    (unsigned long long)stats->allocationsTotal, (unsigned long long)stats->freesTotal,
+    stats->allocatedPeak / (1024.0 * 1024.0), stats->pressureEvents);
+
+  for(int i = 0; i < tracker->allocationsCount; i++) {
+    printf("memory leak: %llu bytes on heap %u\n", (unsigned long long)tracker->allocations[i].size, tracker->allocations[i].heap);
+  }
+  for(int i = 0; i < MEMORY_OBJECT_COUNT; i++) {
+    if(stats->liveObjects[i] != 0)
+      printf("memory leak: %lld %s still alive\n", (long long)stats->liveObjects[i], globalMemoryObjectNames[i]);
+  }
+
+  pthread_mutex_destroy(&tracker->mutex);
+}
+
+void memory_tracker_private_query_budget(MemoryTracker *tracker) {
+  MemoryStats *stats = &tracker->stats;
+
+  if(!stats->budgetSupported) {
+    pthread_mutex_lock(&tracker->mutex);
+    for(int i = 0; i < stats->heapsCount; i++) {
+      stats->heapBudget[i] = stats->heapSize[i];
+      stats->heapUsage[i] = stats->heapAllocated[i];
+    }
+    pthread_mutex_unlock(&tracker->mutex);
+    return;
+  }
+
+  // the budget covers every process on the device, usage includes driver
+  // internal allocations that never pass through the tracker
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {};
+  budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+  VkPhysicalDeviceMemoryProperties2 properties = {};
+  properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+  properties.pNext = &budget;
+
+  vkGetPhysicalDeviceMemoryProperties2(tracker->physicalDevice, &properties);
+
+  pthread_mutex_lock(&tracker->mutex);
+  for(int i = 0; i < stats->heapsCount; i++) {
+    stats->heapBudget[i] = budget.heapBudget[i];
+    stats->heapUsage[i] = budget.heapUsage[i];
+  }
+  pthread_mutex_unlock(&tracker->mutex);
+}
+
+
+
+void debug_logger_init(DebugLogger *logger, DebugLogSeverity minSeverity, uint32_t rateLimit) {
+  const VkDebugUtilsMessageSeverityFlagBitsEXT severities[] = {
+    [DEBUG_LOG_SEVERITY_VERBOSE] = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT,
+    [DEBUG_LOG_SEVERITY_INFO] = VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT,
+    [DEBUG_LOG_SEVERITY_WARNING] = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT,
+    [DEBUG_LOG_SEVERITY_ERROR] = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT
+  };
+
+  memset(logger, 0, sizeof(*logger));
+  for(int i = minSeverity; i <= DEBUG_LOG_SEVERITY_ERROR; i++) {
+    logger->severityMask |= severities[i];
+  }
+  logger->rateLimit = rateLimit;
+  logger->rateWindowStart = helper_time_ns();
+
+  pthread_mutex_init(&logger->mutex, NULL);
+  pthread_cond_init(&logger->available, NULL);
+  logger->running = true;
+
+  if(pthread_create(&logger->thread, NULL, debug_logger_private_thread, logger) != 0) {
+    printf("failed to start debug log thread\n");
+    exit(1);
+  }
+}
+
+void debug_logger_submit(DebugLogger *logger, VkDebugUtilsMessageSeverityFlagBitsEXT severity, int32_t messageId, const char *messageIdName, const char *message) {
+  bool error = severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+  uint64_t hash = debug_logger_private_hash(debug_logger_private_hash(14695981039346656037ull, messageIdName), message);
+
+  pthread_mutex_lock(&logger->mutex);
+
+  uint32_t occurrence = error ? 1 : debug_logger_private_count_message(logger, messageId, hash);
+  if(occurrence > DEBUG_LOG_REPEAT_LIMIT) {
+    logger->suppressedRepeats++;
+    pthread_mutex_unlock(&logger->mutex);
+    return;
+  }
+
+  if(!error && logger->rateLimit > 0) {
+    uint64_t now = helper_time_ns();
+    if(now - logger->rateWindowStart >= 1000000000ull) {
+      logger->rateWindowStart = now;
+      logger->rateWindowCount = 0;
+    }
+    if(logger->rateWindowCount >= logger->rateLimit) {
+      logger->droppedRate++;
+      pthread_mutex_unlock(&logger->mutex);
+      return;
+    }
+    logger->rateWindowCount++;
+  }
+
+  // never wait for the writer, the caller is in the middle of a vulkan call.
+  // an error that finds the ring full is printed right here instead, ahead of
+  // whatever is still queued
+  if(logger->head - logger->tail == DEBUG_LOG_RING_SIZE) {
+    if(!error)
+      logger->droppedFull++;
+    pthread_mutex_unlock(&logger->mutex);
+
+    if(error) {
+      fprintf(stdout, "validation error: %s\n", message);
+      fflush(stdout);
+    }
+    return;
+  }
+
+  DebugLogEntry *entry = &logger->ring[logger->head % DEBUG_LOG_RING_SIZE];
+  entry->severity = severity;
+  entry->messageId = messageId;
+  entry->occurrence = occurrence;
+  snprintf(entry->text, sizeof(entry->text), "%s", message);
+  logger->head++;
+
+  pthread_cond_signal(&logger->available);
+  pthread_mutex_unlock(&logger->mutex);
+}
+
+void debug_logger_destroy(DebugLogger *logger) {
+  pthread_mutex_lock(&logger->mutex);
+  logger->running = false;
+  pthread_cond_signal(&logger->available);
+  pthread_mutex_unlock(&logger->mutex);
+  pthread_join(logger->thread, NULL);
+
+  for(int i = 0; i < DEBUG_LOG_ID_SLOTS; i++) {
+    DebugLogIdCount *id = &logger->ids[i];
+    if(id->used && id->count > DEBUG_LOG_REPEAT_LIMIT)
+      printf("validation: message 0x%08x (%016llx) repeated %u times\n", (uint32_t)id->messageId, (unsigned long long)id->hash, id->count);
+  }
+  if(logger->suppressedRepeats > 0 || logger->droppedRate > 0 || logger->droppedFull > 0) {
+    printf("validation: %llu repeats suppressed, %llu dropped by rate limit, %llu dropped on full ring\n",
+      (unsigned long long)logger->suppressedRepeats, (unsigned long long)logger->droppedRate,
+      (unsigned long long)logger->droppedFull);
+  }
+
+  pthread_cond_destroy(&logger->available);
+  pthread_mutex_destroy(&logger->mutex);
+}
+
+void *debug_logger_private_thread(void *arg) {
+  DebugLogger *logger = arg;
+
+  pthread_mutex_lock(&logger->mutex);
+
+  while(true) {
+    while(logger->running && logger->tail == logger->head) {
+      pthread_cond_wait(&logger->available, &logger->mutex);
+    }
+    if(logger->tail == logger->head)
+      break;
+
+    // entries up to head stay put until tail moves past them, so they can be
+    // printed without holding the lock
+    uint32_t end = logger->head;
+    pthread_mutex_unlock(&logger->mutex);
+
+    for(uint32_t i = logger->tail; i != end; i++) {
+      DebugLogEntry *entry = &logger->ring[i % DEBUG_LOG_RING_SIZE];
+      fprintf(stdout, "validation %s: %s%s\n", debug_logger_private_severity_name(entry->severity), entry->text,
+        entry->occurrence == DEBUG_LOG_REPEAT_LIMIT ? " (further repeats suppressed)" : "");
+    }
+    fflush(stdout);
+
+    pthread_mutex_lock(&logger->mutex);
+    logger->tail = end;
+  }
+
+  pthread_mutex_unlock(&logger->mutex);
+  return NULL;
+}
+
+uint32_t debug_logger_private_count_message(DebugLogger *logger, int32_t messageId, uint64_t hash) {
+  uint32_t slot = (uint32_t)((hash ^ (uint32_t)messageId) * 2654435761u % DEBUG_LOG_ID_SLOTS);
+
+  for(int i = 0; i < DEBUG_LOG_ID_SLOTS; i++) {
+    DebugLogIdCount *id = &logger->ids[(slot + i) % DEBUG_LOG_ID_SLOTS];
+    if(!id->used) {
+      id->used = true;
+      id->messageId = messageId;
+      id->hash = hash;
+      id->count = 1;
+      return 1;
+    }
+    if(id->messageId == messageId && id->hash == hash)
+      return ++id->count;
+  }
+
+  return 1;
+}
+
+// fnv-1a, chained over the message id name and the message text
+uint64_t debug_logger_private_hash(uint64_t hash, const char *text) {
+  for(; text != NULL && *text != '\0'; text++) {
+    hash ^= (uint8_t)*text;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+const char *debug_logger_private_severity_name(VkDebugUtilsMessageSeverityFlagBitsEXT severity) {
+  switch(severity) {
+    case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT: return "error";
+    case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT: return "warning";
+    case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT: return "info";
+    default: return "verbose";
+  }
+}
+
+
+
+// threadsCount includes the main thread, 0 picks one thread per core
+void job_system_init(JobSystem *system, uint32_t threadsCount) {
+  memset(system, 0, sizeof(JobSystem));
+
+  if(threadsCount == 0) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    threadsCount = cores > 0 ? (uint32_t)cores : 1;
+  }
+  system->threadsCount = threadsCount > JOB_SYSTEM_MAX_THREADS ? JOB_SYSTEM_MAX_THREADS : threadsCount;
+
+  pthread_mutex_init(&system->sleepMutex, NULL);
+  pthread_cond_init(&system->sleepCondition, NULL);
+  atomic_store(&system->running, true);
+
+  for(uint32_t i = 1; i < system->threadsCount; i++) {
+    system->workers[i].system = system;
+    system->workers[i].index = i;
+
+    if(pthread_create(&system->threads[i], NULL, job_system_private_thread, &system->workers[i]) != 0) {
+      printf("failed to start job thread\n");
+      exit(1);
+    }
+  }
+
+  printf("frame jobs on %u threads\n", system->threadsCount);
+}
+
+// main thread only. the job runs once it is submitted and every dependency
+// declared with job_system_depend has finished
+uint32_t job_system_add(JobSystem *system, const char *name, JobFunction function, void *data) {
+  if(system->jobsCount >= JOB_SYSTEM_MAX_JOBS) {
+    printf("too many jobs\n");
+    exit(1);
+  }
+
+  uint32_t index = system->jobsCount++;
+  Job *job = &system->jobs[index];
+  job->name = name;
+  job->function = function;
+  job->data = data;
+  job->dependentsCount = 0;
+  atomic_store_explicit(&job->pendingCount, 1, memory_order_relaxed);
+
+  atomic_fetch_add_explicit(&system->unfinishedCount, 1, memory_order_relaxed);
+  return index;
+}
+
+// neither job may have been submitted yet
+void job_system_depend(JobSystem *system, uint32_t job, uint32_t dependency) {
+  Job *dependencyJob = &system->jobs[dependency];
+  if(dependencyJob->dependentsCount >= JOB_SYSTEM_MAX_DEPENDENTS) {
+    printf("too many dependents on job %s\n", dependencyJob->name);
+    exit(1);
+  }
+
+  dependencyJob->dependents[dependencyJob->dependentsCount++] = job;
+  atomic_fetch_add_explicit(&system->jobs[job].pendingCount, 1, memory_order_relaxed);
+}
+
+void job_system_submit(JobSystem *system, uint32_t job) {
+  if(atomic_fetch_sub_explicit(&system->jobs[job].pendingCount, 1, memory_order_acq_rel) == 1)
+    job_system_private_push(system, 0, job);
+}
+
+// runs and steals jobs on the main thread until every added job finished,
+// then starts a new set of jobs
+void job_system_wait(JobSystem *system) {
+  while(atomic_load_explicit(&system->unfinishedCount, memory_order_acquire) > 0) {
+    uint32_t job;
+    if(job_system_private_next(system, 0, &job))
+      job_system_private_run(system, 0, job);
+    else
+      sched_yield();
+  }
+
+  job_system_private_record_timings(system);
+  system->jobsCount = 0;
+}
+
+void job_system_destroy(JobSystem *system) {
+  pthread_mutex_lock(&system->sleepMutex);
+  atomic_store(&system->running, false);
+  pthread_cond_broadcast(&system->sleepCondition);
+  pthread_mutex_unlock(&system->sleepMutex);
+
+  for(uint32_t i = 1; i < system->threadsCount; i++) {
+    pthread_join(system->threads[i], NULL);
+  }
+
+  pthread_cond_destroy(&system->sleepCondition);
+  pthread_mutex_destroy(&system->sleepMutex);
+}
+
+void *job_system_private_thread(void *arg) {
+  JobWorker *worker = arg;
+  JobSystem *system = worker->system;
+  uint32_t idleRounds = 0;
+
+  while(atomic_load(&system->running)) {
+    unsigned generation = atomic_load(&system->generation);
+
+    uint32_t job;
+    if(job_system_private_next(system, worker->index, &job)) {
+      job_system_private_run(system, worker->index, job);
+      idleRounds = 0;
+      continue;
+    }
+
+    // frame jobs come in bursts, stay around briefly before sleeping
+    if(++idleRounds < JOB_SYSTEM_SPIN_ROUNDS) {
+      sched_yield();
+      continue;
+    }
+
+    pthread_mutex_lock(&system->sleepMutex);
+    atomic_fetch_add(&system->sleepingCount, 1);
+    if(atomic_load(&system->generation) == generation && atomic_load(&system->running))
+      pthread_cond_wait(&system->sleepCondition, &system->sleepMutex);
+    atomic_fetch_sub(&system->sleepingCount, 1);
+    pthread_mutex_unlock(&system->sleepMutex);
+    idleRounds = 0;
+  }
+
+  return NULL;
+}
+
+// own deque first, newest job first while its data is still in cache, then
+// the oldest job of every other thread, starting with the next one
+bool job_system_private_next(JobSystem *system, uint32_t thread, uint32_t *job) {
+  if(job_deque_pop(&system->deques[thread], job))
+    return true;
+
+  for(uint32_t i = 1; i < system->threadsCount; i++) {
+    if(job_deque_steal(&system->deques[(thread + i) % system->threadsCount], job))
+      return true;
+  }
+  return false;
+}
+
+void job_system_private_run(JobSystem *system, uint32_t thread, uint32_t index) {
+  Job *job = &system->jobs[index];
+
+  job->startTime = helper_time_ns();
+  job->function(job->data);
+  job->endTime = helper_time_ns();
+
+  for(uint32_t i = 0; i < job->dependentsCount; i++) {
+    uint32_t dependent = job->dependents[i];
+    if(atomic_fetch_sub_explicit(&system->jobs[dependent].pendingCount, 1, memory_order_acq_rel) == 1)
+      job_system_private_push(system, thread, dependent);
+  }
+
+  atomic_fetch_sub_explicit(&system->unfinishedCount, 1, memory_order_release);
+}
+
+void job_system_private_push(JobSystem *system, uint32_t thread, uint32_t job) {
+  job_deque_push(&system->deques[thread], job);
+
+  // pairs with the sleeping count and generation checks in the worker loop,
+  // one of the two sides always sees the other
+  atomic_fetch_add(&system->generation, 1);
+  if(atomic_load(&system->sleepingCount) > 0) {
+    pthread_mutex_lock(&system->sleepMutex);
+    pthread_cond_broadcast(&system->sleepCondition);
+    pthread_mutex_unlock(&system->sleepMutex);
+  }
+}
+
+// every job finished, so their times are final
+void job_system_private_record_timings(JobSystem *system) {
+  if(system->jobsCount == 0)
+    return;
+
+  uint64_t firstStart = UINT64_MAX;
+  uint64_t lastEnd = 0;
+
+  for(uint32_t i = 0; i < system->jobsCount; i++) {
+    Job *job = &system->jobs[i];
+    double ms = (job->endTime - job->startTime) / 1e6;
+    system->jobTimeMs += ms;
+    firstStart = job->startTime < firstStart ? job->startTime : firstStart;
+    lastEnd = job->endTime > lastEnd ? job->endTime : lastEnd;
+
+    uint32_t name = 0;
+    while(name < system->namesCount && strcmp(system->names[name], job->name) != 0) {
+      name++;
+    }
+    if(name == system->namesCount && system->namesCount < JOB_SYSTEM_MAX_NAMES)
+      system->names[system->namesCount++] = job->name;
+    if(name < system->namesCount)
+      system->nameTimesMs[name] += ms;
+  }
+  system->wallTimeMs += (lastEnd - firstStart) / 1e6;
+
+  if(++system->waitsSinceReport < JOB_SYSTEM_REPORT_WAITS)
+    return;
+
+  char line[512];
+  int length = snprintf(line, sizeof(line), "frame jobs per frame:");
+
+  for(uint32_t i = 0; i < system->namesCount && length < (int)sizeof(line); i++) {
+    length += snprintf(line + length, sizeof(line) - length, " %s %.3f ms", system->names[i], system->nameTimesMs[i] / system->waitsSinceReport);
+    system->nameTimesMs[i] = 0.0;
+  }
 
-  createInfo.enabledExtensionCount = globalDeviceExtensionCount;
-  createInfo.ppEnabledExtensionNames = globalDeviceExtensions;
+  // job time over wall time, how many threads were busy on average
+  printf("%s, %.3f ms wall, %.2fx parallel on %u threads\n", line, system->wallTimeMs / system->waitsSinceReport,
+    system->wallTimeMs > 0.0 ? system->jobTimeMs / system->wallTimeMs : 0.0, system->threadsCount);
 
-  if(globalValidationLayersEnabled) {
-    createInfo.enabledLayerCount = globalValidationLayersCount;
-    createInfo.ppEnabledLayerNames = globalValidationLayers;
-  }
-  else
-    createInfo.enabledLayerCount = 0;
+  system->waitsSinceReport = 0;
+  system->jobTimeMs = 0.0;
+  system->wallTimeMs = 0.0;
+}
 
-  createInfo.pNext = NULL;
-  createInfo.flags = 0;
+void job_deque_push(JobDeque *deque, uint32_t job) {
+  int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+  atomic_store_explicit(&deque->jobs[bottom % JOB_SYSTEM_MAX_JOBS], job, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+}
 
-  if (vkCreateDevice(app->physicalDevice, &createInfo, NULL, &app->device) != VK_SUCCESS) {
-    printf("failed to create logical device");
-    exit(1);
+bool job_deque_pop(JobDeque *deque, uint32_t *job) {
+  int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+  atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  int64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+  if(top > bottom) {
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return false;
   }
 
-  vkGetDeviceQueue(app->device, indices.graphicsFamily, 0, &app->graphicsQueue);
-  vkGetDeviceQueue(app->device, indices.presentFamily, 0, &app->presentQueue);
+  *job = atomic_load_explicit(&deque->jobs[bottom % JOB_SYSTEM_MAX_JOBS], memory_order_relaxed);
+  if(top < bottom)
+    return true;
 
-  free(uniqueQueueFamilies);
-  free(queueCreateInfos);
+  // the last entry, a thief may be taking it at the same time
+  bool won = atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+  atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+  return won;
 }
 
-void app_private_init_vulkan_create_swap_chain(App *app) {
-  SwapChainSupportDetails swapChainSupport = swap_chain_support_details_query(app->physicalDevice, app->surface);
-
-  VkSurfaceFormatKHR surfaceFormat = app_private_init_vulkan_create_swap_chain_choose_format(swapChainSupport.formats, swapChainSupport.formatsCount);
-  VkPresentModeKHR presentMode = app_private_init_vulkan_create_swap_chain_choose_present_mode(swapChainSupport.presentModes, swapChainSupport.presentModesCount);
-  VkExtent2D extent = app_private_init_vulkan_create_swap_chain_choose_swap_extend(&swapChainSupport.capabilities, app->window);
+bool job_deque_steal(JobDeque *deque, uint32_t *job) {
+  int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
 
-  uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+  if(top >= bottom)
+    return false;
 
-  if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
-    imageCount = swapChainSupport.capabilities.maxImageCount;
-  }
+  *job = atomic_load_explicit(&deque->jobs[top % JOB_SYSTEM_MAX_JOBS], memory_order_relaxed);
+  return atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+}
 
-  VkSwapchainCreateInfoKHR createInfo;
-  createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-  createInfo.surface = app->surface;
-  createInfo.minImageCount = imageCount;
-  createInfo.imageFormat = surfaceFormat.format;
-  createInfo.imageColorSpace = surfaceFormat.colorSpace;
-  createInfo.imageExtent = extent;
-  createInfo.imageArrayLayers = 1;
-  createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-  QueueFamilyIndices indices = queue_families_find(app->physicalDevice, app->surface);
-  uint32_t queueFamilyIndices[] = {indices.graphicsFamily, indices.presentFamily};
 
-  if(indices.graphicsFamily != indices.presentFamily) {
-    createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-    createInfo.queueFamilyIndexCount = 2;
-    createInfo.pQueueFamilyIndices = queueFamilyIndices;
-  } else {
-    createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    createInfo.queueFamilyIndexCount = 0;
-    createInfo.pQueueFamilyIndices = NULL;
-  }
-  createInfo.preTransform = swapChainSupport.capabilities.currentTransform;
-  createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-  createInfo.presentMode = presentMode;
-  createInfo.clipped = VK_TRUE;
-  createInfo.oldSwapchain = VK_NULL_HANDLE;
-  createInfo.pNext = NULL;
-  createInfo.flags = 0;
+void submit_batcher_init(SubmitBatcher *batcher, PFN_vkQueueSubmit2KHR queueSubmit2) {
+  memset(batcher, 0, sizeof(SubmitBatcher));
+  batcher->queueSubmit2 = queueSubmit2;
+}
 
-  if(vkCreateSwapchainKHR(app->device, &createInfo, NULL, &app->swapChain) != VK_SUCCESS) {
-    printf("failed to create swapchain\n");
+// everything added until the next begin is one batch on queue
+void submit_batcher_begin(SubmitBatcher *batcher, VkQueue queue) {
+  if(batcher->batchesCount >= SUBMIT_BATCHER_MAX_BATCHES) {
+    printf("submit batcher full\n");
     exit(1);
   }
 
-  vkGetSwapchainImagesKHR(app->device, app->swapChain, &imageCount, NULL);
-  app->swapChainImagesCount = imageCount;
-  app->swapChainImages = calloc(imageCount, sizeof(VkImage));
-  CHECK_ALLOC_FOR_NULL(app->swapChainImages);
-  vkGetSwapchainImagesKHR(app->device, app->swapChain, &imageCount, app->swapChainImages);
+  SubmitBatch *batch = &batcher->batches[batcher->batchesCount++];
+  batch->queue = queue;
+  batch->firstWait = batcher->waitsCount;
+  batch->waitsCount = 0;
+  batch->firstCommandBuffer = batcher->commandBuffersCount;
+  batch->commandBuffersCount = 0;
+  batch->firstSignal = batcher->signalsCount;
+  batch->signalsCount = 0;
+  batch->fence = VK_NULL_HANDLE;
+}
 
-  app->swapChainImageFormat = surfaceFormat.format;
-  app->swapChainExtent = extent;
+void submit_batcher_add_wait(SubmitBatcher *batcher, VkSemaphore semaphore, VkPipelineStageFlags stages) {
+  if(batcher->waitsCount >= SUBMIT_BATCHER_MAX_SEMAPHORES) {
+    printf("submit batcher full\n");
+    exit(1);
+  }
 
-  swap_chain_support_details_free(swapChainSupport);
+  batcher->waitSemaphores[batcher->waitsCount] = semaphore;
+  batcher->waitStages[batcher->waitsCount++] = stages;
+  batcher->batches[batcher->batchesCount - 1].waitsCount++;
 }
 
-VkSurfaceFormatKHR app_private_init_vulkan_create_swap_chain_choose_format(VkSurfaceFormatKHR *availableFormats, uint32_t count) {
-  for(int i = 0; i < count; i++) {
-    if(availableFormats[i].format == VK_FORMAT_B8G8R8A8_SRGB && availableFormats[i].colorSpace == VK_COLORSPACE_SRGB_NONLINEAR_KHR) {
-      return availableFormats[i];
-    }
+void submit_batcher_add_command_buffer(SubmitBatcher *batcher, VkCommandBuffer commandBuffer) {
+  if(batcher->commandBuffersCount >= SUBMIT_BATCHER_MAX_COMMAND_BUFFERS) {
+    printf("submit batcher full\n");
+    exit(1);
   }
-  return availableFormats[0];
+
+  batcher->commandBuffers[batcher->commandBuffersCount++] = commandBuffer;
+  batcher->batches[batcher->batchesCount - 1].commandBuffersCount++;
 }
 
-VkPresentModeKHR app_private_init_vulkan_create_swap_chain_choose_present_mode(VkPresentModeKHR *availablePresentModes, uint32_t count) {
-  for(int i = 0; i < count; i++) {
-    if(availablePresentModes[i] == VK_PRESENT_MODE_MAILBOX_KHR) {
-      return availablePresentModes[i];
-    }
+void submit_batcher_add_signal(SubmitBatcher *batcher, VkSemaphore semaphore) {
+  if(batcher->signalsCount >= SUBMIT_BATCHER_MAX_SEMAPHORES) {
+    printf("submit batcher full\n");
+    exit(1);
   }
-  return VK_PRESENT_MODE_FIFO_KHR;
+
+  batcher->signalSemaphores[batcher->signalsCount++] = semaphore;
+  batcher->batches[batcher->batchesCount - 1].signalsCount++;
 }
 
-VkExtent2D app_private_init_vulkan_create_swap_chain_choose_swap_extend(VkSurfaceCapabilitiesKHR *capabilities, GLFWwindow* window) {
-  if(capabilities->currentExtent.width != UINT32_MAX) {
-    return capabilities->currentExtent;
-  } else {
-    int width = 0, height = 0;
-    glfwGetFramebufferSize(window, &width, &height);
+// for a subsystem that tracks its own batch, which then costs a call of its
+// own instead of sharing one with the batches after it on the same queue
+void submit_batcher_set_fence(SubmitBatcher *batcher, VkFence fence) {
+  batcher->batches[batcher->batchesCount - 1].fence = fence;
+}
 
-    VkExtent2D actualExtend = {
-      fmin(capabilities->maxImageExtent.width, fmax(width, capabilities->minImageExtent.width)),
-      fmax(capabilities->maxImageExtent.height, fmax(height, capabilities->minImageExtent.height))
-    };
-    return actualExtend;
+// batches keep their order, fence rides on the last call. the last batch
+// must not finish before the others, which holds when it waits on them
+void submit_batcher_flush(SubmitBatcher *batcher, VkFence fence) {
+  uint32_t first = 0;
+  for(uint32_t i = 1; i <= batcher->batchesCount; i++) {
+    VkFence batchFence = batcher->batches[i - 1].fence;
+    if(i < batcher->batchesCount && batcher->batches[i].queue == batcher->batches[first].queue && batchFence == VK_NULL_HANDLE)
+      continue;
+
+    bool last = i == batcher->batchesCount;
+    submit_batcher_private_submit(batcher, first, i - first, batchFence != VK_NULL_HANDLE ? batchFence : last ? fence : VK_NULL_HANDLE);
+
+    // the last batch carried its own fence, the flush's goes out empty after it
+    if(last && batchFence != VK_NULL_HANDLE && fence != VK_NULL_HANDLE)
+      submit_batcher_private_submit(batcher, i - 1, 0, fence);
+    first = i;
   }
+
+  batcher->batchesCount = 0;
+  batcher->waitsCount = 0;
+  batcher->commandBuffersCount = 0;
+  batcher->signalsCount = 0;
 }
 
-void app_private_init_vulkan_create_image_views(App* app) {
-  app->swapChainImageViews = calloc(app->swapChainImagesCount, sizeof(VkImageView));
-  CHECK_ALLOC_FOR_NULL(app->swapChainImageViews);
+void submit_batcher_private_submit(SubmitBatcher *batcher, uint32_t firstBatch, uint32_t batchesCount, VkFence fence) {
+  VkQueue queue = batcher->batches[firstBatch].queue;
+  VkResult result;
+
+  if(batcher->queueSubmit2 != NULL) {
+    VkSemaphoreSubmitInfoKHR waitInfos[SUBMIT_BATCHER_MAX_SEMAPHORES];
+    VkCommandBufferSubmitInfoKHR commandBufferInfos[SUBMIT_BATCHER_MAX_COMMAND_BUFFERS];
+    VkSemaphoreSubmitInfoKHR signalInfos[SUBMIT_BATCHER_MAX_SEMAPHORES];
+    VkSubmitInfo2KHR submits[SUBMIT_BATCHER_MAX_BATCHES];
+
+    // the legacy stage bits keep their values in VkPipelineStageFlags2
+    for(uint32_t i = 0; i < batcher->waitsCount; i++) {
+      memset(&waitInfos[i], 0, sizeof(VkSemaphoreSubmitInfoKHR));
+      waitInfos[i].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR;
+      waitInfos[i].semaphore = batcher->waitSemaphores[i];
+      waitInfos[i].stageMask = batcher->waitStages[i];
+    }
+    for(uint32_t i = 0; i < batcher->commandBuffersCount; i++) {
+      memset(&commandBufferInfos[i], 0, sizeof(VkCommandBufferSubmitInfoKHR));
+      commandBufferInfos[i].sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO_KHR;
+      commandBufferInfos[i].commandBuffer = batcher->commandBuffers[i];
+    }
+    // binary semaphores signal once all of the batch's commands completed
+    for(uint32_t i = 0; i < batcher->signalsCount; i++) {
+      memset(&signalInfos[i], 0, sizeof(VkSemaphoreSubmitInfoKHR));
+      signalInfos[i].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR;
+      signalInfos[i].semaphore = batcher->signalSemaphores[i];
+      signalInfos[i].stageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    }
 
-  for(int i = 0; i < app->swapChainImagesCount; i++) {
-    VkImageViewCreateInfo createInfo;
-    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    createInfo.image = app->swapChainImages[i];
-    createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    createInfo.format = app->swapChainImageFormat;
-    createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-    createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-    createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-    createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-    createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    createInfo.subresourceRange.baseMipLevel = 0;
-    createInfo.subresourceRange.levelCount = 1;
-    createInfo.subresourceRange.baseArrayLayer = 0;
-    createInfo.subresourceRange.layerCount = 1;
-    createInfo.pNext = NULL;
-    createInfo.flags = 0;
+    for(uint32_t i = 0; i < batchesCount; i++) {
+      SubmitBatch *batch = &batcher->batches[firstBatch + i];
+      memset(&submits[i], 0, sizeof(VkSubmitInfo2KHR));
+      submits[i].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2_KHR;
+      submits[i].waitSemaphoreInfoCount = batch->waitsCount;
+      submits[i].pWaitSemaphoreInfos = &waitInfos[batch->firstWait];
+      submits[i].commandBufferInfoCount = batch->commandBuffersCount;
+      submits[i].pCommandBufferInfos = &commandBufferInfos[batch->firstCommandBuffer];
+      submits[i].signalSemaphoreInfoCount = batch->signalsCount;
+      submits[i].pSignalSemaphoreInfos = &signalInfos[batch->firstSignal];
+    }
 
-    if(vkCreateImageView(app->device, &createInfo, NULL, &app->swapChainImageViews[i]) != VK_SUCCESS) {
-      printf("failed to create image view\n");
-      exit(1);
+    result = batcher->queueSubmit2(queue, batchesCount, submits, fence);
+  }
+  else {
+    VkSubmitInfo submits[SUBMIT_BATCHER_MAX_BATCHES];
+
+    for(uint32_t i = 0; i < batchesCount; i++) {
+      SubmitBatch *batch = &batcher->batches[firstBatch + i];
+      memset(&submits[i], 0, sizeof(VkSubmitInfo));
+      submits[i].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+      submits[i].waitSemaphoreCount = batch->waitsCount;
+      submits[i].pWaitSemaphores = &batcher->waitSemaphores[batch->firstWait];
+      submits[i].pWaitDstStageMask = &batcher->waitStages[batch->firstWait];
+      submits[i].commandBufferCount = batch->commandBuffersCount;
+      submits[i].pCommandBuffers = &batcher->commandBuffers[batch->firstCommandBuffer];
+      submits[i].signalSemaphoreCount = batch->signalsCount;
+      submits[i].pSignalSemaphores = &batcher->signalSemaphores[batch->firstSignal];
     }
+
+    result = vkQueueSubmit(queue, batchesCount, submits, fence);
+  }
+
+  if(result != VK_SUCCESS) {
+    printf("failed to submit command buffers\n");
+    exit(1);
   }
 }
 
-void app_private_init_vulkan_create_render_pass(App *app) {
-  VkAttachmentDescription colorAttachment = {};
-  colorAttachment.format = app->swapChainImageFormat;
-  colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-  colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-  colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
-  VkAttachmentReference colorAttachmentRef = {};
-  colorAttachmentRef.attachment = 0;
-  colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
-  VkSubpassDescription subpass = {};
-  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-  subpass.colorAttachmentCount = 1;
-  subpass.pColorAttachments = &colorAttachmentRef;
+void texture_streamer_init(TextureStreamer *streamer, VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue, QueueFamilyIndices indices, VkDeviceSize budget) {
+  memset(streamer, 0, sizeof(TextureStreamer));
 
-  VkSubpassDependency dependency = {};
-  dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-  dependency.dstSubpass = 0;
-  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependency.srcAccessMask = 0;
-  dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  streamer->device = device;
+  streamer->transferQueue = transferQueue;
+  streamer->transferFamily = indices.transferFamily;
+  streamer->graphicsFamily = indices.graphicsFamily;
+  streamer->budget = budget;
+  streamer->configuredBudget = budget;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &streamer->memoryProperties);
 
-  VkRenderPassCreateInfo renderPassInfo = {};
-  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-  renderPassInfo.attachmentCount = 1;
-  renderPassInfo.pAttachments = &colorAttachment;
-  renderPassInfo.subpassCount = 1;
-  renderPassInfo.pSubpasses = &subpass;
-  renderPassInfo.dependencyCount = 1;
-  renderPassInfo.pDependencies = &dependency;
+  VkCommandPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  poolInfo.queueFamilyIndex = streamer->transferFamily;
 
-  if(vkCreateRenderPass(app->device, &renderPassInfo, NULL, &app->renderPass) != VK_SUCCESS) {
-    printf("failed to create render pass\n");
+  if(vkCreateCommandPool(device, &poolInfo, NULL, &streamer->commandPool) != VK_SUCCESS) {
+    printf("failed to create texture upload command pool\n");
     exit(1);
   }
-}
 
-void app_private_init_vulkan_create_graphics_pipeline(App *app) {
-  size_t vertCodeSize, fragCodeSize;
-  uint8_t* vertShaderCode = helper_read_file("shaders/vert.spv", &vertCodeSize);
-  uint8_t* fragShaderCode = helper_read_file("shaders/frag.spv", &fragCodeSize);
+  VkBufferCreateInfo bufferInfo = {};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size = (VkDeviceSize)TEXTURE_STREAMER_RING_SLOTS * TEXTURE_STREAMER_SLOT_SIZE;
+  bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-  if(vertShaderCode == NULL || fragShaderCode == NULL) {
-    printf("failed to load shader code\n");
+  if(vkCreateBuffer(device, &bufferInfo, NULL, &streamer->stagingBuffer) != VK_SUCCESS) {
+    printf("failed to create texture staging buffer\n");
     exit(1);
   }
+  memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_BUFFER);
 
-  VkShaderModuleCreateInfo vertModuleInfo = {};
-  vertModuleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-  vertModuleInfo.codeSize = vertCodeSize;
-  vertModuleInfo.pCode = (uint32_t*)vertShaderCode;
-  vertModuleInfo.pNext = NULL;
-  vertModuleInfo.flags = 0;
+  VkMemoryRequirements memRequirements;
+  vkGetBufferMemoryRequirements(device, streamer->stagingBuffer, &memRequirements);
 
-  VkShaderModuleCreateInfo fragModuleInfo = {};
-  fragModuleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-  fragModuleInfo.codeSize = fragCodeSize;
-  fragModuleInfo.pCode = (uint32_t*)fragShaderCode;
-  fragModuleInfo.pNext = NULL;
-  fragModuleInfo.flags = 0;
+  VkMemoryAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = memRequirements.size;
+  allocInfo.memoryTypeIndex = texture_streamer_private_find_memory_type(streamer, memRequirements.memoryTypeBits,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-  VkShaderModule vertModule, fragModule;
-  if (vkCreateShaderModule(app->device, &vertModuleInfo, NULL, &vertModule) != VK_SUCCESS
-      || vkCreateShaderModule(app->device, &fragModuleInfo, NULL, &fragModule) != VK_SUCCESS
-  ){
-    printf("failed to create shader module\n");
+  if(memory_tracker_allocate(&globalMemoryTracker, device, &allocInfo, &streamer->stagingMemory) != VK_SUCCESS) {
+    printf("failed to allocate texture staging memory\n");
     exit(1);
   }
-  VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
-  vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-  vertShaderStageInfo.module = vertModule;
-  vertShaderStageInfo.pName = "main";
-  vertShaderStageInfo.pSpecializationInfo = NULL;
-  vertShaderStageInfo.pNext = NULL;
-  vertShaderStageInfo.flags = 0;
+  vkBindBufferMemory(device, streamer->stagingBuffer, streamer->stagingMemory, 0);
+  vkMapMemory(device, streamer->stagingMemory, 0, bufferInfo.size, 0, (void **)&streamer->stagingMapped);
 
-  VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
-  fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-  fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-  fragShaderStageInfo.module = fragModule;
-  fragShaderStageInfo.pName = "main";
-  fragShaderStageInfo.pSpecializationInfo = NULL;
-  fragShaderStageInfo.pNext = NULL;
-  fragShaderStageInfo.flags = 0;
+  VkCommandBufferAllocateInfo commandBufferInfo = {};
+  commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  commandBufferInfo.commandPool = streamer->commandPool;
+  commandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  commandBufferInfo.commandBufferCount = 1;
 
-  VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+  VkFenceCreateInfo fenceInfo = {};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 
-  VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-  vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-  vertexInputInfo.vertexBindingDescriptionCount = 0;
-  vertexInputInfo.pVertexBindingDescriptions = NULL;
-  vertexInputInfo.vertexAttributeDescriptionCount = 0;
-  vertexInputInfo.pVertexAttributeDescriptions = NULL;
-  vertexInputInfo.pNext = NULL;
-  vertexInputInfo.flags = 0;
+  for(int i = 0; i < TEXTURE_STREAMER_RING_SLOTS; i++) {
+    streamer->slots[i].state = STAGING_SLOT_FREE;
 
-  uint32_t dynamicStatesSize = 2;
-  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
-  VkPipelineDynamicStateCreateInfo dynamicState = {};
-  dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-  dynamicState.dynamicStateCount = dynamicStatesSize,
-  dynamicState.pDynamicStates = dynamicStates;
-  dynamicState.pNext = NULL;
-  dynamicState.flags = 0;
+    if(vkAllocateCommandBuffers(device, &commandBufferInfo, &streamer->slots[i].commandBuffer) != VK_SUCCESS
+       || vkCreateFence(device, &fenceInfo, NULL, &streamer->slots[i].fence) != VK_SUCCESS
+    ){
+      printf("failed to create texture upload slot\n");
+      exit(1);
+    }
+  }
 
-  VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-  inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-  inputAssembly.primitiveRestartEnable = VK_FALSE;
-  inputAssembly.pNext = NULL;
-  inputAssembly.flags = 0;
+  pthread_mutex_init(&streamer->mutex, NULL);
+  pthread_cond_init(&streamer->ioCond, NULL);
+  streamer->ioRunning = true;
 
-  VkViewport viewport = {};
-  viewport.x = 0.0f;
-  viewport.y = 0.0f;
-  viewport.width = (float)app->swapChainExtent.width;
-  viewport.height = (float)app->swapChainExtent.height;
-  viewport.minDepth = 0.0f;
-  viewport.maxDepth = 1.0f;
+  if(pthread_create(&streamer->ioThread, NULL, texture_streamer_private_io_thread, streamer) != 0) {
+    printf("failed to start texture io thread\n");
+    exit(1);
+  }
+}
 
-  VkRect2D scissor = {};
-  VkOffset2D offset = {0, 0};
-  scissor.offset = offset;
-  scissor.extent = app->swapChainExtent;
+uint32_t texture_streamer_request(TextureStreamer *streamer, const char *path) {
+  if(streamer->texturesCount >= TEXTURE_STREAMER_MAX_TEXTURES) {
+    printf("too many textures, %s not loaded\n", path);
+    return UINT32_MAX;
+  }
 
-  VkPipelineViewportStateCreateInfo viewportState = {};
-  viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-  viewportState.viewportCount = 1;
-  viewportState.pViewports = &viewport;
-  viewportState.scissorCount = 1;
-  viewportState.pScissors = &scissor;
-  viewportState.pNext = NULL;
-  viewportState.flags = 0;
+  uint32_t index = streamer->texturesCount;
+  Texture *texture = &streamer->textures[index];
 
-  VkPipelineRasterizationStateCreateInfo rasterizer = {};
-  rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-  rasterizer.depthClampEnable = VK_FALSE;
-  rasterizer.rasterizerDiscardEnable = VK_FALSE;
-  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-  rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-  rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-  rasterizer.depthBiasEnable = VK_FALSE;
-  rasterizer.depthBiasConstantFactor = 0.0f;
-  rasterizer.depthBiasClamp = 0.0f;
-  rasterizer.depthBiasSlopeFactor = 0.0f;
-  rasterizer.lineWidth = 1.0f;
-  rasterizer.pNext = NULL;
-  rasterizer.flags = 0;
+  memset(texture, 0, sizeof(Texture));
+  strncpy(texture->path, path, sizeof(texture->path) - 1);
+  texture->fd = -1;
+  texture->state = TEXTURE_STATE_HEADER_PENDING;
 
-  VkPipelineMultisampleStateCreateInfo multisampling = {};
-  multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-  multisampling.sampleShadingEnable = VK_FALSE;
-  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-  multisampling.minSampleShading = 1.0f;
-  multisampling.pSampleMask = NULL;
-  multisampling.alphaToCoverageEnable = VK_FALSE;
-  multisampling.alphaToOneEnable = VK_FALSE;
-  multisampling.pNext = NULL;
-  multisampling.flags = 0;
+  TextureRequest request = {};
+  request.kind = TEXTURE_REQUEST_HEADER;
+  request.texture = index;
+  request.size = 0;
 
-  VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-  colorBlendAttachment.colorWriteMask =
-      VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-      VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-  colorBlendAttachment.blendEnable = VK_FALSE;
-  colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-  colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-  colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-  colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-  colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-  colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+  pthread_mutex_lock(&streamer->mutex);
+  streamer->texturesCount++;
+  texture_streamer_private_push_request(streamer, request);
+  pthread_mutex_unlock(&streamer->mutex);
 
-  VkPipelineColorBlendStateCreateInfo colorBlending = {};
-  colorBlending.sType =
-      VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-  colorBlending.logicOpEnable = VK_FALSE;
-  colorBlending.logicOp = VK_LOGIC_OP_COPY;
-  colorBlending.attachmentCount = 1;
-  colorBlending.pAttachments = &colorBlendAttachment;
-  colorBlending.blendConstants[0] = 0.0f;
-  colorBlending.blendConstants[1] = 0.0f;
-  colorBlending.blendConstants[2] = 0.0f;
-  colorBlending.blendConstants[3] = 0.0f;
-  colorBlending.pNext = NULL;
-  colorBlending.flags = 0;
+  return index;
+}
 
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount = 0;
-  pipelineLayoutInfo.pSetLayouts = NULL;
-  pipelineLayoutInfo.pushConstantRangeCount = 0;
-  pipelineLayoutInfo.pPushConstantRanges = NULL;
-  pipelineLayoutInfo.pNext = NULL;
-  pipelineLayoutInfo.flags = 0;
+// this update's uploads become one batch in batcher, which the caller
+// flushes; the batch carries the slots' fence, not the caller's
+void texture_streamer_update(TextureStreamer *streamer, SubmitBatcher *batcher) {
+  streamer->frame++;
 
-  if(vkCreatePipelineLayout(app->device, &pipelineLayoutInfo, NULL, &app->pipelineLayout) != VK_SUCCESS) {
-    printf("failed to create pipeline layout\n");
-    exit(1);
+  for(int i = 0; i < TEXTURE_STREAMER_RING_SLOTS; i++) {
+    if(streamer->slots[i].state == STAGING_SLOT_UPLOADING
+       && vkGetFenceStatus(streamer->device, streamer->slots[streamer->slots[i].fenceSlot].fence) == VK_SUCCESS
+    ){
+      texture_streamer_private_complete_upload(streamer, i);
+    }
   }
 
-  VkGraphicsPipelineCreateInfo pipelineInfo = {};
-  pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount = 2;
-  pipelineInfo.pStages = shaderStages;
-  pipelineInfo.pVertexInputState = &vertexInputInfo;
-  pipelineInfo.pInputAssemblyState = &inputAssembly;
-  pipelineInfo.pViewportState = &viewportState;
-  pipelineInfo.pRasterizationState = &rasterizer;
-  pipelineInfo.pMultisampleState = &multisampling;
-  pipelineInfo.pDepthStencilState = NULL;
-  pipelineInfo.pColorBlendState = &colorBlending;
-  pipelineInfo.pDynamicState = &dynamicState;
-  pipelineInfo.layout = app->pipelineLayout;
-  pipelineInfo.renderPass = app->renderPass;
-  pipelineInfo.subpass = 0;
-  pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-  pipelineInfo.basePipelineIndex = -1;
-  pipelineInfo.pNext = NULL;
-  pipelineInfo.flags = 0;
+  pthread_mutex_lock(&streamer->mutex);
+
+  for(int i = 0; i < streamer->texturesCount; i++) {
+    if(streamer->textures[i].state == TEXTURE_STATE_HEADER_READY)
+      texture_streamer_private_allocate_texture(streamer, &streamer->textures[i]);
+  }
+
+  // every upload ready this update goes out in one batch. all of them
+  // complete together, so the first slot's fence is never reset while a
+  // slot sharing it is still uploading
+  uint32_t fenceSlot = UINT32_MAX;
+
+  for(int i = 0; i < TEXTURE_STREAMER_RING_SLOTS; i++) {
+    if(streamer->slots[i].state != STAGING_SLOT_READY)
+      continue;
+
+    if(fenceSlot == UINT32_MAX) {
+      fenceSlot = i;
+      submit_batcher_begin(batcher, streamer->transferQueue);
+    }
+
+    texture_streamer_private_record_upload(streamer, i);
+    submit_batcher_add_command_buffer(batcher, streamer->slots[i].commandBuffer);
+    streamer->slots[i].fenceSlot = fenceSlot;
+  }
+
+  if(fenceSlot != UINT32_MAX) {
+    vkResetFences(streamer->device, 1, &streamer->slots[fenceSlot].fence);
+    submit_batcher_set_fence(batcher, streamer->slots[fenceSlot].fence);
+  }
+
+  pthread_mutex_unlock(&streamer->mutex);
+
+  uint32_t kept = 0;
+  for(int i = 0; i < streamer->retiredViewsCount; i++) {
+    if(streamer->frame - streamer->retiredViews[i].retiredFrame >= TEXTURE_STREAMER_VIEW_RETIRE_FRAMES) {
+      memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_IMAGE_VIEW);
+      vkDestroyImageView(streamer->device, streamer->retiredViews[i].view, NULL);
+    }
+    else
+      streamer->retiredViews[kept++] = streamer->retiredViews[i];
+  }
+  streamer->retiredViewsCount = kept;
+
+  // after the views, an image retires in the same frame as its last view
+  kept = 0;
+  for(int i = 0; i < streamer->retiredImagesCount; i++) {
+    if(streamer->frame - streamer->retiredImages[i].retiredFrame >= TEXTURE_STREAMER_VIEW_RETIRE_FRAMES) {
+      memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_IMAGE);
+      vkDestroyImage(streamer->device, streamer->retiredImages[i].image, NULL);
+      memory_tracker_free(&globalMemoryTracker, streamer->device, streamer->retiredImages[i].memory);
+    }
+    else
+      streamer->retiredImages[kept++] = streamer->retiredImages[i];
+  }
+  streamer->retiredImagesCount = kept;
+}
 
-  if(vkCreateGraphicsPipelines(app->device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &app->graphicsPipeline) != VK_SUCCESS) {
-    printf("failed to create graphics pipeline\n");
-    exit(1);
+bool texture_streamer_idle(TextureStreamer *streamer) {
+  if(streamer->retiredViewsCount > 0 || streamer->retiredImagesCount > 0)
+    return false;
+
+  pthread_mutex_lock(&streamer->mutex);
+
+  bool idle = streamer->requestsCount == 0;
+
+  for(int i = 0; i < TEXTURE_STREAMER_RING_SLOTS && idle; i++) {
+    if(streamer->slots[i].state != STAGING_SLOT_FREE)
+      idle = false;
+  }
+  for(int i = 0; i < streamer->texturesCount && idle; i++) {
+    if(streamer->textures[i].state == TEXTURE_STATE_HEADER_PENDING || streamer->textures[i].state == TEXTURE_STATE_HEADER_READY)
+      idle = false;
   }
 
-  vkDestroyShaderModule(app->device, fragModule, NULL);
-  vkDestroyShaderModule(app->device, vertModule, NULL);
+  pthread_mutex_unlock(&streamer->mutex);
 
-  free(vertShaderCode);
-  free(fragShaderCode);
+  return idle;
 }
 
-void app_private_init_vulkan_create_frame_buffers(App* app) {
-  app->swapChainFrameBuffersCount = app->swapChainImagesCount;
-  app->swapChainFrameBuffers = calloc(app->swapChainFrameBuffersCount, sizeof(VkFramebuffer));
-  CHECK_ALLOC_FOR_NULL(app->swapChainFrameBuffers);
+VkImageView texture_streamer_get_view(TextureStreamer *streamer, uint32_t texture) {
+  if(texture >= streamer->texturesCount)
+    return VK_NULL_HANDLE;
 
-  for(int i = 0; i < app->swapChainFrameBuffersCount; i++) {
-    VkFramebufferCreateInfo framebufferInfo = {};
-    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = app->renderPass;
-    framebufferInfo.attachmentCount = 1;
-    framebufferInfo.pAttachments = &app->swapChainImageViews[i];
-    framebufferInfo.width = app->swapChainExtent.width;
-    framebufferInfo.height = app->swapChainExtent.height;
-    framebufferInfo.layers = 1;
+  return streamer->textures[texture].view;
+}
 
-    if(vkCreateFramebuffer(app->device, &framebufferInfo, NULL, &app->swapChainFrameBuffers[i]) != VK_SUCCESS) {
-      printf("failed to create %i. frame buffer\n", i);
+// evicted images go on the retire list, so the bytes returned are released
+// TEXTURE_STREAMER_VIEW_RETIRE_FRAMES later, well inside the tracker's
+// MEMORY_PRESSURE_COOLDOWN_FRAMES before it asks again
+VkDeviceSize texture_streamer_shed(TextureStreamer *streamer, VkDeviceSize bytes) {
+  // evicted textures stream back in at the coarser first mip that fits what
+  // is left, the budget grows back through texture_streamer_restore
+  streamer->budget = streamer->committedBytes > bytes ? streamer->committedBytes - bytes : 0;
+
+  VkDeviceSize freed = 0;
+
+  while(freed < bytes) {
+    // largest fully resident texture first, textures still uploading keep their memory
+    Texture *victim = NULL;
+    for(int i = 0; i < streamer->texturesCount; i++) {
+      Texture *texture = &streamer->textures[i];
+      if(texture->state != TEXTURE_STATE_STREAMING || texture->residentMip != texture->firstMip)
+        continue;
+      if(victim == NULL || texture->memorySize > victim->memorySize)
+        victim = texture;
+    }
+
+    if(victim == NULL)
+      break;
+
+    if(streamer->retiredImagesCount >= TEXTURE_STREAMER_MAX_RETIRED_IMAGES) {
+      printf("texture image retire list full\n");
       exit(1);
     }
+
+    texture_streamer_private_retire_view(streamer, victim->view);
+    streamer->retiredImages[streamer->retiredImagesCount].image = victim->image;
+    streamer->retiredImages[streamer->retiredImagesCount].memory = victim->memory;
+    streamer->retiredImages[streamer->retiredImagesCount].retiredFrame = streamer->frame;
+    streamer->retiredImagesCount++;
+
+    streamer->committedBytes -= victim->memorySize;
+    freed += victim->memorySize;
+
+    victim->view = VK_NULL_HANDLE;
+    victim->image = VK_NULL_HANDLE;
+    victim->memory = VK_NULL_HANDLE;
+    victim->memorySize = 0;
+    victim->uploadedMipsMask = 0;
+    victim->state = TEXTURE_STATE_HEADER_PENDING;
+
+    TextureRequest request = {};
+    request.kind = TEXTURE_REQUEST_HEADER;
+    request.texture = victim - streamer->textures;
+
+    pthread_mutex_lock(&streamer->mutex);
+    texture_streamer_private_push_request(streamer, request);
+    pthread_mutex_unlock(&streamer->mutex);
   }
-}
 
-void app_private_init_vulkan_create_command_pool(App *app) {
-  QueueFamilyIndices queueFamilyIndices = queue_families_find(app->physicalDevice, app->surface);
+  return freed;
+}
 
-  VkCommandPoolCreateInfo poolInfo = {};
-  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-  poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+// grows the budget back by up to bytes, never past the configured one.
+// textures already streamed at a coarser first mip keep it, only the ones
+// allocated from now on see the extra room
+VkDeviceSize texture_streamer_restore(TextureStreamer *streamer, VkDeviceSize bytes) {
+  VkDeviceSize missing = streamer->configuredBudget - streamer->budget;
+  VkDeviceSize granted = bytes < missing ? bytes : missing;
 
-  if(vkCreateCommandPool(app->device, &poolInfo, NULL, &app->commandPool) != VK_SUCCESS) {
-    printf("failed to create command pool\n");
-    exit(1);
-  }
+  streamer->budget += granted;
+  return granted;
 }
 
-void app_private_init_vulkan_create_command_buffer(App *app) {
-  VkCommandBufferAllocateInfo allocInfo = {};
-  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  allocInfo.commandPool = app->commandPool;
-  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandBufferCount = 1;
+void texture_streamer_destroy(TextureStreamer *streamer) {
+  pthread_mutex_lock(&streamer->mutex);
+  streamer->ioRunning = false;
+  pthread_cond_broadcast(&streamer->ioCond);
+  pthread_mutex_unlock(&streamer->mutex);
+  pthread_join(streamer->ioThread, NULL);
 
-  if(vkAllocateCommandBuffers(app->device, &allocInfo, &app->commandBuffer) != VK_SUCCESS) {
-    printf("failed to create command buffers\n");
-    exit(1);
+  vkQueueWaitIdle(streamer->transferQueue);
+
+  for(int i = 0; i < TEXTURE_STREAMER_RING_SLOTS; i++) {
+    vkDestroyFence(streamer->device, streamer->slots[i].fence, NULL);
   }
-}
+  vkDestroyCommandPool(streamer->device, streamer->commandPool, NULL);
 
-void app_private_init_vulkan_create_sync_objects(App *app) {
-  VkSemaphoreCreateInfo semaphoreInfo = {};
-  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  for(int i = 0; i < streamer->retiredViewsCount; i++) {
+    memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_IMAGE_VIEW);
+    vkDestroyImageView(streamer->device, streamer->retiredViews[i].view, NULL);
+  }
+  for(int i = 0; i < streamer->retiredImagesCount; i++) {
+    memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_IMAGE);
+    vkDestroyImage(streamer->device, streamer->retiredImages[i].image, NULL);
+    memory_tracker_free(&globalMemoryTracker, streamer->device, streamer->retiredImages[i].memory);
+  }
 
-  VkFenceCreateInfo fenceInfo = {};
-  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-  fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+  for(int i = 0; i < streamer->texturesCount; i++) {
+    Texture *texture = &streamer->textures[i];
 
-  if(vkCreateSemaphore(app->device, &semaphoreInfo, NULL, &app->imageAvailableSemaphore) != VK_SUCCESS
-     || vkCreateSemaphore(app->device, &semaphoreInfo, NULL, &app->renderFinishedSemaphore) != VK_SUCCESS
-     || vkCreateFence(app->device, &fenceInfo, NULL, &app->inFlightFence) != VK_SUCCESS
-     ){
-    printf("failed to create sync objects");
-    exit(1);
+    if(texture->fd >= 0)
+      close(texture->fd);
+    if(texture->view != VK_NULL_HANDLE) {
+      memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_IMAGE_VIEW);
+      vkDestroyImageView(streamer->device, texture->view, NULL);
+    }
+    if(texture->image != VK_NULL_HANDLE) {
+      memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_IMAGE);
+      vkDestroyImage(streamer->device, texture->image, NULL);
+    }
+    if(texture->memory != VK_NULL_HANDLE)
+      memory_tracker_free(&globalMemoryTracker, streamer->device, texture->memory);
   }
-}
 
-VkDebugUtilsMessengerCreateInfoEXT app_private_populate_debug_messenger_info() {
-  VkDebugUtilsMessengerCreateInfoEXT createInfo;
-  createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-  createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
-                               VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
-                               VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-  createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
-                           VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
-                           VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-  createInfo.pfnUserCallback = app_private_debug_callback;
-  createInfo.flags = 0;
-  createInfo.pNext = NULL;
-  return createInfo;
+  vkUnmapMemory(streamer->device, streamer->stagingMemory);
+  memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_BUFFER);
+  vkDestroyBuffer(streamer->device, streamer->stagingBuffer, NULL);
+  memory_tracker_free(&globalMemoryTracker, streamer->device, streamer->stagingMemory);
+
+  pthread_cond_destroy(&streamer->ioCond);
+  pthread_mutex_destroy(&streamer->mutex);
 }
 
-VKAPI_ATTR VkBool32 VKAPI_CALL app_private_debug_callback(
-  VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-  VkDebugUtilsMessageTypeFlagsEXT messageType,
-  const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
-  void *pUserData) {
+void *texture_streamer_private_io_thread(void *arg) {
+  TextureStreamer *streamer = arg;
 
-  printf("\n");
-  printf("%s", pCallbackData->pMessage);
-  printf("\n");
+  pthread_mutex_lock(&streamer->mutex);
 
-  return VK_FALSE;
-}
+  while(streamer->ioRunning) {
+    // smallest request first, so headers and coarse mips of every texture
+    // are read before any texture gets its fine mips
+    int requestIndex = -1;
+    for(int i = 0; i < streamer->requestsCount; i++) {
+      if(requestIndex < 0 || streamer->requests[i].size < streamer->requests[requestIndex].size)
+        requestIndex = i;
+    }
 
-void app_private_main_loop(App* app) {
-  while(!glfwWindowShouldClose(app->window)) {
-    glfwPollEvents();
-    app_private_main_loop_draw_frame(app);
-  }
-}
+    int slotIndex = -1;
+    if(requestIndex >= 0 && streamer->requests[requestIndex].kind == TEXTURE_REQUEST_MIP) {
+      for(int i = 0; i < TEXTURE_STREAMER_RING_SLOTS; i++) {
+        if(streamer->slots[i].state == STAGING_SLOT_FREE) {
+          slotIndex = i;
+          break;
+        }
+      }
+    }
 
-void app_private_main_loop_draw_frame(App* app) {
-  vkWaitForFences(app->device, 1, &app->inFlightFence, VK_TRUE, UINT64_MAX);
-  vkResetFences(app->device, 1, &app->inFlightFence);
+    if(requestIndex < 0 || (streamer->requests[requestIndex].kind == TEXTURE_REQUEST_MIP && slotIndex < 0)) {
+      pthread_cond_wait(&streamer->ioCond, &streamer->mutex);
+      continue;
+    }
 
-  uint32_t imageIndex;
-  vkAcquireNextImageKHR(app->device, app->swapChain, UINT64_MAX, app->imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+    TextureRequest request = streamer->requests[requestIndex];
+    streamer->requests[requestIndex] = streamer->requests[--streamer->requestsCount];
 
-  vkResetCommandBuffer(app->commandBuffer, 0);
-  app_private_main_loop_draw_frame_record_command_buffer(app, app->commandBuffer, imageIndex);
+    Texture *texture = &streamer->textures[request.texture];
 
-  VkSubmitInfo submitInfo = {};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    if(request.kind == TEXTURE_REQUEST_HEADER) {
+      pthread_mutex_unlock(&streamer->mutex);
 
-  VkSemaphore waitSemaphores[] = {app->imageAvailableSemaphore};
-  VkSemaphore signalSemaphores[] = {app->renderFinishedSemaphore};
+      TextureFileHeader header;
+      struct stat fileStat;
+      int fd = open(texture->path, O_RDONLY);
+      bool valid = fd >= 0
+        && fstat(fd, &fileStat) == 0
+        && pread(fd, &header, sizeof(header), 0) == sizeof(header)
+        && texture_streamer_private_validate_header(&header, fileStat.st_size, texture->path);
 
-  VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = waitSemaphores;
-  submitInfo.pWaitDstStageMask = waitStages;
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &app->commandBuffer;
-  submitInfo.signalSemaphoreCount = 1;
-  submitInfo.pSignalSemaphores = signalSemaphores;
+      if(!valid) {
+        printf("failed to load texture %s\n", texture->path);
+        if(fd >= 0)
+          close(fd);
+      }
+
+      pthread_mutex_lock(&streamer->mutex);
+      if(valid) {
+        texture->fd = fd;
+        texture->header = header;
+        texture->state = TEXTURE_STATE_HEADER_READY;
+      } else
+        texture->state = TEXTURE_STATE_FAILED;
+    } else {
+      StagingSlot *slot = &streamer->slots[slotIndex];
+      slot->state = STAGING_SLOT_LOADING;
+      slot->texture = request.texture;
+      slot->mip = request.mip;
+      pthread_mutex_unlock(&streamer->mutex);
+
+      uint8_t *destination = streamer->stagingMapped + (size_t)slotIndex * TEXTURE_STREAMER_SLOT_SIZE;
+      ssize_t bytesRead = pread(texture->fd, destination, request.size, texture->header.mips[request.mip].offset);
+
+      pthread_mutex_lock(&streamer->mutex);
+      if(bytesRead == (ssize_t)request.size)
+        slot->state = STAGING_SLOT_READY;
+      else {
+        printf("failed to read mip %u of texture %s\n", request.mip, texture->path);
+        slot->state = STAGING_SLOT_FREE;
+      }
+    }
+  }
+
+  pthread_mutex_unlock(&streamer->mutex);
+  return NULL;
+}
 
-  if(vkQueueSubmit(app->graphicsQueue, 1, &submitInfo, app->inFlightFence) != VK_SUCCESS) {
-    printf("failed to submit to draw buffer\n");
+void texture_streamer_private_push_request(TextureStreamer *streamer, TextureRequest request) {
+  if(streamer->requestsCount >= TEXTURE_STREAMER_MAX_REQUESTS) {
+    printf("texture request queue full\n");
     exit(1);
   }
 
-  VkPresentInfoKHR presentInfo = {};
-  VkSwapchainKHR swapChains[] = {app->swapChain};
+  streamer->requests[streamer->requestsCount++] = request;
+  pthread_cond_signal(&streamer->ioCond);
+}
 
-  presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-  presentInfo.waitSemaphoreCount = 1;
-  presentInfo.pWaitSemaphores = signalSemaphores;
-  presentInfo.swapchainCount = 1;
-  presentInfo.pSwapchains = swapChains;
-  presentInfo.pImageIndices = &imageIndex;
-  presentInfo.pResults = NULL;
+void texture_streamer_private_allocate_texture(TextureStreamer *streamer, Texture *texture) {
+  TextureFileHeader *header = &texture->header;
+  VkDeviceSize remaining = streamer->budget > streamer->committedBytes ? streamer->budget - streamer->committedBytes : 0;
+
+  // pick the finest mip whose chain down to 1x1 still fits in the budget;
+  // the budget is checked against the packed payload size here and against
+  // the real allocation size below
+  texture->firstMip = header->mipCount;
+  VkDeviceSize chainSize = 0;
+  for(int mip = header->mipCount - 1; mip >= 0; mip--) {
+    // a mip is read into one staging slot whole, finer ones are never streamed
+    if(header->mips[mip].size > TEXTURE_STREAMER_SLOT_SIZE) {
+      printf("texture %s mip %d is larger than a %u byte staging slot, streaming from mip %u\n", texture->path, mip, TEXTURE_STREAMER_SLOT_SIZE, texture->firstMip);
+      break;
+    }
+    if(chainSize + header->mips[mip].size > remaining)
+      break;
+    chainSize += header->mips[mip].size;
+    texture->firstMip = mip;
+  }
 
-  vkQueuePresentKHR(app->presentQueue, &presentInfo);
+  if(texture->firstMip == header->mipCount) {
+    printf("texture %s does not fit in streaming budget\n", texture->path);
+    texture->state = TEXTURE_STATE_FAILED;
+    return;
+  }
+
+  uint32_t queueFamilyIndices[] = {streamer->graphicsFamily, streamer->transferFamily};
+
+  VkImageCreateInfo imageInfo = {};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.format = header->format;
+  imageInfo.extent.width = header->width >> texture->firstMip > 0 ? header->width >> texture->firstMip : 1;
+  imageInfo.extent.height = header->height >> texture->firstMip > 0 ? header->height >> texture->firstMip : 1;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = header->mipCount - texture->firstMip;
+  imageInfo.arrayLayers = 1;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  if(streamer->graphicsFamily != streamer->transferFamily) {
+    imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+    imageInfo.queueFamilyIndexCount = 2;
+    imageInfo.pQueueFamilyIndices = queueFamilyIndices;
+  } else
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  if(vkCreateImage(streamer->device, &imageInfo, NULL, &texture->image) != VK_SUCCESS) {
+    printf("failed to create texture image for %s\n", texture->path);
+    texture->state = TEXTURE_STATE_FAILED;
+    return;
+  }
+  memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_IMAGE);
+
+  VkMemoryRequirements memRequirements;
+  vkGetImageMemoryRequirements(streamer->device, texture->image, &memRequirements);
+
+  VkMemoryAllocateInfo allocInfo = {};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = memRequirements.size;
+  allocInfo.memoryTypeIndex = texture_streamer_private_find_memory_type(streamer, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  if(memRequirements.size > remaining
+     || memory_tracker_allocate(&globalMemoryTracker, streamer->device, &allocInfo, &texture->memory) != VK_SUCCESS
+  ){
+    printf("texture %s does not fit in streaming budget\n", texture->path);
+    memory_tracker_object_destroyed(&globalMemoryTracker, MEMORY_OBJECT_IMAGE);
+    vkDestroyImage(streamer->device, texture->image, NULL);
+    texture->image = VK_NULL_HANDLE;
+    texture->state = TEXTURE_STATE_FAILED;
+    return;
+  }
+  vkBindImageMemory(streamer->device, texture->image, texture->memory, 0);
+
+  texture->memorySize = memRequirements.size;
+  streamer->committedBytes += memRequirements.size;
+  texture->residentMip = header->mipCount;
+  texture->state = TEXTURE_STATE_STREAMING;
+
+  uint32_t textureIndex = texture - streamer->textures;
+  for(uint32_t mip = texture->firstMip; mip < header->mipCount; mip++) {
+    TextureRequest request = {};
+    request.kind = TEXTURE_REQUEST_MIP;
+    request.texture = textureIndex;
+    request.mip = mip;
+    request.size = header->mips[mip].size;
+    texture_streamer_private_push_request(streamer, request);
+  }
 }
 
-void app_private_main_loop_draw_frame_record_command_buffer(App *app, VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+void texture_streamer_private_record_upload(TextureStreamer *streamer, uint32_t slotIndex) {
+  StagingSlot *slot = &streamer->slots[slotIndex];
+  Texture *texture = &streamer->textures[slot->texture];
+  uint32_t level = slot->mip - texture->firstMip;
+
   VkCommandBufferBeginInfo beginInfo = {};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-  beginInfo.flags = 0;
-  beginInfo.pInheritanceInfo = NULL;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-  if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
-    printf("failed to begin recording command buffer\n");
+  vkResetCommandBuffer(slot->commandBuffer, 0);
+  if(vkBeginCommandBuffer(slot->commandBuffer, &beginInfo) != VK_SUCCESS) {
+    printf("failed to begin texture upload\n");
     exit(1);
   }
 
-  VkRenderPassBeginInfo renderPassInfo = {};
-  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassInfo.renderPass = app->renderPass;
-  renderPassInfo.framebuffer = app->swapChainFrameBuffers[imageIndex];
+  VkImageMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = texture->image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = level;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+  vkCmdPipelineBarrier(slot->commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+  VkBufferImageCopy region = {};
+  region.bufferOffset = (VkDeviceSize)slotIndex * TEXTURE_STREAMER_SLOT_SIZE;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = level;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent.width = texture->header.width >> slot->mip > 0 ? texture->header.width >> slot->mip : 1;
+  region.imageExtent.height = texture->header.height >> slot->mip > 0 ? texture->header.height >> slot->mip : 1;
+  region.imageExtent.depth = 1;
+
+  vkCmdCopyBufferToImage(slot->commandBuffer, streamer->stagingBuffer, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+  // the graphics queue only picks the level up after the fence signalled,
+  // so the release side of the transition has no consumer stage to name
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+
+  vkCmdPipelineBarrier(slot->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+  if(vkEndCommandBuffer(slot->commandBuffer) != VK_SUCCESS) {
+    printf("failed to record texture upload\n");
+    exit(1);
+  }
 
-  VkOffset2D zeroOffset = {0, 0};
+  slot->state = STAGING_SLOT_UPLOADING;
+}
 
-  renderPassInfo.renderArea.offset = zeroOffset;
-  renderPassInfo.renderArea.extent = app->swapChainExtent;
+void texture_streamer_private_complete_upload(TextureStreamer *streamer, uint32_t slotIndex) {
+  StagingSlot *slot = &streamer->slots[slotIndex];
+  Texture *texture = &streamer->textures[slot->texture];
 
-  VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-  renderPassInfo.clearValueCount = 1;
-  renderPassInfo.pClearValues = &clearColor;
+  texture->uploadedMipsMask |= 1u << slot->mip;
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, app->graphicsPipeline);
+  // uploads can retire out of order, a level only becomes sampleable once
+  // every coarser level is in place too
+  uint32_t residentMip = texture->residentMip;
+  while(residentMip > texture->firstMip && (texture->uploadedMipsMask & (1u << (residentMip - 1))))
+    residentMip--;
 
-  VkViewport viewport = {};
-  viewport.x = 0.0f;
-  viewport.y = 0.0f;
-  viewport.width = (float)app->swapChainExtent.width;
-  viewport.height = (float)app->swapChainExtent.height;
-  viewport.minDepth = 0.0f;
-  viewport.maxDepth = 1.0f;
-  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  if(residentMip != texture->residentMip) {
+    texture->residentMip = residentMip;
+    texture_streamer_private_rebuild_view(streamer, texture);
+  }
 
-  VkRect2D scissor = {};
-  scissor.offset = zeroOffset;
-  scissor.extent = app->swapChainExtent;
-  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+  if(texture->residentMip == texture->firstMip) {
+    close(texture->fd);
+    texture->fd = -1;
+  }
 
-  vkCmdDraw(commandBuffer, 3, 1, 0, 0);
-  vkCmdEndRenderPass(commandBuffer);
+  pthread_mutex_lock(&streamer->mutex);
+  slot->state = STAGING_SLOT_FREE;
+  pthread_cond_signal(&streamer->ioCond);
+  pthread_mutex_unlock(&streamer->mutex);
+}
 
-  if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-    printf("failed to record command buffer\n");
+void texture_streamer_private_rebuild_view(TextureStreamer *streamer, Texture *texture) {
+  if(texture->view != VK_NULL_HANDLE)
+    texture_streamer_private_retire_view(streamer, texture->view);
+
+  VkImageViewCreateInfo createInfo = {};
+  createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  createInfo.image = texture->image;
+  createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  createInfo.format = texture->header.format;
+  createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+  createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+  createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+  createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+  createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  createInfo.subresourceRange.baseMipLevel = texture->residentMip - texture->firstMip;
+  createInfo.subresourceRange.levelCount = texture->header.mipCount - texture->residentMip;
+  createInfo.subresourceRange.baseArrayLayer = 0;
+  createInfo.subresourceRange.layerCount = 1;
+
+  if(vkCreateImageView(streamer->device, &createInfo, NULL, &texture->view) != VK_SUCCESS) {
+    printf("failed to create texture view\n");
     exit(1);
   }
+  memory_tracker_object_created(&globalMemoryTracker, MEMORY_OBJECT_IMAGE_VIEW);
 }
 
-void app_private_cleanup(App* app) {
-  vkDestroySemaphore(app->device, app->imageAvailableSemaphore, NULL);
-  vkDestroySemaphore(app->device, app->renderFinishedSemaphore, NULL);
-  vkDestroyFence(app->device, app->inFlightFence, NULL);
+// frames in flight may still sample through the view, it is destroyed
+// TEXTURE_STREAMER_VIEW_RETIRE_FRAMES updates later
+void texture_streamer_private_retire_view(TextureStreamer *streamer, VkImageView view) {
+  if(streamer->retiredViewsCount >= TEXTURE_STREAMER_MAX_RETIRED_VIEWS) {
+    printf("texture view retire list full\n");
+    exit(1);
+  }
+  streamer->retiredViews[streamer->retiredViewsCount].view = view;
+  streamer->retiredViews[streamer->retiredViewsCount].retiredFrame = streamer->frame;
+  streamer->retiredViewsCount++;
+}
 
-  vkDestroyCommandPool(app->device, app->commandPool, NULL);
+uint32_t texture_streamer_private_find_memory_type(TextureStreamer *streamer, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+  for(uint32_t i = 0; i < streamer->memoryProperties.memoryTypeCount; i++) {
+    if((typeFilter & (1u << i)) && (streamer->memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+      return i;
+  }
+
+  printf("failed to find suitable memory type\n");
+  exit(1);
+}
 
-  for(int i = 0; i < app->swapChainFrameBuffersCount; i++) {
-    vkDestroyFramebuffer(app->device, app->swapChainFrameBuffers[i], NULL);
+// everything the upload later trusts: the image it creates, the mip chain and
+// that every payload is exactly one tightly packed level inside the file
+bool texture_streamer_private_validate_header(const TextureFileHeader *header, uint64_t fileSize, const char *path) {
+  if(header->magic != TEXTURE_FILE_MAGIC) {
+    printf("texture %s is not a vktx file\n", path);
+    return false;
   }
 
-  vkDestroyPipeline(app->device, app->graphicsPipeline, NULL);
-  vkDestroyPipelineLayout(app->device, app->pipelineLayout, NULL);
-  vkDestroyRenderPass(app->device, app->renderPass, NULL);
+  uint32_t bytesPerTexel = texture_streamer_private_bytes_per_texel(header->format);
+  if(bytesPerTexel == 0) {
+    printf("texture %s has unsupported format %u\n", path, header->format);
+    return false;
+  }
 
-  for(int i = 0; i < app->swapChainImagesCount; i++) {
-    vkDestroyImageView(app->device, app->swapChainImageViews[i], NULL);
+  if(header->width == 0 || header->height == 0 || header->width > TEXTURE_MAX_DIMENSION || header->height > TEXTURE_MAX_DIMENSION) {
+    printf("texture %s has invalid size %ux%u\n", path, header->width, header->height);
+    return false;
   }
 
-  vkDestroySwapchainKHR(app->device, app->swapChain, NULL);
-  vkDestroyDevice(app->device, NULL);
-  vkDestroySurfaceKHR(app->instance, app->surface, NULL);
+  uint32_t largest = header->width > header->height ? header->width : header->height;
+  uint32_t fullChain = 1;
+  while(largest >> fullChain)
+    fullChain++;
 
-  if(globalValidationLayersEnabled) {
-    PFN_vkDestroyDebugUtilsMessengerEXT func = (PFN_vkDestroyDebugUtilsMessengerEXT)
-      vkGetInstanceProcAddr(app->instance, "vkDestroyDebugUtilsMessengerEXT");
+  if(header->mipCount == 0 || header->mipCount > TEXTURE_MAX_MIPS || header->mipCount > fullChain) {
+    printf("texture %s has invalid mip count %u\n", path, header->mipCount);
+    return false;
+  }
 
-    if(func != NULL)
-      func(app->instance, app->debugMessenger, NULL);
-    else {
-      printf("failed to load messenger destroy function\n");
-      exit(1);
+  for(uint32_t mip = 0; mip < header->mipCount; mip++) {
+    uint64_t width = header->width >> mip > 0 ? header->width >> mip : 1;
+    uint64_t height = header->height >> mip > 0 ? header->height >> mip : 1;
+    uint64_t offset = header->mips[mip].offset;
+    uint64_t size = header->mips[mip].size;
+
+    if(size != width * height * bytesPerTexel || offset < sizeof(TextureFileHeader) || offset > fileSize || size > fileSize - offset) {
+      printf("texture %s has an invalid mip %u\n", path, mip);
+      return false;
     }
   }
 
-  vkDestroyInstance(app->instance, NULL);
+  return true;
+}
 
-  glfwDestroyWindow(app->window);
-  glfwTerminate();
+// formats the streamer uploads as plain texel copies, 0 for everything else
+uint32_t texture_streamer_private_bytes_per_texel(VkFormat format) {
+  switch(format) {
+    case VK_FORMAT_R8_UNORM:
+      return 1;
+    case VK_FORMAT_R8G8_UNORM:
+      return 2;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+      return 4;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+      return 8;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+      return 16;
+    default:
+      return 0;
+  }
 }
 
 
 
-QueueFamilyIndices queue_families_find(VkPhysicalDevice device, VkSurfaceKHR surface) {
-  QueueFamilyIndices indices;
-  indices.isComplete = false;
+bool config_set(AppConfig *config, const char *key, const char *value) {
+  const ConfigOption *option = config_private_find_option(key);
+  if(option == NULL) {
+    printf("config: unknown option %s\n", key);
+    return false;
+  }
+
+  void *field = (uint8_t *)config + option->offset;
+  char *end = NULL;
+
+  switch(option->type) {
+    case CONFIG_OPTION_UINT: {
+      unsigned long long parsed = strtoull(value, &end, 10);
+      if(end == value || *end != '\0' || value[0] == '-' || parsed < option->min || parsed > option->max) {
+        printf("config: %s expects a number in [%u, %u], got %s\n", key, option->min, option->max, value);
+        return false;
+      }
+      *(uint32_t *)field = (uint32_t)parsed;
+      return true;
+    }
+    case CONFIG_OPTION_INT64: {
+      long long parsed = strtoll(value, &end, 10);
+      if(end == value || *end != '\0') {
+        printf("config: %s expects a number, got %s\n", key, value);
+        return false;
+      }
+      *(int64_t *)field = parsed;
+      return true;
+    }
+    case CONFIG_OPTION_DOUBLE: {
+      double parsed = strtod(value, &end);
+      if(end == value || *end != '\0') {
+        printf("config: %s expects a number, got %s\n", key, value);
+        return false;
+      }
+      *(double *)field = parsed;
+      return true;
+    }
+    case CONFIG_OPTION_BOOL:
+      if(strcmp(value, "on") == 0 || strcmp(value, "true") == 0 || strcmp(value, "1") == 0)
+        *(bool *)field = true;
+      else if(strcmp(value, "off") == 0 || strcmp(value, "false") == 0 || strcmp(value, "0") == 0)
+        *(bool *)field = false;
+      else {
+        printf("config: %s expects on or off, got %s\n", key, value);
+        return false;
+      }
+      return true;
+    case CONFIG_OPTION_STRING:
+      *(const char **)field = value;
+      return true;
+    case CONFIG_OPTION_CHOICE:
+      for(int i = 0; option->choices[i] != NULL; i++) {
+        if(strcmp(value, option->choices[i]) == 0) {
+          *(int *)field = i;
+          return true;
+        }
+      }
+      printf("config: %s expects one of", key);
+      for(int i = 0; option->choices[i] != NULL; i++) {
+        printf(" %s", option->choices[i]);
+      }
+      printf(", got %s\n", value);
+      return false;
+  }
 
-  uint32_t queueFamiliesCount = 0;
-  vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamiliesCount, NULL);
+  return false;
+}
 
-  VkQueueFamilyProperties *queueFamilies = calloc(queueFamiliesCount, sizeof(VkQueueFamilyProperties));
-  CHECK_ALLOC_FOR_NULL(queueFamilies);
-  vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamiliesCount, queueFamilies);
+// key = value per line, # starts a comment. the file stays loaded until
+// config_destroy since string options point into it
+bool config_load_file(AppConfig *config, const char *path) {
+  if(config->filesCount == CONFIG_MAX_FILES) {
+    printf("config: more than %d config files\n", CONFIG_MAX_FILES);
+    return false;
+  }
 
-  for(int i = 0; i < queueFamiliesCount; i++) {
-    uint8_t conditionsMet = 0;
+  size_t size;
+  uint8_t *data = helper_read_file(path, &size);
+  if(data == NULL) {
+    printf("config: cannot read %s\n", path);
+    return false;
+  }
 
-    VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+  char *text = realloc(data, size + 1);
+  CHECK_ALLOC_FOR_NULL(text);
+  text[size] = '\0';
+  config->files[config->filesCount++] = text;
+
+  uint32_t lineNumber = 0;
+  char *line = text;
+
+  while(line != NULL) {
+    char *next = strchr(line, '\n');
+    if(next != NULL)
+      *next++ = '\0';
+    lineNumber++;
+
+    char *comment = strchr(line, '#');
+    if(comment != NULL)
+      *comment = '\0';
+
+    char *key = config_private_trim(line);
+    if(*key != '\0') {
+      char *equals = strchr(key, '=');
+      if(equals == NULL) {
+        printf("config: %s:%u: expected key = value\n", path, lineNumber);
+        return false;
+      }
+      *equals = '\0';
 
-    if(presentSupport) {
-      indices.presentFamily = i;
-      conditionsMet++;
+      if(!config_set(config, config_private_trim(key), config_private_trim(equals + 1))) {
+        printf("config: in %s:%u\n", path, lineNumber);
+        return false;
+      }
     }
 
-    if(queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-      indices.graphicsFamily = i;
-      conditionsMet++;
+    line = next;
+  }
+
+  return true;
+}
+
+// --key value for every option, and a bare --key turns a bool on. --config
+// applies a file where it appears, so later arguments override it
+bool config_parse_args(AppConfig *config, int argc, char **argv) {
+  for(int i = 1; i < argc; i++) {
+    if(strncmp(argv[i], "--", 2) != 0) {
+      printf("config: unexpected argument %s\n", argv[i]);
+      return false;
     }
 
-    if(conditionsMet >= globalQueueFamilyIndicesFieldCount) {
-      indices.isComplete = true;
-      break;
+    const char *key = argv[i] + 2;
+    bool hasValue = i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0;
+
+    if(strcmp(key, "config") == 0) {
+      if(!hasValue || !config_load_file(config, argv[++i]))
+        return false;
+      continue;
+    }
+
+    const ConfigOption *option = config_private_find_option(key);
+    if(option != NULL && option->type == CONFIG_OPTION_BOOL && !hasValue) {
+      config_set(config, key, "on");
+      continue;
+    }
+
+    if(!hasValue) {
+      printf("config: --%s needs a value\n", key);
+      return false;
     }
+    if(!config_set(config, key, argv[++i]))
+      return false;
   }
 
-  free(queueFamilies);
+  return true;
+}
 
-  return indices;
+bool config_validate(const AppConfig *config) {
+  if(config->headless && config->replayPath == NULL && config->frames == 0) {
+    printf("config: headless runs need a frame count, see --frames\n");
+    return false;
+  }
+  if(config->capturePath != NULL && config->replayPath != NULL) {
+    printf("config: capture and replay are exclusive\n");
+    return false;
+  }
+  if((config->resizeInterval > 0 || config->readback) && !config->headless) {
+    printf("config: resize-interval and readback need --headless\n");
+    return false;
+  }
+  if(config->targetFrameMs > 0.0 && !config->gpuTimings) {
+    printf("config: target-frame-ms measures the frame with gpu-timings, turn them on\n");
+    return false;
+  }
+  if(config->benchmarkPath != NULL && (config->frames == 0 || config->replayPath != NULL)) {
+    printf("config: benchmarks need a frame count and no replay, replays report their own timings\n");
+    return false;
+  }
+  return true;
 }
 
+// one line with every option, so logged benchmark runs say what they measured
+void config_log(const AppConfig *config) {
+  printf("config:");
 
+  for(int i = 0; i < globalConfigOptionsCount; i++) {
+    const ConfigOption *option = &globalConfigOptions[i];
+    const void *field = (const uint8_t *)config + option->offset;
 
-SwapChainSupportDetails swap_chain_support_details_query(VkPhysicalDevice device, VkSurfaceKHR surface) {
-  SwapChainSupportDetails details;
+    switch(option->type) {
+      case CONFIG_OPTION_UINT:
+        printf(" %s=%u", option->name, *(const uint32_t *)field);
+        break;
+      case CONFIG_OPTION_INT64:
+        printf(" %s=%lld", option->name, (long long)*(const int64_t *)field);
+        break;
+      case CONFIG_OPTION_DOUBLE:
+        printf(" %s=%g", option->name, *(const double *)field);
+        break;
+      case CONFIG_OPTION_BOOL:
+        printf(" %s=%s", option->name, *(const bool *)field ? "on" : "off");
+        break;
+      case CONFIG_OPTION_STRING:
+        if(*(const char * const *)field != NULL)
+          printf(" %s=%s", option->name, *(const char * const *)field);
+        break;
+      case CONFIG_OPTION_CHOICE:
+        printf(" %s=%s", option->name, option->choices[*(const int *)field]);
+        break;
+    }
+  }
 
-  vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
+  printf("\n");
+}
 
-  vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &details.formatsCount, NULL);
+void config_print_usage(const char *program) {
+  printf("usage: %s [--config file] [--option value]...\n", program);
 
-  if(details.formatsCount != 0) {
-    details.formats = calloc(details.formatsCount, sizeof(VkSurfaceFormatKHR));
-    CHECK_ALLOC_FOR_NULL(details.formats);
-    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &details.formatsCount, details.formats);
-  }
+  for(int i = 0; i < globalConfigOptionsCount; i++) {
+    const ConfigOption *option = &globalConfigOptions[i];
+    printf("  --%-20s %s", option->name, option->help);
 
-  vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &details.presentModesCount, NULL);
+    if(option->type == CONFIG_OPTION_CHOICE) {
+      printf(" (");
+      for(int j = 0; option->choices[j] != NULL; j++) {
+        printf(j == 0 ? "%s" : "|%s", option->choices[j]);
+      }
+      printf(")");
+    }
+    printf("\n");
+  }
+}
 
-  if(details.presentModesCount != 0) {
-    details.presentModes = calloc(details.presentModesCount, sizeof(VkPresentModeKHR));
-    CHECK_ALLOC_FOR_NULL(details.presentModes);
-    vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &details.presentModesCount, details.presentModes);
+void config_destroy(AppConfig *config) {
+  for(int i = 0; i < config->filesCount; i++) {
+    free(config->files[i]);
   }
+  config->filesCount = 0;
+}
 
-  return details;
+const ConfigOption *config_private_find_option(const char *name) {
+  for(int i = 0; i < globalConfigOptionsCount; i++) {
+    if(strcmp(globalConfigOptions[i].name, name) == 0)
+      return &globalConfigOptions[i];
+  }
+  return NULL;
 }
 
-void swap_chain_support_details_free(SwapChainSupportDetails details) {
-  free(details.formats);
-  free(details.presentModes);
+char *config_private_trim(char *text) {
+  while(*text == ' ' || *text == '\t')
+    text++;
+
+  size_t length = strlen(text);
+  while(length > 0 && (text[length - 1] == ' ' || text[length - 1] == '\t' || text[length - 1] == '\r'))
+    text[--length] = '\0';
+
+  return text;
 }
 
 
@@ -1107,6 +8892,7 @@ static uint8_t *helper_read_file(const char *filename, size_t* filesize) {
 
     fseek(fp, 0L, SEEK_SET);
     fread(buffer, fsize, 1, fp);
+    fclose(fp);
 
     *filesize = fsize;
     return buffer;
@@ -1114,10 +8900,45 @@ static uint8_t *helper_read_file(const char *filename, size_t* filesize) {
     return NULL;
 }
 
+static uint64_t helper_time_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int helper_private_compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static void helper_sort_u64(uint64_t *values, uint64_t count) {
+  qsort(values, count, sizeof(uint64_t), helper_private_compare_u64);
+}
+
+static void helper_sleep_until_ns(uint64_t time) {
+  uint64_t now = helper_time_ns();
+  if(time <= now)
+    return;
+
+  uint64_t remaining = time - now;
+  struct timespec ts = {remaining / 1000000000ull, remaining % 1000000000ull};
+  nanosleep(&ts, NULL);
+}
 
 
-int main() {
+
+int main(int argc, char **argv) {
+  if(!config_parse_args(&globalConfig, argc, argv) || !config_validate(&globalConfig)) {
+    config_print_usage(argv[0]);
+    config_destroy(&globalConfig);
+    return 1;
+  }
+  config_log(&globalConfig);
+
   App app;
 
   app_run(&app);
+
+  config_destroy(&globalConfig);
 }
@@ -0,0 +1,744 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "mesh_format.h"
+
+#define CHECK_ALLOC_FOR_NULL(x) do { if((x) == NULL) {printf("could not allocate memory\n"); exit(1);} } while(0)
+
+#define OBJ_MAX_FACE_VERTICES 64
+
+
+
+struct {
+  float position[3];
+  float normal[3];
+  float texcoord[2];
+} typedef MeshVertex;
+
+struct {
+  float *data;
+  uint32_t count;
+  uint32_t capacity;
+  uint32_t components;
+} typedef FloatArray;
+
+struct {
+  int32_t position;
+  int32_t texcoord;
+  int32_t normal;
+} typedef ObjVertexKey;
+
+struct {
+  MeshVertex *vertices;
+  uint32_t verticesCount;
+  uint32_t verticesCapacity;
+
+  uint32_t *indices;
+  uint32_t indicesCount;
+  uint32_t indicesCapacity;
+
+  // open addressing map from obj position/texcoord/normal triple to vertex index
+  ObjVertexKey *keys;
+  uint32_t *keyVertices;
+  uint32_t keysCapacity;
+
+  bool hasNormals;
+} typedef MeshBuilder;
+
+struct {
+  Meshlet *meshlets;
+  uint32_t meshletsCount;
+  uint32_t meshletsCapacity;
+
+  uint32_t *vertices; // meshlet vertex section
+  uint32_t verticesCount;
+  uint32_t verticesCapacity;
+
+  uint8_t *triangles; // meshlet triangle section
+  uint32_t trianglesSize;
+  uint32_t trianglesCapacity;
+} typedef MeshletBuilder;
+
+
+
+void float_array_push(FloatArray *array, const float *values);
+
+void mesh_builder_init(MeshBuilder *builder);
+uint32_t mesh_builder_add_vertex(MeshBuilder *builder, ObjVertexKey key, FloatArray *positions, FloatArray *texcoords, FloatArray *normals);
+void mesh_builder_add_index(MeshBuilder *builder, uint32_t index);
+void mesh_builder_compute_normals(MeshBuilder *builder);
+void mesh_builder_free(MeshBuilder *builder);
+
+void obj_load(const char *path, MeshBuilder *builder);
+bool obj_parse_face_vertex(const char *token, ObjVertexKey *key, FloatArray *positions, FloatArray *texcoords, FloatArray *normals);
+
+void meshlets_build(MeshBuilder *builder, MeshletBuilder *meshlets);
+uint32_t meshlets_count_new_vertices(const uint32_t *triangle, const uint32_t *localVertices);
+void meshlets_push_vertex(MeshletBuilder *meshlets, uint32_t vertex);
+void meshlets_push_triangle_index(MeshletBuilder *meshlets, uint8_t index);
+void meshlets_finish(MeshBuilder *builder, MeshletBuilder *meshlets, Meshlet *meshlet);
+float *meshlets_position(MeshBuilder *builder, MeshletBuilder *meshlets, const Meshlet *meshlet, uint32_t index);
+void meshlets_free(MeshletBuilder *meshlets);
+
+void mesh_file_write(const char *path, MeshBuilder *builder, MeshletBuilder *meshlets);
+uint64_t mesh_file_align(uint64_t offset);
+
+
+
+void float_array_push(FloatArray *array, const float *values) {
+  if(array->count == array->capacity) {
+    array->capacity = array->capacity == 0 ? 1024 : array->capacity * 2;
+    array->data = realloc(array->data, (size_t)array->capacity * array->components * sizeof(float));
+    CHECK_ALLOC_FOR_NULL(array->data);
+  }
+
+  memcpy(&array->data[(size_t)array->count * array->components], values, array->components * sizeof(float));
+  array->count++;
+}
+
+
+
+void mesh_builder_init(MeshBuilder *builder) {
+  memset(builder, 0, sizeof(MeshBuilder));
+
+  builder->keysCapacity = 1 << 16;
+  builder->keys = calloc(builder->keysCapacity, sizeof(ObjVertexKey));
+  CHECK_ALLOC_FOR_NULL(builder->keys);
+  builder->keyVertices = malloc(builder->keysCapacity * sizeof(uint32_t));
+  CHECK_ALLOC_FOR_NULL(builder->keyVertices);
+  memset(builder->keyVertices, 0xff, builder->keysCapacity * sizeof(uint32_t));
+}
+
+uint32_t mesh_builder_add_vertex(MeshBuilder *builder, ObjVertexKey key, FloatArray *positions, FloatArray *texcoords, FloatArray *normals) {
+  if(builder->verticesCount * 2 >= builder->keysCapacity) {
+    uint32_t oldCapacity = builder->keysCapacity;
+    ObjVertexKey *oldKeys = builder->keys;
+    uint32_t *oldKeyVertices = builder->keyVertices;
+
+    builder->keysCapacity *= 2;
+    builder->keys = calloc(builder->keysCapacity, sizeof(ObjVertexKey));
+    CHECK_ALLOC_FOR_NULL(builder->keys);
+    builder->keyVertices = malloc(builder->keysCapacity * sizeof(uint32_t));
+    CHECK_ALLOC_FOR_NULL(builder->keyVertices);
+    memset(builder->keyVertices, 0xff, builder->keysCapacity * sizeof(uint32_t));
+
+    for(uint32_t i = 0; i < oldCapacity; i++) {
+      if(oldKeyVertices[i] == UINT32_MAX)
+        continue;
+
+      uint32_t hash = ((uint32_t)oldKeys[i].position * 73856093u ^ (uint32_t)oldKeys[i].texcoord * 19349663u ^ (uint32_t)oldKeys[i].normal * 83492791u);
+      uint32_t slot = hash & (builder->keysCapacity - 1);
+      while(builder->keyVertices[slot] != UINT32_MAX)
+        slot = (slot + 1) & (builder->keysCapacity - 1);
+
+      builder->keys[slot] = oldKeys[i];
+      builder->keyVertices[slot] = oldKeyVertices[i];
+    }
+
+    free(oldKeys);
+    free(oldKeyVertices);
+  }
+
+  uint32_t hash = ((uint32_t)key.position * 73856093u ^ (uint32_t)key.texcoord * 19349663u ^ (uint32_t)key.normal * 83492791u);
+  uint32_t slot = hash & (builder->keysCapacity - 1);
+
+  while(builder->keyVertices[slot] != UINT32_MAX) {
+    ObjVertexKey *existing = &builder->keys[slot];
+    if(existing->position == key.position && existing->texcoord == key.texcoord && existing->normal == key.normal)
+      return builder->keyVertices[slot];
+    slot = (slot + 1) & (builder->keysCapacity - 1);
+  }
+
+  if(builder->verticesCount == builder->verticesCapacity) {
+    builder->verticesCapacity = builder->verticesCapacity == 0 ? 1024 : builder->verticesCapacity * 2;
+    builder->vertices = realloc(builder->vertices, builder->verticesCapacity * sizeof(MeshVertex));
+    CHECK_ALLOC_FOR_NULL(builder->vertices);
+  }
+
+  MeshVertex *vertex = &builder->vertices[builder->verticesCount];
+  memset(vertex, 0, sizeof(MeshVertex));
+  memcpy(vertex->position, &positions->data[key.position * 3], 3 * sizeof(float));
+  if(key.texcoord >= 0)
+    memcpy(vertex->texcoord, &texcoords->data[key.texcoord * 2], 2 * sizeof(float));
+  if(key.normal >= 0)
+    memcpy(vertex->normal, &normals->data[key.normal * 3], 3 * sizeof(float));
+
+  builder->keys[slot] = key;
+  builder->keyVertices[slot] = builder->verticesCount;
+
+  return builder->verticesCount++;
+}
+
+void mesh_builder_add_index(MeshBuilder *builder, uint32_t index) {
+  if(builder->indicesCount == builder->indicesCapacity) {
+    builder->indicesCapacity = builder->indicesCapacity == 0 ? 4096 : builder->indicesCapacity * 2;
+    builder->indices = realloc(builder->indices, builder->indicesCapacity * sizeof(uint32_t));
+    CHECK_ALLOC_FOR_NULL(builder->indices);
+  }
+
+  builder->indices[builder->indicesCount++] = index;
+}
+
+void mesh_builder_compute_normals(MeshBuilder *builder) {
+  for(uint32_t i = 0; i + 2 < builder->indicesCount; i += 3) {
+    MeshVertex *a = &builder->vertices[builder->indices[i]];
+    MeshVertex *b = &builder->vertices[builder->indices[i + 1]];
+    MeshVertex *c = &builder->vertices[builder->indices[i + 2]];
+
+    float ab[3] = {b->position[0] - a->position[0], b->position[1] - a->position[1], b->position[2] - a->position[2]};
+    float ac[3] = {c->position[0] - a->position[0], c->position[1] - a->position[1], c->position[2] - a->position[2]};
+    float normal[3] = {
+      ab[1] * ac[2] - ab[2] * ac[1],
+      ab[2] * ac[0] - ab[0] * ac[2],
+      ab[0] * ac[1] - ab[1] * ac[0]
+    };
+
+    for(int j = 0; j < 3; j++) {
+      a->normal[j] += normal[j];
+      b->normal[j] += normal[j];
+      c->normal[j] += normal[j];
+    }
+  }
+
+  for(uint32_t i = 0; i < builder->verticesCount; i++) {
+    float *normal = builder->vertices[i].normal;
+    float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+    if(length > 0.0f) {
+      normal[0] /= length;
+      normal[1] /= length;
+      normal[2] /= length;
+    }
+  }
+}
+
+void mesh_builder_free(MeshBuilder *builder) {
+  free(builder->vertices);
+  free(builder->indices);
+  free(builder->keys);
+  free(builder->keyVertices);
+}
+
+
+
+void obj_load(const char *path, MeshBuilder *builder) {
+  FILE *fp = fopen(path, "r");
+
+  if(fp == NULL) {
+    printf("failed to open %s\n", path);
+    exit(1);
+  }
+
+  FloatArray positions = {NULL, 0, 0, 3};
+  FloatArray texcoords = {NULL, 0, 0, 2};
+  FloatArray normals = {NULL, 0, 0, 3};
+
+  char line[4096];
+  uint32_t lineNumber = 0;
+
+  while(fgets(line, sizeof(line), fp) != NULL) {
+    lineNumber++;
+
+    float values[3] = {0.0f, 0.0f, 0.0f};
+
+    if(strncmp(line, "v ", 2) == 0) {
+      sscanf(line + 2, "%f %f %f", &values[0], &values[1], &values[2]);
+      float_array_push(&positions, values);
+    } else if(strncmp(line, "vt ", 3) == 0) {
+      sscanf(line + 3, "%f %f", &values[0], &values[1]);
+      float_array_push(&texcoords, values);
+    } else if(strncmp(line, "vn ", 3) == 0) {
+      sscanf(line + 3, "%f %f %f", &values[0], &values[1], &values[2]);
+      float_array_push(&normals, values);
+    } else if(strncmp(line, "f ", 2) == 0) {
+      uint32_t faceVertices[OBJ_MAX_FACE_VERTICES];
+      uint32_t faceVerticesCount = 0;
+
+      char *saveptr = NULL;
+      for(char *token = strtok_r(line + 2, " \t\r\n", &saveptr); token != NULL; token = strtok_r(NULL, " \t\r\n", &saveptr)) {
+        ObjVertexKey key;
+
+        if(!obj_parse_face_vertex(token, &key, &positions, &texcoords, &normals)) {
+          printf("%s:%u: invalid face vertex '%s'\n", path, lineNumber, token);
+          exit(1);
+        }
+        if(faceVerticesCount == OBJ_MAX_FACE_VERTICES) {
+          printf("%s:%u: face has too many vertices\n", path, lineNumber);
+          exit(1);
+        }
+
+        faceVertices[faceVerticesCount++] = mesh_builder_add_vertex(builder, key, &positions, &texcoords, &normals);
+        if(key.normal >= 0)
+          builder->hasNormals = true;
+      }
+
+      // fan triangulation, enough for the convex polygons exporters produce
+      for(uint32_t i = 1; i + 1 < faceVerticesCount; i++) {
+        mesh_builder_add_index(builder, faceVertices[0]);
+        mesh_builder_add_index(builder, faceVertices[i]);
+        mesh_builder_add_index(builder, faceVertices[i + 1]);
+      }
+    }
+  }
+
+  fclose(fp);
+
+  free(positions.data);
+  free(texcoords.data);
+  free(normals.data);
+}
+
+bool obj_parse_face_vertex(const char *token, ObjVertexKey *key, FloatArray *positions, FloatArray *texcoords, FloatArray *normals) {
+  int32_t values[3] = {0, 0, 0};
+  const char *cursor = token;
+
+  for(int i = 0; i < 3; i++) {
+    char *end;
+    long value = strtol(cursor, &end, 10);
+
+    if(end != cursor)
+      values[i] = (int32_t)value;
+    cursor = end;
+
+    if(*cursor != '/')
+      break;
+    cursor++;
+  }
+
+  // obj indices are 1-based, negative ones count back from the current end
+  uint32_t counts[3] = {positions->count, texcoords->count, normals->count};
+  int32_t resolved[3];
+
+  for(int i = 0; i < 3; i++) {
+    if(values[i] > 0)
+      resolved[i] = values[i] - 1;
+    else if(values[i] < 0)
+      resolved[i] = (int32_t)counts[i] + values[i];
+    else
+      resolved[i] = -1;
+
+    if(resolved[i] >= (int32_t)counts[i])
+      return false;
+  }
+
+  if(resolved[0] < 0)
+    return false;
+
+  key->position = resolved[0];
+  key->texcoord = resolved[1];
+  key->normal = resolved[2];
+  return true;
+}
+
+
+
+// greedy over triangle adjacency: the next triangle is the neighbour of the
+// current meshlet that adds the fewest new vertices, ties going to the one
+// whose vertices have the fewest triangles left, so strips and corners are
+// finished off instead of stranded. when no neighbour fits the next unused
+// triangle in file order seeds the meshlet, or a new one. the index section
+// is rewritten meshlet by meshlet so each meshlet's triangles are contiguous
+void meshlets_build(MeshBuilder *builder, MeshletBuilder *meshlets) {
+  memset(meshlets, 0, sizeof(MeshletBuilder));
+
+  uint32_t trianglesCount = builder->indicesCount / 3;
+
+  // vertex to triangle adjacency, the live triangles of vertex v are
+  // adjacency[offsets[v] .. offsets[v] + liveCounts[v]]
+  uint32_t *offsets = calloc(builder->verticesCount + 1, sizeof(uint32_t));
+  CHECK_ALLOC_FOR_NULL(offsets);
+  uint32_t *liveCounts = calloc(builder->verticesCount, sizeof(uint32_t));
+  CHECK_ALLOC_FOR_NULL(liveCounts);
+  uint32_t *adjacency = malloc((size_t)trianglesCount * 3 * sizeof(uint32_t));
+  CHECK_ALLOC_FOR_NULL(adjacency);
+
+  for(uint32_t i = 0; i < trianglesCount * 3; i++) {
+    offsets[builder->indices[i] + 1]++;
+  }
+  for(uint32_t i = 0; i < builder->verticesCount; i++) {
+    offsets[i + 1] += offsets[i];
+  }
+  for(uint32_t i = 0; i < trianglesCount * 3; i++) {
+    uint32_t vertex = builder->indices[i];
+    adjacency[offsets[vertex] + liveCounts[vertex]++] = i / 3;
+  }
+
+  bool *emitted = calloc(trianglesCount > 0 ? trianglesCount : 1, sizeof(bool));
+  CHECK_ALLOC_FOR_NULL(emitted);
+  uint32_t *indices = malloc((size_t)trianglesCount * 3 * sizeof(uint32_t));
+  CHECK_ALLOC_FOR_NULL(indices);
+
+  // vertex index to its slot in the current meshlet, UINT32_MAX when absent
+  uint32_t *localVertices = malloc(builder->verticesCount * sizeof(uint32_t));
+  CHECK_ALLOC_FOR_NULL(localVertices);
+  memset(localVertices, 0xff, builder->verticesCount * sizeof(uint32_t));
+
+  Meshlet meshlet;
+  memset(&meshlet, 0, sizeof(meshlet));
+
+  uint32_t emittedCount = 0;
+  uint32_t nextUnused = 0;
+
+  while(emittedCount < trianglesCount) {
+    uint32_t best = UINT32_MAX;
+    uint32_t bestNewVertices = 4;
+    uint32_t bestLiveCount = UINT32_MAX;
+
+    for(uint32_t i = 0; i < meshlet.vertexCount && bestNewVertices > 0; i++) {
+      uint32_t vertex = meshlets->vertices[meshlet.vertexOffset + i];
+
+      for(uint32_t j = 0; j < liveCounts[vertex]; j++) {
+        uint32_t triangle = adjacency[offsets[vertex] + j];
+        uint32_t newVertices = meshlets_count_new_vertices(&builder->indices[triangle * 3], localVertices);
+        uint32_t liveCount = liveCounts[builder->indices[triangle * 3]] + liveCounts[builder->indices[triangle * 3 + 1]] + liveCounts[builder->indices[triangle * 3 + 2]];
+
+        if(meshlet.vertexCount + newVertices > MESHLET_MAX_VERTICES)
+          continue;
+        if(newVertices < bestNewVertices || (newVertices == bestNewVertices && liveCount < bestLiveCount)) {
+          best = triangle;
+          bestNewVertices = newVertices;
+          bestLiveCount = liveCount;
+        }
+      }
+    }
+
+    if(best == UINT32_MAX) {
+      while(emitted[nextUnused])
+        nextUnused++;
+
+      if(meshlet.vertexCount + meshlets_count_new_vertices(&builder->indices[nextUnused * 3], localVertices) <= MESHLET_MAX_VERTICES)
+        best = nextUnused;
+    }
+
+    if(best == UINT32_MAX || meshlet.indexCount / 3 == MESHLET_MAX_TRIANGLES) {
+      for(uint32_t i = 0; i < meshlet.vertexCount; i++) {
+        localVertices[meshlets->vertices[meshlet.vertexOffset + i]] = UINT32_MAX;
+      }
+      meshlets_finish(builder, meshlets, &meshlet);
+
+      memset(&meshlet, 0, sizeof(meshlet));
+      meshlet.firstIndex = emittedCount * 3;
+      meshlet.vertexOffset = meshlets->verticesCount;
+      meshlet.triangleOffset = meshlets->trianglesSize;
+      continue;
+    }
+
+    const uint32_t *triangle = &builder->indices[best * 3];
+    for(int j = 0; j < 3; j++) {
+      uint32_t vertex = triangle[j];
+
+      if(localVertices[vertex] == UINT32_MAX) {
+        localVertices[vertex] = meshlet.vertexCount++;
+        meshlets_push_vertex(meshlets, vertex);
+      }
+      meshlets_push_triangle_index(meshlets, localVertices[vertex]);
+      indices[emittedCount * 3 + j] = vertex;
+
+      // drop the triangle from the vertex's live list, a repeated vertex of a
+      // degenerate triangle finds it gone the second time
+      uint32_t *live = &adjacency[offsets[vertex]];
+      for(uint32_t k = 0; k < liveCounts[vertex]; k++) {
+        if(live[k] == best) {
+          live[k] = live[--liveCounts[vertex]];
+          break;
+        }
+      }
+    }
+
+    emitted[best] = true;
+    emittedCount++;
+    meshlet.indexCount += 3;
+  }
+
+  if(meshlet.indexCount > 0)
+    meshlets_finish(builder, meshlets, &meshlet);
+
+  memcpy(builder->indices, indices, (size_t)trianglesCount * 3 * sizeof(uint32_t));
+  builder->indicesCount = trianglesCount * 3;
+
+  free(offsets);
+  free(liveCounts);
+  free(adjacency);
+  free(emitted);
+  free(indices);
+  free(localVertices);
+}
+
+uint32_t meshlets_count_new_vertices(const uint32_t *triangle, const uint32_t *localVertices) {
+  uint32_t newVertices = 0;
+
+  for(int j = 0; j < 3; j++) {
+    bool repeated = (j > 0 && triangle[j] == triangle[0]) || (j > 1 && triangle[j] == triangle[1]);
+    if(localVertices[triangle[j]] == UINT32_MAX && !repeated)
+      newVertices++;
+  }
+
+  return newVertices;
+}
+
+void meshlets_push_vertex(MeshletBuilder *meshlets, uint32_t vertex) {
+  if(meshlets->verticesCount == meshlets->verticesCapacity) {
+    meshlets->verticesCapacity = meshlets->verticesCapacity == 0 ? 4096 : meshlets->verticesCapacity * 2;
+    meshlets->vertices = realloc(meshlets->vertices, meshlets->verticesCapacity * sizeof(uint32_t));
+    CHECK_ALLOC_FOR_NULL(meshlets->vertices);
+  }
+
+  meshlets->vertices[meshlets->verticesCount++] = vertex;
+}
+
+void meshlets_push_triangle_index(MeshletBuilder *meshlets, uint8_t index) {
+  if(meshlets->trianglesSize == meshlets->trianglesCapacity) {
+    meshlets->trianglesCapacity = meshlets->trianglesCapacity == 0 ? 16384 : meshlets->trianglesCapacity * 2;
+    meshlets->triangles = realloc(meshlets->triangles, meshlets->trianglesCapacity);
+    CHECK_ALLOC_FOR_NULL(meshlets->triangles);
+  }
+
+  meshlets->triangles[meshlets->trianglesSize++] = index;
+}
+
+// bounding sphere and normal cone, then pads the triangle section so the
+// next meshlet's triangles start on a uint32_t
+void meshlets_finish(MeshBuilder *builder, MeshletBuilder *meshlets, Meshlet *meshlet) {
+  float min[3] = {INFINITY, INFINITY, INFINITY};
+  float max[3] = {-INFINITY, -INFINITY, -INFINITY};
+
+  for(uint32_t i = 0; i < meshlet->vertexCount; i++) {
+    float *position = builder->vertices[meshlets->vertices[meshlet->vertexOffset + i]].position;
+    for(int j = 0; j < 3; j++) {
+      min[j] = fminf(min[j], position[j]);
+      max[j] = fmaxf(max[j], position[j]);
+    }
+  }
+
+  for(int j = 0; j < 3; j++)
+    meshlet->center[j] = (min[j] + max[j]) * 0.5f;
+
+  float radiusSquared = 0.0f;
+  for(uint32_t i = 0; i < meshlet->vertexCount; i++) {
+    float *position = builder->vertices[meshlets->vertices[meshlet->vertexOffset + i]].position;
+    float dx = position[0] - meshlet->center[0];
+    float dy = position[1] - meshlet->center[1];
+    float dz = position[2] - meshlet->center[2];
+    radiusSquared = fmaxf(radiusSquared, dx * dx + dy * dy + dz * dz);
+  }
+  meshlet->radius = sqrtf(radiusSquared);
+
+  // the axis is the average face normal, the cutoff is the sine of the widest
+  // angle between it and any face normal. degenerate triangles have no normal
+  // and are left out
+  uint32_t trianglesCount = meshlet->indexCount / 3;
+  float normals[MESHLET_MAX_TRIANGLES][3];
+  bool hasNormal[MESHLET_MAX_TRIANGLES];
+  float axis[3] = {0.0f, 0.0f, 0.0f};
+
+  for(uint32_t i = 0; i < trianglesCount; i++) {
+    float *a = meshlets_position(builder, meshlets, meshlet, i * 3);
+    float *b = meshlets_position(builder, meshlets, meshlet, i * 3 + 1);
+    float *c = meshlets_position(builder, meshlets, meshlet, i * 3 + 2);
+
+    float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    float *normal = normals[i];
+    normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+    normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+    normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+
+    float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    hasNormal[i] = length > 0.0f;
+    if(!hasNormal[i])
+      continue;
+
+    for(int j = 0; j < 3; j++) {
+      normal[j] /= length;
+      axis[j] += normal[j];
+    }
+  }
+
+  float axisLength = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+  float minDot = 1.0f;
+
+  if(axisLength > 0.0f) {
+    for(int j = 0; j < 3; j++)
+      axis[j] /= axisLength;
+
+    for(uint32_t i = 0; i < trianglesCount; i++) {
+      if(hasNormal[i])
+        minDot = fminf(minDot, normals[i][0] * axis[0] + normals[i][1] * axis[1] + normals[i][2] * axis[2]);
+    }
+  }
+
+  memcpy(meshlet->coneAxis, axis, sizeof(axis));
+  memcpy(meshlet->coneApex, meshlet->center, sizeof(meshlet->center));
+  meshlet->coneCutoff = 2.0f;
+
+  // near or past 90 degrees the cone would cull almost nothing, and the apex
+  // below would run off towards infinity
+  if(axisLength > 0.0f && minDot > 0.1f) {
+    // move the apex back along the axis until it is behind every face plane,
+    // so the test holds for cameras close to the meshlet as well
+    float maxDistance = 0.0f;
+
+    for(uint32_t i = 0; i < trianglesCount; i++) {
+      if(!hasNormal[i])
+        continue;
+
+      float *a = meshlets_position(builder, meshlets, meshlet, i * 3);
+      float *normal = normals[i];
+      float centerDistance = (meshlet->center[0] - a[0]) * normal[0] + (meshlet->center[1] - a[1]) * normal[1] + (meshlet->center[2] - a[2]) * normal[2];
+      float axisDot = axis[0] * normal[0] + axis[1] * normal[1] + axis[2] * normal[2];
+      maxDistance = fmaxf(maxDistance, centerDistance / axisDot);
+    }
+
+    for(int j = 0; j < 3; j++)
+      meshlet->coneApex[j] = meshlet->center[j] - axis[j] * maxDistance;
+    meshlet->coneCutoff = sqrtf(1.0f - minDot * minDot);
+  }
+
+  while(meshlets->trianglesSize % 4 != 0)
+    meshlets_push_triangle_index(meshlets, 0);
+
+  if(meshlets->meshletsCount == meshlets->meshletsCapacity) {
+    meshlets->meshletsCapacity = meshlets->meshletsCapacity == 0 ? 1024 : meshlets->meshletsCapacity * 2;
+    meshlets->meshlets = realloc(meshlets->meshlets, meshlets->meshletsCapacity * sizeof(Meshlet));
+    CHECK_ALLOC_FOR_NULL(meshlets->meshlets);
+  }
+
+  meshlets->meshlets[meshlets->meshletsCount++] = *meshlet;
+}
+
+// position of the meshlet's index-th triangle corner
+float *meshlets_position(MeshBuilder *builder, MeshletBuilder *meshlets, const Meshlet *meshlet, uint32_t index) {
+  uint8_t localVertex = meshlets->triangles[meshlet->triangleOffset + index];
+  return builder->vertices[meshlets->vertices[meshlet->vertexOffset + localVertex]].position;
+}
+
+void meshlets_free(MeshletBuilder *meshlets) {
+  free(meshlets->meshlets);
+  free(meshlets->vertices);
+  free(meshlets->triangles);
+}
+
+
+
+uint64_t mesh_file_align(uint64_t offset) {
+  return (offset + MESH_FILE_ALIGNMENT - 1) & ~(uint64_t)(MESH_FILE_ALIGNMENT - 1);
+}
+
+void mesh_file_write(const char *path, MeshBuilder *builder, MeshletBuilder *meshlets) {
+  MeshFileHeader header;
+  memset(&header, 0, sizeof(header));
+
+  header.magic = MESH_FILE_MAGIC;
+  header.version = MESH_FILE_VERSION;
+  header.vertexStride = sizeof(MeshVertex);
+  header.attributeCount = 3;
+  header.attributes[0] = (MeshAttribute) {MESH_ATTRIBUTE_POSITION, MESH_FORMAT_R32G32B32_SFLOAT, offsetof(MeshVertex, position), 0};
+  header.attributes[1] = (MeshAttribute) {MESH_ATTRIBUTE_NORMAL, MESH_FORMAT_R32G32B32_SFLOAT, offsetof(MeshVertex, normal), 0};
+  header.attributes[2] = (MeshAttribute) {MESH_ATTRIBUTE_TEXCOORD, MESH_FORMAT_R32G32_SFLOAT, offsetof(MeshVertex, texcoord), 0};
+
+  header.vertexCount = builder->verticesCount;
+  header.indexCount = builder->indicesCount;
+  header.meshletCount = meshlets->meshletsCount;
+  header.meshletVertexCount = meshlets->verticesCount;
+
+  header.vertexOffset = mesh_file_align(sizeof(MeshFileHeader));
+  header.vertexSize = (uint64_t)builder->verticesCount * sizeof(MeshVertex);
+  header.indexOffset = mesh_file_align(header.vertexOffset + header.vertexSize);
+  header.indexSize = (uint64_t)builder->indicesCount * sizeof(uint32_t);
+  header.meshletOffset = mesh_file_align(header.indexOffset + header.indexSize);
+  header.meshletSize = (uint64_t)meshlets->meshletsCount * sizeof(Meshlet);
+  header.meshletVertexOffset = mesh_file_align(header.meshletOffset + header.meshletSize);
+  header.meshletVertexSize = (uint64_t)meshlets->verticesCount * sizeof(uint32_t);
+  header.meshletTriangleOffset = mesh_file_align(header.meshletVertexOffset + header.meshletVertexSize);
+  header.meshletTriangleSize = meshlets->trianglesSize;
+
+  for(int j = 0; j < 3; j++) {
+    header.boundsMin[j] = INFINITY;
+    header.boundsMax[j] = -INFINITY;
+  }
+  for(uint32_t i = 0; i < builder->verticesCount; i++) {
+    for(int j = 0; j < 3; j++) {
+      header.boundsMin[j] = fminf(header.boundsMin[j], builder->vertices[i].position[j]);
+      header.boundsMax[j] = fmaxf(header.boundsMax[j], builder->vertices[i].position[j]);
+    }
+  }
+
+  FILE *fp = fopen(path, "wb");
+
+  if(fp == NULL) {
+    printf("failed to open %s for writing\n", path);
+    exit(1);
+  }
+
+  static const uint8_t padding[MESH_FILE_ALIGNMENT] = {0};
+  uint64_t written = 0;
+
+  fwrite(&header, sizeof(header), 1, fp);
+  written += sizeof(header);
+
+  fwrite(padding, 1, header.vertexOffset - written, fp);
+  fwrite(builder->vertices, 1, header.vertexSize, fp);
+  written = header.vertexOffset + header.vertexSize;
+
+  fwrite(padding, 1, header.indexOffset - written, fp);
+  fwrite(builder->indices, 1, header.indexSize, fp);
+  written = header.indexOffset + header.indexSize;
+
+  fwrite(padding, 1, header.meshletOffset - written, fp);
+  fwrite(meshlets->meshlets, 1, header.meshletSize, fp);
+  written = header.meshletOffset + header.meshletSize;
+
+  fwrite(padding, 1, header.meshletVertexOffset - written, fp);
+  fwrite(meshlets->vertices, 1, header.meshletVertexSize, fp);
+  written = header.meshletVertexOffset + header.meshletVertexSize;
+
+  fwrite(padding, 1, header.meshletTriangleOffset - written, fp);
+  fwrite(meshlets->triangles, 1, header.meshletTriangleSize, fp);
+
+  if(ferror(fp) || fclose(fp) != 0) {
+    printf("failed to write %s\n", path);
+    exit(1);
+  }
+
+  printf("%s: %u vertices, %u triangles, %u meshlets averaging %.1f vertices and %.1f triangles\n", path,
+    header.vertexCount, header.indexCount / 3, header.meshletCount,
+    (double)header.meshletVertexCount / header.meshletCount, (double)header.indexCount / 3 / header.meshletCount);
+}
+
+
+
+int main(int argc, char **argv) {
+  if(argc != 3) {
+    printf("usage: %s input.obj output.vkmesh\n", argv[0]);
+    return 1;
+  }
+
+  MeshBuilder builder;
+  mesh_builder_init(&builder);
+
+  obj_load(argv[1], &builder);
+
+  if(builder.indicesCount == 0) {
+    printf("%s contains no faces\n", argv[1]);
+    return 1;
+  }
+
+  if(!builder.hasNormals)
+    mesh_builder_compute_normals(&builder);
+
+  MeshletBuilder meshlets;
+  meshlets_build(&builder, &meshlets);
+
+  mesh_file_write(argv[2], &builder, &meshlets);
+
+  meshlets_free(&meshlets);
+  mesh_builder_free(&builder);
+  return 0;
+}
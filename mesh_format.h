@@ -0,0 +1,88 @@
+#ifndef MESH_FORMAT_H
+#define MESH_FORMAT_H
+
+#include <stdint.h>
+
+// .vkmesh layout, shared by the converter and the runtime:
+//
+//   MeshFileHeader
+//   vertex section           (vertexCount * vertexStride bytes)
+//   index section            (indexCount uint32_t indices, meshlet by meshlet)
+//   meshlet section          (meshletCount Meshlet records)
+//   meshlet vertex section   (meshletVertexCount uint32_t indices into the vertex section)
+//   meshlet triangle section (three uint8_t indices into the meshlet's vertices per triangle)
+//
+// every section starts on a MESH_FILE_ALIGNMENT boundary so the runtime can
+// copy it out of the mapped file as is.
+
+#define MESH_FILE_MAGIC 0x48534d56 // "VMSH"
+#define MESH_FILE_VERSION 2
+#define MESH_FILE_ALIGNMENT 16
+#define MESH_MAX_ATTRIBUTES 8
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+enum {
+  MESH_ATTRIBUTE_POSITION = 0,
+  MESH_ATTRIBUTE_NORMAL = 1,
+  MESH_ATTRIBUTE_TEXCOORD = 2
+} typedef MeshAttributeSemantic;
+
+// the VkFormat values attributes are stored with, spelled out so the
+// converter builds without the vulkan headers; main.c checks them
+#define MESH_FORMAT_R32G32_SFLOAT 103 // VK_FORMAT_R32G32_SFLOAT
+#define MESH_FORMAT_R32G32B32_SFLOAT 106 // VK_FORMAT_R32G32B32_SFLOAT
+
+struct {
+  uint32_t semantic; // MeshAttributeSemantic, doubles as the shader input location
+  uint32_t format; // VkFormat, one of MESH_FORMAT_*
+  uint32_t offset;
+  uint32_t reserved;
+} typedef MeshAttribute;
+
+struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t vertexStride;
+  uint32_t attributeCount;
+  MeshAttribute attributes[MESH_MAX_ATTRIBUTES];
+
+  uint32_t vertexCount;
+  uint32_t indexCount;
+  uint32_t meshletCount;
+  uint32_t meshletVertexCount;
+
+  uint64_t vertexOffset;
+  uint64_t vertexSize;
+  uint64_t indexOffset;
+  uint64_t indexSize;
+  uint64_t meshletOffset;
+  uint64_t meshletSize;
+  uint64_t meshletVertexOffset;
+  uint64_t meshletVertexSize;
+  uint64_t meshletTriangleOffset;
+  uint64_t meshletTriangleSize; // multiple of 4, the shaders read it as uint32_t
+
+  float boundsMin[4];
+  float boundsMax[4];
+} typedef MeshFileHeader;
+
+// laid out to match the std430 struct the culling shaders declare. every
+// triangle of the meshlet faces away from a camera at position p when
+// dot(normalize(coneApex - p), coneAxis) >= coneCutoff; a cutoff above 1
+// means the normals spread too far for the cone to ever cull
+struct {
+  float center[3];
+  float radius;
+  float coneApex[3];
+  float coneCutoff;
+  float coneAxis[3];
+  uint32_t firstIndex; // the meshlet's triangles are contiguous in the index section
+  uint32_t indexCount;
+  uint32_t vertexOffset; // into the meshlet vertex section
+  uint32_t triangleOffset; // bytes into the meshlet triangle section, multiple of 4
+  uint32_t vertexCount;
+} typedef Meshlet;
+
+#endif
@@ -0,0 +1,120 @@
+#!/bin/sh
+# headless scenario benchmarks against a software vulkan icd, compared with
+# perf/baseline.txt. run from the repository root after make.
+#
+#   perf/run.sh            run every scenario, fail on regressions
+#   perf/run.sh --update   run every scenario and record the results as the baseline
+#
+# no baseline is committed yet, so this is not a make target: record one on
+# the reference lavapipe machine with make perf-baseline first.
+#
+# PERF_DEVICE picks the physical device (default llvmpipe), VK_ICD_FILENAMES
+# is pointed at lavapipe when it is not set already.
+
+BASELINE=perf/baseline.txt
+BINARY=./VulkanTest
+DEVICE=${PERF_DEVICE:-llvmpipe}
+UPDATE=0
+
+if [ "$1" = "--update" ]; then
+     UPDATE=1
+fi
+
+if [ $UPDATE -eq 0 ] && [ ! -f "$BASELINE" ]; then
+     echo "perf: no $BASELINE, record one on the reference machine with make perf-baseline"
+     exit 1
+fi
+
+if [ -z "$VK_ICD_FILENAMES" ]; then
+     for icd in /usr/share/vulkan/icd.d/lvp_icd*.json /etc/vulkan/icd.d/lvp_icd*.json; do
+          if [ -f "$icd" ]; then
+               export VK_ICD_FILENAMES="$icd"
+               break
+          fi
+     done
+fi
+
+# the mesh path does not exist on purpose, every scenario draws the builtin
+# triangle. every setting whose default could move the numbers is pinned so a
+# changed default never shows up as a regression
+COMMON="--headless --validation off --device $DEVICE --width 1280 --height 720 --mesh perf/none.vkmesh"
+COMMON="$COMMON --meshlets off --occlusion off --gpu-timings off --post-process on --target-frame-ms 0"
+
+# name and arguments, one scenario per line
+SCENARIOS="triangle --frames 600
+instances-1m --frames 120 --instances 1048576
+many-draws --frames 300 --draws 1024
+resize-storm --frames 300 --resize-interval 10
+readback --frames 300 --readback"
+
+# scenario, metric and the percentage it may get slower than the baseline
+METRICS="triangle startup_ms 25
+triangle frame_ms_median 15
+triangle frame_ms_p99 30
+instances-1m frame_ms_median 15
+instances-1m frame_ms_p99 30
+many-draws frame_ms_median 15
+many-draws frame_ms_p99 30
+resize-storm frame_ms_median 20
+resize-storm frame_ms_max 50
+readback frame_ms_median 15
+readback frame_ms_p99 30"
+
+RESULTS=$(mktemp -d)
+trap 'rm -rf "$RESULTS"' EXIT
+
+echo "$SCENARIOS" | while read -r name args; do
+     echo "perf: $name"
+     if ! $BINARY $COMMON $args --benchmark "$RESULTS/$name.txt" > "$RESULTS/$name.log" 2>&1; then
+          cat "$RESULTS/$name.log"
+          echo "perf: $name failed to run"
+          exit 1
+     fi
+done || exit 1
+
+# baseline lines: scenario metric milliseconds, a run slower than
+# value * (1 + tolerance / 100) fails
+STATUS=0
+NEW_BASELINE="$RESULTS/baseline.txt"
+echo "# scenario metric milliseconds, recorded with make perf-baseline on $(awk '$1 == "device" { $1 = ""; print substr($0, 2) }' "$RESULTS/triangle.txt")" > "$NEW_BASELINE"
+
+echo "$METRICS" | {
+     while read -r name metric tolerance; do
+          measured=$(awk -v metric="$metric" '$1 == metric { print $2 }' "$RESULTS/$name.txt")
+          if [ -z "$measured" ]; then
+               echo "perf: $name reports no $metric"
+               STATUS=1
+               continue
+          fi
+
+          echo "$name $metric $measured" >> "$NEW_BASELINE"
+          if [ $UPDATE -eq 1 ]; then
+               printf "perf: %-14s %-16s %10.3f\n" "$name" "$metric" "$measured"
+               continue
+          fi
+
+          value=$(awk -v name="$name" -v metric="$metric" '$1 == name && $2 == metric { print $3 }' "$BASELINE")
+          if [ -z "$value" ]; then
+               printf "perf: %-14s %-16s %10.3f NO BASELINE, record one with make perf-baseline\n" "$name" "$metric" "$measured"
+               STATUS=1
+          elif awk -v measured="$measured" -v value="$value" -v tolerance="$tolerance" 'BEGIN { exit !(measured > value * (1 + tolerance / 100)) }'; then
+               printf "perf: %-14s %-16s %10.3f baseline %.3f +%s%% REGRESSED\n" "$name" "$metric" "$measured" "$value" "$tolerance"
+               STATUS=1
+          else
+               printf "perf: %-14s %-16s %10.3f baseline %.3f +%s%%\n" "$name" "$metric" "$measured" "$value" "$tolerance"
+          fi
+     done
+     exit $STATUS
+}
+STATUS=$?
+
+if [ $UPDATE -eq 1 ]; then
+     if [ $STATUS -ne 0 ]; then
+          echo "perf: baseline not updated"
+          exit 1
+     fi
+     cp "$NEW_BASELINE" "$BASELINE"
+     echo "perf: baseline written to $BASELINE"
+fi
+
+exit $STATUS
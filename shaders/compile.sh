@@ -1,2 +1,13 @@
 glslc shader.vert -o vert.spv
 glslc shader.frag -o frag.spv
+glslc mesh.vert -o mesh_vert.spv
+glslc mesh.frag -o mesh_frag.spv
+glslc post_downsample.comp -o post_downsample_comp.spv
+glslc post_blur.comp -o post_blur_comp.spv
+glslc post_tonemap.comp -o post_tonemap_comp.spv
+glslc meshlet_cull.comp -o meshlet_cull_comp.spv
+glslc --target-spv=spv1.4 meshlet.task -o meshlet_task.spv
+glslc --target-spv=spv1.4 meshlet.mesh -o meshlet_mesh.spv
+glslc -DOCCLUSION meshlet_cull.comp -o meshlet_cull_occlusion_comp.spv
+glslc -DOCCLUSION --target-spv=spv1.4 meshlet.task -o meshlet_task_occlusion.spv
+glslc hiz_reduce.comp -o hiz_reduce_comp.spv
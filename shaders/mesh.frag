@@ -0,0 +1,14 @@
+#version 450
+
+// set 2 in every mesh pipeline layout, after the meshlet renderer's buffers
+// and depth pyramid; the vertex path fills the sets below it with empty layouts
+layout(set = 2, binding = 0) uniform sampler2D albedo;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexcoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+     outColor = vec4(fragColor * texture(albedo, fragTexcoord).rgb, 1.0);
+}
\ No newline at end of file
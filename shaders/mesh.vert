@@ -0,0 +1,18 @@
+#version 450
+
+layout(push_constant) uniform PushConstants {
+     mat4 viewProjection;
+} pushConstants;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTexcoord;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexcoord;
+
+void main() {
+     gl_Position = pushConstants.viewProjection * vec4(inPosition, 1.0);
+     fragColor = inNormal * 0.5 + 0.5;
+     fragTexcoord = inTexcoord;
+}
\ No newline at end of file